@@ -43,10 +43,17 @@ public class GenSys : ModuleRules
 				"Engine",
 				"Slate",
 				"SlateCore",
-				"AssetTools"
+				"AssetTools",
+				"ImageCore",
+				"PropertyEditor",
+				"SourceControl",
+				"Landscape"
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
+
+		// row by row png decoding and encoding of the maps too large to be decoded whole
+		AddEngineThirdPartyPrivateStaticDependencies(Target, "zlib", "UElibPNG");
 		
 		
 		DynamicallyLoadedModuleNames.AddRange(
@@ -9,11 +9,41 @@
 #include "Widgets/Text/STextBlock.h"
 #include "ToolMenus.h"
 #include "Interfaces/IPluginManager.h"
+#if PLATFORM_WINDOWS
 #include "Windows/WindowsSystemIncludes.h"
+#endif
 #include "DataTypes.h"
 #include "SlateMacroLibrary.h"
 #include "AssetImportTask.h"
 #include "AssetToolsModule.h"
+#include "Engine/Texture2D.h"
+#include "ImageCore.h"
+#include "ImageUtils.h"
+#include "ImageCoreUtils.h"
+#include "GensysBlockCompression.h"
+#include "GensysBatchManifest.h"
+#include "GensysDistanceField.h"
+#include "GensysLakes.h"
+#include "GensysLayerClassification.h"
+#include "GensysNoise.h"
+#include "GensysParallel.h"
+#include "GensysPngStream.h"
+#include "GensysPyramid.h"
+#include "GensysRiverRaster.h"
+#include "GensysSparseFoliage.h"
+#include "Components/SplineComponent.h"
+#include "Landscape.h"
+#include "Editor.h"
+#include "EngineUtils.h"
+#include "ScopedTransaction.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/ScopedSlowTask.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/SecureHash.h"
+#include "ISourceControlModule.h"
+#include "SourceControlHelpers.h"
+#include "UObject/SavePackage.h"
 
 #include <fstream>
 
@@ -24,6 +54,9 @@ using json = nlohmann::json;
 
 static const FName GenSysTabName("GenSys");
 
+// params, core, copy, feature blend, detail noise, river graph, distance fields, lakes, attributes, block compression, mips, import
+static constexpr int32 GensysStageCount = 12;
+
 #define LOCTEXT_NAMESPACE "FGenSysModule"
 
 void FGenSysModule::StartupModule()
@@ -66,9 +99,21 @@ void FGenSysModule::ShutdownModule()
 	FGenSysCommands::Unregister();
 
 	FGlobalTabmanager::Get()->UnregisterNomadTabSpawner(GenSysTabName);
+
+	// the queue worker uses the module state, stop it first
+	JobQueue.Reset();
+
+	// saves already started finish writing, the packages still pending stay dirty for the editor to prompt about
+	UPackage::WaitForAsyncFileWrites();
+	PendingSaves.Reset();
+
+	// give the session buffers back before the pool goes away
+	TerrainAttributes.Reset();
+	BufferPool.Trim();
 }
 
-extern GensysParameters UserParams;
+GensysParameters UserParams;
+
 TSharedRef<SDockTab> FGenSysModule::OnSpawnPluginTab(const FSpawnTabArgs& SpawnTabArgs)
 {
 	return SNew(SDockTab)
@@ -81,9 +126,36 @@ TSharedRef<SDockTab> FGenSysModule::OnSpawnPluginTab(const FSpawnTabArgs& SpawnT
 		ARGUMENT_FIELD_NUMERIC(UserParams, Noise Octaves, ValueNoiseOctaves, "integer 0-5")
 		ARGUMENT_FIELD_NUMERIC(UserParams, Blur Radius , BlurPixelRadius, "integer 0-5")
 		ARGUMENT_FIELD_NUMERIC(UserParams, Noise Granularity , Granularity, "float 0-1")
+		ARGUMENT_FIELD_NUMERIC(UserParams, Detail Noise Octaves, DetailNoiseOctaves, "integer 0-8, 0 adds no detail")
+		ARGUMENT_FIELD_NUMERIC(UserParams, Detail Noise Cell Size, DetailNoiseCellSize, "float pixels of the first octave (16)")
+		ARGUMENT_FIELD_NUMERIC(UserParams, Detail Noise Amplitude, DetailNoiseAmplitude, "float 0-1 of the height range")
+		ARGUMENT_FIELD_NUMERIC(UserParams, Detail Noise Seed, DetailNoiseSeed, "integer")
+		ARGUMENT_FIELD_NUMERIC(UserParams, Detail Noise Mode, DetailNoiseMode, "integer 0 fBm, 1 ridged, 2 billow, 3 warped")
+		ARGUMENT_FIELD_NUMERIC(UserParams, Detail Noise Warp Strength, DetailNoiseWarpStrength, "float pixels of the largest warp")
+		ARGUMENT_CHECKBOX(UserParams, Export Every Noise Mode As Maps, ExportNoiseLayers)
 		SECTION_TITLE(Terrain)
-		ARGUMENT_FIELD_STRING(UserParams, Outline Texture Path, User_TerrainOutlineMap, "string full path (512x512)")
-		ARGUMENT_FIELD_STRING(UserParams, Forced Level Texture Path ,User_TerrainFeatureMap, "string full path (512x512)")
+		ARGUMENT_FIELD_STRING(UserParams, Outline Texture Path, User_TerrainOutlineMap, "string full path (any size)")
+		ARGUMENT_TEXTURE_ASSET(UserParams, Outline Texture Asset, User_TerrainOutlineAsset)
+		ARGUMENT_FIELD_STRING(UserParams, Forced Level Texture Path ,User_TerrainFeatureMap, "string full path (any size)")
+		ARGUMENT_TEXTURE_ASSET(UserParams, Forced Level Texture Asset, User_TerrainFeatureAsset)
+		ARGUMENT_CHECKBOX(UserParams, Blend Forced Levels Into Terrain, BlendForcedFeatures)
+		ARGUMENT_FIELD_NUMERIC(UserParams, Forced Level Blend Levels, FeatureBlendLevels, "integer pyramid levels, wider blend per level")
+		ARGUMENT_CHECKBOX(UserParams, Export Slope / Curvature / Occlusion / Normal Maps, ExportTerrainAttributes)
+		ARGUMENT_CHECKBOX(UserParams, Export River / Outline Distance Maps, ExportDistanceFields)
+		ARGUMENT_FIELD_NUMERIC(UserParams, Distance Falloff, DistanceFalloff, "float pixels")
+		ARGUMENT_CHECKBOX(UserParams, Export Lake Mask / Outlines, ExportLakes)
+		ARGUMENT_FIELD_NUMERIC(UserParams, Lake Min Depth, LakeMinDepth, "float 0-1 of the height range")
+		ARGUMENT_FIELD_NUMERIC(UserParams, Lake Min Area, LakeMinArea, "integer pixels")
+		ARGUMENT_FIELD_NUMERIC(UserParams, Attribute Height Scale, AttributeHeightScale, "float height of white in pixels (64)")
+		ARGUMENT_FIELD_NUMERIC(UserParams, Stream Maps Larger Than (MPix), OutOfCoreMegapixels, "float megapixels, 0 keeps everything in memory")
+		SECTION_TITLE(Output)
+		ARGUMENT_CHECKBOX(UserParams, Ship Prebuilt Mip Chains, GenerateMipChains)
+		ARGUMENT_CHECKBOX(UserParams, Height Mips Keep Peaks (Max), HeightMipsUseMax)
+		ARGUMENT_CHECKBOX(UserParams, Emit Block Compressed DDS (external use), EmitBlockCompressed)
+		ARGUMENT_CHECKBOX(UserParams, Skip Texture Import (batch), SkipTextureImport)
+		ARGUMENT_CHECKBOX(UserParams, Always Reimport Unchanged Outputs, AlwaysReimport)
+		ARGUMENT_CHECKBOX(UserParams, Skip Asset Saves (preview), SkipAssetSaves)
+		ARGUMENT_FIELD_STRING(UserParams, Batch Manifest Path, BatchManifestPath, "string full path of a manifest json")
 		SECTION_TITLE(River / Erosion)
 		ARGUMENT_FIELD_NUMERIC(UserParams, River Iterations, RiverGenerationIterations, "--unused--")
 		ARGUMENT_FIELD_NUMERIC(UserParams, River Resolution, RiverResolution, "float 0-1 (technically 0.90 - 1)")
@@ -91,13 +163,28 @@ TSharedRef<SDockTab> FGenSysModule::OnSpawnPluginTab(const FSpawnTabArgs& SpawnT
 		ARGUMENT_FIELD_NUMERIC(UserParams, River Erosion Strength, RiverStrengthFactor, "float 0-1")
 		ARGUMENT_CHECKBOX(UserParams, Allow Multiple Node Connections, RiverAllowNodeMismatch)
 		ARGUMENT_CHECKBOX(UserParams, Allow Rivers To Erode Forced Level, RiversOnGivenFeatures)
-		ARGUMENT_FIELD_STRING(UserParams, River Guide Texture Path, User_RiverOutline, "string full path (512x512)")
+		ARGUMENT_FIELD_NUMERIC(UserParams, River Graph Node Spacing, RiverGraphNodeSpacing, "float pixels between traced nodes")
+		ARGUMENT_CHECKBOX(UserParams, Export Traced River Graph, ExportRiverGraph)
+		ARGUMENT_CHECKBOX(UserParams, Redraw Rivers Anti-Aliased, RasteriseRivers)
+		ARGUMENT_FIELD_NUMERIC(UserParams, River Profile, RiverProfile, "0 flat, 1 parabolic, 2 V shaped")
+		ARGUMENT_FIELD_NUMERIC(UserParams, River Widening Per Flow Order, RiverOrderWidening, "float relative to the thickness")
+		ARGUMENT_CHECKBOX(UserParams, Spawn River Splines, ExportRiverSplines)
+		ARGUMENT_FIELD_NUMERIC(UserParams, River Spline Tolerance, RiverSplineTolerance, "float pixels")
+		ARGUMENT_FIELD_NUMERIC(UserParams, River Spline Units Per Pixel, RiverSplineUnitsPerPixel, "float world units")
+		ARGUMENT_FIELD_STRING(UserParams, River Guide Texture Path, User_RiverOutline, "string full path (any size)")
+		ARGUMENT_TEXTURE_ASSET(UserParams, River Guide Texture Asset, User_RiverOutlineAsset)
 		SECTION_TITLE(Layers)
 		ARGUMENT_FIELD_NUMERIC(UserParams, Number Of Terrain Layers, NumberOfTerrainLayers, "integer 1-4")
+		ARGUMENT_CHECKBOX(UserParams, Classify Layers From Rules, ClassifyTerrainLayers)
+		ARGUMENT_FIELD_STRING(UserParams, Layer Rules Path, LayerRulesPath, "string full path to a json file (up to 255 layers)")
+		ARGUMENT_FIELD_STRING(UserParams, Layer Weightmaps To Export, LayerWeightmaps, "string comma separated layer names")
 		SECTION_TITLE(Foliage)
 		ARGUMENT_FIELD_NUMERIC(UserParams, Number Of Foliage Layers, NumberOfFoliageLayers, "integer 1-4")
 		ARGUMENT_FIELD_NUMERIC(UserParams, Foliage Emptyness, FoliageWholeness, "float 0-1")
 		ARGUMENT_FIELD_NUMERIC(UserParams, Minimum Height For Foliage (unit), MinUnitFoliageHeight, "float 0-1")
+		ARGUMENT_CHECKBOX(UserParams, Build Sparse Foliage Layers, BuildSparseFoliage)
+		ARGUMENT_FIELD_STRING(UserParams, Foliage Rules Path, FoliageRulesPath, "string full path to a json file, same format as the layer rules")
+		ARGUMENT_FIELD_STRING(UserParams, Foliage Density Maps To Export, FoliageDensityMaps, "string comma separated layer names")
 		+ SVerticalBox::Slot()
 		.AutoHeight()
 		.Padding(FMargin(0, 30))
@@ -115,6 +202,28 @@ TSharedRef<SDockTab> FGenSysModule::OnSpawnPluginTab(const FSpawnTabArgs& SpawnT
 				]
 			]
 			+ SHorizontalBox::Slot()
+			.VAlign(VAlign_Top)
+			.HAlign(HAlign_Center)
+			[
+				SNew(SButton)
+				.OnClicked_Raw(this, &FGenSysModule::QueueUserParams)
+				[
+					SNew(STextBlock)
+					.Text(FText::FromString("Add To Queue"))
+				]
+			]
+			+ SHorizontalBox::Slot()
+			.VAlign(VAlign_Top)
+			.HAlign(HAlign_Center)
+			[
+				SNew(SButton)
+				.OnClicked_Raw(this, &FGenSysModule::QueueUserManifest)
+				[
+					SNew(STextBlock)
+					.Text(FText::FromString("Queue Manifest"))
+				]
+			]
+			+ SHorizontalBox::Slot()
 		]
 	];
 }
@@ -126,12 +235,163 @@ void FGenSysModule::PluginButtonClicked()
 
 FReply FGenSysModule::RunGensys()
 {
-	ExportParamsIntoJson();
-	RunGensysShell();
-	ImportGensysOutput();
+	// the core has a single input.json, wait in line behind the queued landscapes
+	if (JobQueue && JobQueue->GetNumJobs() > 0)
+		return QueueUserParams();
+
+	FGensysProgress Progress(GensysStageCount);
+	FGensysProgress::FScopedActive ActiveProgress(Progress);
+
+	// progress dialog with a cancel button, refreshed every time a stage ticks
+	FScopedSlowTask SlowTask(1.f, LOCTEXT("GensysGenerating", "Generating landscape"));
+	SlowTask.MakeDialog(true);
+
+	Progress.OnTick = [&SlowTask](const FGensysProgress& InProgress)
+	{
+		SlowTask.CompletedWork = InProgress.GetOverallFraction();
+		SlowTask.EnterProgressFrame(0.f, InProgress.GetStatusText());
+		return !SlowTask.ShouldCancel();
+	};
+
+	FGensysPreparedOutputs Outputs;
+	if (!GenerateCoreOutputs(UserParams, Progress) || !PrepareGensysOutput(UserParams, Progress, Outputs))
+		return FReply::Handled();
+
+	ImportGensysOutput(Outputs, Progress);
+
+	if (!UserParams.SkipAssetSaves)
+		SavePendingPackages();
+
+	return FReply::Handled();
+}
+
+FReply FGenSysModule::QueueUserParams()
+{
+	QueueGensys(UserParams);
+	return FReply::Handled();
+}
+
+void FGenSysModule::QueueGensys(const GensysParameters& Params)
+{
+	if (!JobQueue)
+	{
+		JobQueue = MakeUnique<FGensysJobQueue>(
+			[this](FGensysJob& Job, int32 Slot)
+			{
+				return GenerateCoreOutputs(Job.Params, Job.Progress, Slot) && PrepareGensysOutput(Job.Params, Job.Progress, Job.Outputs, Slot);
+			},
+			[this](FGensysJob& Job)
+			{
+				ImportGensysOutput(Job.Outputs, Job.Progress);
+			},
+			[this]()
+			{
+				// the whole batch is saved at once
+				SavePendingPackages();
+			});
+	}
+
+	// texture assets can only be loaded on the game thread, hand the worker the decoded guide files instead
+	GensysParameters Queued = Params;
+	const auto ResolveAsset = [this](std::string& Path, std::string& AssetPath)
+	{
+		if (AssetPath.empty())
+			return;
+
+		Path = TCHAR_TO_UTF8(*ResolveGuide(Path, AssetPath));
+		AssetPath.clear();
+	};
+	ResolveAsset(Queued.User_TerrainOutlineMap, Queued.User_TerrainOutlineAsset);
+	ResolveAsset(Queued.User_TerrainFeatureMap, Queued.User_TerrainFeatureAsset);
+	ResolveAsset(Queued.User_RiverOutline, Queued.User_RiverOutlineAsset);
+
+	JobQueue->Enqueue(Queued, GensysStageCount);
+}
+
+bool FGenSysModule::QueueBatch(const FString& ManifestPath)
+{
+	TArray<GensysParameters> Entries;
+	int32 MaxConcurrentCores = 1;
+	FString Error;
+	if (!GensysBatchManifest::Load(ManifestPath, Entries, MaxConcurrentCores, Error))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Gensys batch manifest %s: %s"), *ManifestPath, *Error);
+		return false;
+	}
+
+	// the queue is created by the first entry, an empty manifest leaves nothing to run
+	if (Entries.Num() == 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Gensys batch manifest %s has no entries"), *ManifestPath);
+		return true;
+	}
+
+	for (const GensysParameters& Entry : Entries)
+		QueueGensys(Entry);
+
+	JobQueue->EnsureWorkers(MaxConcurrentCores);
+	return true;
+}
+
+FReply FGenSysModule::QueueUserManifest()
+{
+	QueueBatch(UTF8_TO_TCHAR(UserParams.BatchManifestPath.c_str()));
 	return FReply::Handled();
 }
 
+bool FGenSysModule::GenerateCoreOutputs(const GensysParameters& Params, FGensysProgress& Progress, int32 Slot)
+{
+	Progress.BeginStage(LOCTEXT("GensysStageParams", "Exporting parameters"));
+	if (!MirrorCoreFolder(Slot))
+		return false;
+
+	ExportParamsIntoJson(Params, GetCoreFolder(Slot));
+
+	Progress.BeginStage(LOCTEXT("GensysStageCore", "Generating noise, terrain, rivers, layers and foliage"));
+	return RunGensysShell(Progress, GetCoreFolder(Slot));
+}
+
+FString FGenSysModule::GetCoreFolder(int32 Slot) const
+{
+	// extra slots run a copy of the core so several can run at once, each reads its own input.json
+	if (Slot > 0)
+		return FPaths::ConvertRelativePathToFull(FPaths::ProjectIntermediateDir() / FString::Printf(TEXT("Gensys/CoreSlot%d/"), Slot));
+
+	const FString ProjectFolder = IFileManager::Get().ConvertToAbsolutePathForExternalAppForRead(*FPaths::ProjectPluginsDir()).Append(PluginsRelativePath);
+	if (FPaths::FileExists(ProjectFolder + ExecutableName))
+		return ProjectFolder;
+
+	return IFileManager::Get().ConvertToAbsolutePathForExternalAppForRead(*FPaths::EnginePluginsDir()).Append(PluginsRelativePath);
+}
+
+bool FGenSysModule::MirrorCoreFolder(int32 Slot)
+{
+	if (Slot <= 0)
+		return true;
+
+	// copied again whenever the plugin core is updated
+	const FString Source = GetCoreFolder();
+	const FString Mirror = GetCoreFolder(Slot);
+	if (IFileManager::Get().GetTimeStamp(*(Mirror + ExecutableName)) == IFileManager::Get().GetTimeStamp(*(Source + ExecutableName)))
+		return true;
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	return PlatformFile.CreateDirectoryTree(*Mirror) && PlatformFile.CopyDirectoryTree(*Mirror, *Source, true)
+		&& IFileManager::Get().SetTimeStamp(*(Mirror + ExecutableName), IFileManager::Get().GetTimeStamp(*(Source + ExecutableName)));
+}
+
+const TArray<FString>& FGenSysModule::GetCoreOutputNames()
+{
+	static const TArray<FString> OutputNames = {
+		"FoliageMap",
+		"RiverErosionMap",
+		"TerrainLayersMap",
+		"TerrainMap"
+	};
+
+	return OutputNames;
+}
+
 void FGenSysModule::RegisterMenus()
 {
 	// Owner will be used for cleanup in call to UToolMenus::UnregisterOwner
@@ -157,52 +417,90 @@ void FGenSysModule::RegisterMenus()
 	}
 }
 
-void FGenSysModule::RunGensysShell()
+bool FGenSysModule::RunGensysShell(FGensysProgress& Progress, const FString& ExePath)
 {
-	static const FString ProjectExePath = IFileManager::Get().ConvertToAbsolutePathForExternalAppForRead(*FPaths::ProjectPluginsDir()).Append(PluginsRelativePath + ExecutableName);
-	static const bool IsInProjectFolder = FPaths::FileExists(ProjectExePath);
 
-	static const FString GensysPathProjectPlugins = IFileManager::Get().ConvertToAbsolutePathForExternalAppForRead(*FPaths::ProjectPluginsDir()).Append(PluginsRelativePath);
-	static const FString GensysPathEnginePlugins = IFileManager::Get().ConvertToAbsolutePathForExternalAppForRead(*FPaths::EnginePluginsDir()).Append(PluginsRelativePath);
+	// run the core as a child process so it can be polled and killed when the run is cancelled
+	void* ReadPipe = nullptr;
+	void* WritePipe = nullptr;
+	FPlatformProcess::CreatePipe(ReadPipe, WritePipe);
 
-	static const FString ExePath = IsInProjectFolder ? GensysPathProjectPlugins : GensysPathEnginePlugins;
-	// Append strings into a single command
-	FString command = "cd ";
-	command.Append(ExePath);
-	command.Append(" && ");
-	command.Append(ExecutableName);
+	FProcHandle Process = FPlatformProcess::CreateProc(*(ExePath + ExecutableName), TEXT(""), false, true, true, nullptr, 0, *ExePath, WritePipe);
+	if (!Process.IsValid())
+	{
+		FPlatformProcess::ClosePipe(ReadPipe, WritePipe);
+		return false;
+	}
 
-	// Have Windows system run the Gensys core process
-	system(TCHAR_TO_ANSI(*command));
+	const double StartTime = FPlatformTime::Seconds();
+	bool bCancelled = false;
+	FString Output;
+
+	while (FPlatformProcess::IsProcRunning(Process))
+	{
+		// show the last line printed by the core
+		Output += FPlatformProcess::ReadPipe(ReadPipe);
+		TArray<FString> Lines;
+		Output.ParseIntoArrayLines(Lines);
+		if (Lines.Num() > 0)
+		{
+			Progress.SetDetail(Lines.Last());
+			Output = Lines.Last();
+		}
+
+		// the core reports nothing, estimate from how long the previous run took
+		if (LastCoreSeconds > 0)
+			Progress.SetStageFraction((float)FMath::Min((FPlatformTime::Seconds() - StartTime) / LastCoreSeconds, 0.95));
+
+		if (!Progress.Tick())
+		{
+			FPlatformProcess::TerminateProc(Process, true);
+			bCancelled = true;
+			break;
+		}
+
+		FPlatformProcess::Sleep(0.02f);
+	}
+
+	FPlatformProcess::CloseProc(Process);
+	FPlatformProcess::ClosePipe(ReadPipe, WritePipe);
+
+	if (!bCancelled)
+		LastCoreSeconds = FPlatformTime::Seconds() - StartTime;
+
+	return !bCancelled;
 }
 
 #define PARSE_TO_JSON(input, dest, value) \
 	dest.emplace(#value, input.value);
 
-void FGenSysModule::ExportParamsIntoJson(const FString& path)
+#define PARSE_GUIDE_TO_JSON(input, dest, value, asset) \
+	dest.emplace(#value, std::string(TCHAR_TO_ANSI(*ResolveGuide(input.value, input.asset))));
+
+void FGenSysModule::ExportParamsIntoJson(const GensysParameters& Params, const FString& CoreFolder)
 {
 	json FileOut;
 
-	PARSE_TO_JSON(UserParams, FileOut, ValueNoiseOctaves)
-	PARSE_TO_JSON(UserParams, FileOut, BlurPixelRadius)
-	PARSE_TO_JSON(UserParams, FileOut, Granularity)
-	PARSE_TO_JSON(UserParams, FileOut, RiverGenerationIterations)
-	PARSE_TO_JSON(UserParams, FileOut, RiverResolution)
-	PARSE_TO_JSON(UserParams, FileOut, RiverThickness)
-	PARSE_TO_JSON(UserParams, FileOut, RiverAllowNodeMismatch)
-	PARSE_TO_JSON(UserParams, FileOut, RiversOnGivenFeatures)
-	PARSE_TO_JSON(UserParams, FileOut, RiverStrengthFactor)
-	PARSE_TO_JSON(UserParams, FileOut, NumberOfTerrainLayers)
-	PARSE_TO_JSON(UserParams, FileOut, NumberOfFoliageLayers)
-	PARSE_TO_JSON(UserParams, FileOut, FoliageWholeness)
-	PARSE_TO_JSON(UserParams, FileOut, MinUnitFoliageHeight)
-	PARSE_TO_JSON(UserParams, FileOut, User_TerrainOutlineMap)
-	PARSE_TO_JSON(UserParams, FileOut, User_TerrainFeatureMap)
-	PARSE_TO_JSON(UserParams, FileOut, User_RiverOutline)
-
-	FString StoragePath = IFileManager::Get().ConvertToAbsolutePathForExternalAppForRead(*FPaths::ProjectPluginsDir()).Append(PluginsRelativePath);
-	if (!FPaths::FileExists(StoragePath + ExecutableName))
-		StoragePath = IFileManager::Get().ConvertToAbsolutePathForExternalAppForRead(*FPaths::EnginePluginsDir()).Append(PluginsRelativePath);
+	FString StoragePath = CoreFolder;
+
+	PARSE_TO_JSON(Params, FileOut, ValueNoiseOctaves)
+	PARSE_TO_JSON(Params, FileOut, BlurPixelRadius)
+	PARSE_TO_JSON(Params, FileOut, Granularity)
+	PARSE_TO_JSON(Params, FileOut, RiverGenerationIterations)
+	PARSE_TO_JSON(Params, FileOut, RiverResolution)
+	PARSE_TO_JSON(Params, FileOut, RiverThickness)
+	PARSE_TO_JSON(Params, FileOut, RiverAllowNodeMismatch)
+	PARSE_TO_JSON(Params, FileOut, RiversOnGivenFeatures)
+	PARSE_TO_JSON(Params, FileOut, RiverStrengthFactor)
+	PARSE_TO_JSON(Params, FileOut, NumberOfTerrainLayers)
+	PARSE_TO_JSON(Params, FileOut, NumberOfFoliageLayers)
+	PARSE_TO_JSON(Params, FileOut, FoliageWholeness)
+	PARSE_TO_JSON(Params, FileOut, MinUnitFoliageHeight)
+
+	// guides go through the cache so the core always gets a decoded, working resolution file
+	PARSE_GUIDE_TO_JSON(Params, FileOut, User_TerrainOutlineMap, User_TerrainOutlineAsset)
+	PARSE_GUIDE_TO_JSON(Params, FileOut, User_TerrainFeatureMap, User_TerrainFeatureAsset)
+	PARSE_GUIDE_TO_JSON(Params, FileOut, User_RiverOutline, User_RiverOutlineAsset)
 
 	StoragePath.Append("input.json");
 
@@ -211,6 +509,52 @@ void FGenSysModule::ExportParamsIntoJson(const FString& path)
 	File << FileOut;
 }
 
+FString FGenSysModule::ResolveGuide(const std::string& Path, const std::string& AssetPath)
+{
+	FScopeLock ScopeLock(&GuideCacheLock);
+	FString Key;
+	return ResolveGuideLocked(Path, AssetPath, Key);
+}
+
+FString FGenSysModule::ResolveGuideLocked(const std::string& Path, const std::string& AssetPath, FString& OutKey)
+{
+	GuideCache.SetCacheFolder(GetCoreFolder() + "GuideCache");
+
+	// a texture asset wins over a file path, its source data is taken from memory
+	if (!AssetPath.empty())
+	{
+		if (UTexture2D* Texture = LoadObject<UTexture2D>(nullptr, *FString(AssetPath.data())))
+		{
+			OutKey = Texture->GetPathName();
+			return GuideCache.Resolve(Texture);
+		}
+	}
+
+	OutKey = Path.data();
+	return GuideCache.Resolve(OutKey);
+}
+
+template<typename StorageType>
+bool FGenSysModule::LoadGuideAtSize(const std::string& Path, const std::string& AssetPath, int32 Width, int32 Height, TGensysMap<StorageType>& Out)
+{
+	// the cached 16 bit source is resampled, decoded only when the guide changed
+	FScopeLock ScopeLock(&GuideCacheLock);
+
+	FString Key;
+	if (ResolveGuideLocked(Path, AssetPath, Key).IsEmpty())
+		return false;
+
+	const FGensysHeightMap* Guide = GuideCache.Sample(Key, Width, Height);
+	if (Guide == nullptr)
+		return false;
+
+	Out.Init(Width, Height, &BufferPool);
+	for (int64 Index = 0; Index < Out.Num(); ++Index)
+		Out.Set(Index, Guide->Get(Index));
+
+	return true;
+}
+
 void FGenSysModule::SetupGensysContentFolder()
 {
 	const FString ProjectFolderAbs = IFileManager::Get().ConvertToAbsolutePathForExternalAppForRead(*FPaths::ProjectContentDir());
@@ -266,29 +610,37 @@ void FGenSysModule::MoveContentData()
 	system(TCHAR_TO_ANSI(*command));
 }
 
-void FGenSysModule::ImportGensysOutput()
+// Past the threshold the attributes block streams every map through tile stores, decided from the png header alone
+static bool IsOutOfCore(const GensysParameters& Params, const FString& HeightPath)
 {
-	static const FString ProjectContentPath = IFileManager::Get().ConvertToAbsolutePathForExternalAppForRead(*FPaths::ProjectContentDir());
-	static const FString ProjectExePath = IFileManager::Get().ConvertToAbsolutePathForExternalAppForRead(*FPaths::ProjectPluginsDir()).Append(PluginsRelativePath + ExecutableName);
-	static const bool IsInProjectFolder = FPaths::FileExists(ProjectExePath);
+	int32 Width = 0;
+	int32 Height = 0;
+	return Params.OutOfCoreMegapixels > 0 && GensysImage::ReadPngSize(HeightPath, Width, Height)
+		&& (double)Width * Height > Params.OutOfCoreMegapixels * 1000000.0;
+}
+
+// Backing files of the tile stores, one set at a time since the attributes block is serialised
+static FString GetStoreFolder()
+{
+	return FPaths::ProjectIntermediateDir() / "Gensys";
+}
 
-	static const FString ProjectOutputs = IFileManager::Get().ConvertToAbsolutePathForExternalAppForRead(*FPaths::ProjectPluginsDir()).Append(PluginsRelativePath);
-	static const FString EngineOutputs = IFileManager::Get().ConvertToAbsolutePathForExternalAppForRead(*FPaths::EnginePluginsDir()).Append(PluginsRelativePath);
-	static const FString InputFolder = IsInProjectFolder ? ProjectOutputs : EngineOutputs;
+bool FGenSysModule::PrepareGensysOutput(const GensysParameters& Params, FGensysProgress& Progress, FGensysPreparedOutputs& Out, int32 Slot)
+{
+	static const FString ProjectContentPath = IFileManager::Get().ConvertToAbsolutePathForExternalAppForRead(*FPaths::ProjectContentDir());
+	const FString InputFolder = GetCoreFolder(Slot);
 
 	// The out put files to consider for removal 
-	static const TArray<FString> OutputFiles = {
-		"FoliageMap",
-		"RiverErosionMap",
-		"TerrainLayersMap",
-		"TerrainMap"
-	};
+	const TArray<FString>& OutputFiles = GetCoreOutputNames();
+
+	const FString Destination = ProjectContentPath + "Gensys/" + Params.Identifier.data();
 
-	const FString Destination = ProjectContentPath + "Gensys/" + UserParams.Identifier.data();
+	Progress.BeginStage(LOCTEXT("GensysStageCopy", "Copying outputs"));
+	Progress.Tick();
 
 	// make the relevant landscape folder in content
 	FString command = "";
-	command.Append("cd " + ProjectContentPath + "Gensys && mkdir " + UserParams.Identifier.data());
+	command.Append("cd " + ProjectContentPath + "Gensys && mkdir " + Params.Identifier.data());
 
 	// Fix paths to use backslashes
 	for(auto &character : command)
@@ -319,36 +671,1269 @@ void FGenSysModule::ImportGensysOutput()
 
 	system(TCHAR_TO_ANSI(*command));
 
+	// soften the seams of the forced levels before any detail goes on top
+	Progress.BeginStage(LOCTEXT("GensysStageFeatureBlend", "Blending forced levels"));
+	if (!Progress.Tick())
+		return false;
+
+	if (Params.BlendForcedFeatures)
+		BlendForcedFeatures(Params, Destination);
+
+	// high frequency detail the core lattice is too coarse for
+	Progress.BeginStage(LOCTEXT("GensysStageDetailNoise", "Adding detail noise"));
+	if (!Progress.Tick())
+		return false;
+
+	TArray<FString> DerivedFiles;
+	if (Params.DetailNoiseOctaves > 0 && (Params.DetailNoiseAmplitude > 0 || Params.ExportNoiseLayers))
+		ApplyDetailNoise(Params, Destination, DerivedFiles);
+
+	// the core keeps its river nodes to itself, the network is recovered from the river map
+	Progress.BeginStage(LOCTEXT("GensysStageRiverGraph", "Tracing and drawing river graph"));
+	if (!Progress.Tick())
+		return false;
+
+	if (Params.ExportRiverGraph || Params.RasteriseRivers || Params.ExportRiverSplines)
+		TraceRiverGraph(Params, Destination, Out.RiverGraph);
+
+	if (Params.RasteriseRivers)
+		RasteriseRivers(Params, Destination, Out.RiverGraph);
+
+	if (Params.ExportRiverSplines)
+		BuildRiverPolylines(Params, Destination, Out);
+
+	// falloffs away from the rivers and the coast for bank and shore shaping in the materials
+	Progress.BeginStage(LOCTEXT("GensysStageDistanceFields", "Computing distance fields"));
+	if (!Progress.Tick())
+		return false;
+
+	if (Params.ExportDistanceFields)
+		GenerateDistanceFields(Params, Destination, DerivedFiles);
+
+	// pits left by the terrain and river carving, filled up to their spill height
+	Progress.BeginStage(LOCTEXT("GensysStageLakes", "Detecting lakes"));
+	if (!Progress.Tick())
+		return false;
+
+	if (Params.ExportLakes)
+		GenerateLakes(Params, Destination, DerivedFiles);
+
+	// maps derived by the plugin from the core outputs
+	Progress.BeginStage(LOCTEXT("GensysStageAttributes", "Computing terrain attributes"));
+	if (!Progress.Tick())
+		return false;
+
+	// the attributes live on the module, concurrent core slots take turns
+	if (Params.ExportTerrainAttributes || Params.ClassifyTerrainLayers || Params.BuildSparseFoliage)
+	{
+		FScopeLock ScopeLock(&TerrainAttributesLock);
+		TerrainAttributesFolder.Empty();
+
+		// past the threshold every map of the block goes through tile stores, nothing full size is decoded
+		const bool bOutOfCore = IsOutOfCore(Params, Destination + "/TerrainMap.png");
+
+		if (Params.ExportTerrainAttributes)
+			GenerateTerrainAttributes(Params, Destination, bOutOfCore, DerivedFiles);
+
+		if (Params.ClassifyTerrainLayers)
+			ClassifyTerrainLayers(Params, Destination, bOutOfCore, DerivedFiles);
+
+		if (Params.BuildSparseFoliage)
+			BuildSparseFoliage(Params, Destination, bOutOfCore, DerivedFiles);
+
+		if (bOutOfCore)
+			CloseTerrainStores();
+	}
+
+	if (Progress.IsCancelled())
+		return false;
+
+	// GPU ready payloads for the batch consumers that never open the editor, the import below keeps using the pngs
+	Progress.BeginStage(LOCTEXT("GensysStageCompression", "Block compressing outputs"));
+	if (!Progress.Tick())
+		return false;
+
+	if (Params.EmitBlockCompressed)
+		WriteBlockCompressedOutputs(Params, Destination, OutputFiles);
+
+	Out.Folder = Destination;
+	Out.Identifier = Params.Identifier.data();
+	Out.bSkipAssetSaves = Params.SkipAssetSaves;
+
+	if (Params.SkipTextureImport)
+		return !Progress.IsCancelled();
+
+	Out.Files = OutputFiles;
+	Out.Files.Append(DerivedFiles);
+
+	// outputs identical to their imported asset keep the asset and everything that references it untouched
+	SkipUnchangedOutputs(Params, Out);
+
+	// mip pyramids built by the plugin so the editor does not have to rebuild them
+	Progress.BeginStage(LOCTEXT("GensysStageMips", "Building mip chains"));
+	if (!Progress.Tick())
+		return false;
+
+	if (Params.GenerateMipChains)
+		GenerateMipChains(Params, Destination, Out.Files, Out.MipChains);
+
+	return !Progress.IsCancelled();
+}
+
+void FGenSysModule::ImportGensysOutput(const FGensysPreparedOutputs& Outputs, FGensysProgress& Progress)
+{
 	// list of textures to import from the engine output folder (if available)
-	for (auto& fileName : OutputFiles)
-		ImportFile(Destination + "/" + fileName + ".png", FString(UserParams.Identifier.data()) + "/", fileName);
+	Progress.BeginStage(LOCTEXT("GensysStageImport", "Importing textures"));
+
+	TArray<FString> ImportedFiles;
+	for (int32 Index = 0; Index < Outputs.Files.Num(); ++Index)
+	{
+		const FString& fileName = Outputs.Files[Index];
+
+		Progress.SetStageFraction((float)Index / Outputs.Files.Num());
+		Progress.SetDetail(fileName);
+		if (!Progress.Tick())
+			break;
+
+		UObject* Imported = ImportFile(Outputs.Folder + "/" + fileName + ".png", Outputs.Identifier + "/", fileName);
+
+		if (const FGensysMipChain* Chain = Outputs.MipChains.Find(fileName))
+			ApplyMipChain(Cast<UTexture2D>(Imported), *Chain);
+
+		if (Imported)
+		{
+			ImportedFiles.Add(fileName);
+			if (!Outputs.bSkipAssetSaves)
+				PendingSaves.Add(Imported->GetPackage());
+		}
+	}
+
+	RecordImportedHashes(Outputs, ImportedFiles);
+
+	if (Progress.IsCancelled())
+		return;
+
+	if (Outputs.RiverPolylines.Num() > 0)
+		SpawnRiverSplines(Outputs);
 }
 
-void FGenSysModule::ImportFile(const FString& In, const FString& RelativeDest, const FString& Filename)
+// Content hashes of the imported outputs, next to the pngs of the landscape
+static const TCHAR* ImportHashesFile = TEXT("ImportHashes.json");
+
+// Mip settings that change the imported asset of an output, part of its hash
+// every png gets a prebuilt chain when they are on, only the heights depend on the max filter
+static FString GetMipSignature(const GensysParameters& Params, const FString& fileName)
 {
-	const FString GensysImportDest = "/Game/Gensys/" + RelativeDest + Filename;
-	UAssetImportTask* importRequest = NewObject<UAssetImportTask>();
+	if (!Params.GenerateMipChains)
+		return FString();
 
-	if (importRequest == nullptr)
+	if (fileName == "TerrainMap" && Params.HeightMipsUseMax)
+		return "+maxmips";
+
+	return "+mips";
+}
+
+void FGenSysModule::SkipUnchangedOutputs(const GensysParameters& Params, FGensysPreparedOutputs& Out)
+{
+	FString Text;
+	json Previous;
+	if (FFileHelper::LoadFileToString(Text, *(Out.Folder / ImportHashesFile)))
+		Previous = json::parse(TCHAR_TO_UTF8(*Text), nullptr, false);
+
+	TArray<FString> Changed;
+	for (const FString& fileName : Out.Files)
+	{
+		// the mips applied after the import are part of the asset too
+		const FString Hash = LexToString(FMD5Hash::HashFile(*(Out.Folder / fileName + ".png"))) + GetMipSignature(Params, fileName);
+		Out.Hashes.Add(fileName, Hash);
+
+		const std::string Key = TCHAR_TO_UTF8(*fileName);
+		const bool bSameContent = Previous.is_object() && Previous.contains(Key) && Previous[Key].is_string()
+			&& UTF8_TO_TCHAR(Previous[Key].get<std::string>().c_str()) == Hash;
+
+		// an asset deleted by hand is imported again whatever its hash
+		const FString AssetPackage = "/Game/Gensys/" + Out.Identifier + "/" + fileName;
+		if (Params.AlwaysReimport || !bSameContent || !FPackageName::DoesPackageExist(AssetPackage))
+			Changed.Add(fileName);
+	}
+
+	if (Changed.Num() < Out.Files.Num())
+		UE_LOG(LogTemp, Log, TEXT("Gensys: %d of %d outputs unchanged, not reimported"), Out.Files.Num() - Changed.Num(), Out.Files.Num());
+
+	Out.Files = MoveTemp(Changed);
+}
+
+void FGenSysModule::RecordImportedHashes(const FGensysPreparedOutputs& Outputs, const TArray<FString>& Imported)
+{
+	if (Imported.Num() == 0)
 		return;
 
-	// specify the import rules
-	importRequest->Filename = In;
-	importRequest->DestinationPath = FPaths::GetPath(GensysImportDest);
-	importRequest->DestinationName = FPaths::GetCleanFilename(GensysImportDest);
-	importRequest->bSave = true;
-	importRequest->bAutomated = true;
-	importRequest->bReplaceExisting = true;
-	importRequest->bReplaceExistingSettings = false;
+	const FString Path = Outputs.Folder / ImportHashesFile;
 
-	// load the engine module responsible for assets handling
-	FAssetToolsModule* AssetTools = FModuleManager::LoadModulePtr<FAssetToolsModule>("AssetTools");
+	FString Text;
+	json Hashes = json::object();
+	if (FFileHelper::LoadFileToString(Text, *Path))
+	{
+		json Previous = json::parse(TCHAR_TO_UTF8(*Text), nullptr, false);
+		if (Previous.is_object())
+			Hashes = MoveTemp(Previous);
+	}
 
-	if (AssetTools == nullptr)
+	for (const FString& fileName : Imported)
+	{
+		if (const FString* Hash = Outputs.Hashes.Find(fileName))
+			Hashes[TCHAR_TO_UTF8(*fileName)] = TCHAR_TO_UTF8(**Hash);
+	}
+
+	FFileHelper::SaveStringToFile(UTF8_TO_TCHAR(Hashes.dump(1, '\t').c_str()), *Path);
+}
+
+void FGenSysModule::BlendForcedFeatures(const GensysParameters& Params, const FString& Folder)
+{
+	if (Params.User_TerrainFeatureMap.empty() && Params.User_TerrainFeatureAsset.empty())
 		return;
 
-	// add the task for engine to execute
-	AssetTools->Get().ImportAssetTasks({ importRequest });
+	FGensysHeightMap HeightMap;
+	if (!GensysImage::LoadMap(Folder + "/TerrainMap.png", HeightMap, &BufferPool))
+		return;
+
+	const int32 Width = HeightMap.Width;
+	const int32 Height = HeightMap.Height;
+
+	FGensysHeightMap Features;
+	if (!LoadGuideAtSize(Params.User_TerrainFeatureMap, Params.User_TerrainFeatureAsset, Width, Height, Features))
+		return;
+
+	// black leaves the terrain free, the forced levels fall back to the terrain outside so no pit forms around them
+	FGensysMaskMap Mask;
+	Mask.Init(Width, Height, &BufferPool);
+	GensysParallel::ForRowBlocks(Height, GensysParallel::DefaultRowsPerBlock, [&](int32 RowBegin, int32 RowEnd)
+	{
+		for (int64 Index = (int64)RowBegin * Width; Index < (int64)RowEnd * Width; ++Index)
+		{
+			const bool bForced = Features.Get(Index) > 1.f / 255.f;
+			Mask.Values[Index] = bForced ? 255 : 0;
+			if (!bForced)
+				Features.Values[Index] = HeightMap.Values[Index];
+		}
+	});
+
+	// the heights are blended in their own 16 bit storage, the pyramid levels in between are half
+	FGensysHeightMap Blended;
+	GensysPyramid::Blend(HeightMap, Features, Mask, Params.FeatureBlendLevels, Blended, &BufferPool);
+
+	// the kernels skip their remaining blocks on cancel, a partial result never reaches the content folder
+	if (FGensysProgress::IsActiveCancelled())
+		return;
+
+	GensysImage::SaveMap(Folder + "/TerrainMap.png", Blended);
+}
+
+void FGenSysModule::ApplyDetailNoise(const GensysParameters& Params, const FString& Folder, TArray<FString>& OutFiles)
+{
+	FGensysHeightMap HeightMap;
+	if (!GensysImage::LoadMap(Folder + "/TerrainMap.png", HeightMap, &BufferPool))
+		return;
+
+	FGensysNoiseSettings Settings;
+	Settings.Octaves = Params.DetailNoiseOctaves;
+	Settings.CellSize = Params.DetailNoiseCellSize;
+	Settings.Seed = (uint32)Params.DetailNoiseSeed;
+	Settings.WarpStrength = Params.DetailNoiseWarpStrength;
+
+	static const TCHAR* LayerNames[] = { TEXT("NoiseFbmMap"), TEXT("NoiseRidgedMap"), TEXT("NoiseBillowMap"), TEXT("NoiseWarpedMap") };
+	static_assert(UE_ARRAY_COUNT(LayerNames) == (int32)EGensysNoiseMode::Count, "a name per noise mode");
+
+	// the exported layers come out of the same lattice evaluation as the applied one
+	const int32 AppliedMode = FMath::Clamp(Params.DetailNoiseMode, 0, (int32)EGensysNoiseMode::Count - 1);
+	FGensysHalfMap Layers[(int32)EGensysNoiseMode::Count];
+	FGensysHalfMap* RequestedLayers[(int32)EGensysNoiseMode::Count] = {};
+	for (int32 Mode = 0; Mode < (int32)EGensysNoiseMode::Count; ++Mode)
+	{
+		if (Params.ExportNoiseLayers || Mode == AppliedMode)
+			RequestedLayers[Mode] = &Layers[Mode];
+	}
+
+	GensysNoise::GenerateLayers(Settings, HeightMap.Width, HeightMap.Height, RequestedLayers, &BufferPool);
+
+	// centred on zero so the detail does not lift the whole terrain
+	const FGensysHalfMap& Noise = Layers[AppliedMode];
+	GensysParallel::ForRowBlocks(HeightMap.Height, GensysParallel::DefaultRowsPerBlock, [&](int32 RowBegin, int32 RowEnd)
+	{
+		for (int64 Index = (int64)RowBegin * HeightMap.Width; Index < (int64)RowEnd * HeightMap.Width; ++Index)
+			HeightMap.Set(Index, FMath::Clamp(HeightMap.Get(Index) + (Noise.Get(Index) - 0.5f) * Params.DetailNoiseAmplitude, 0.f, 1.f));
+	});
+
+	if (FGensysProgress::IsActiveCancelled())
+		return;
+
+	GensysImage::SaveMap(Folder + "/TerrainMap.png", HeightMap);
+
+	if (!Params.ExportNoiseLayers)
+		return;
+
+	for (int32 Mode = 0; Mode < (int32)EGensysNoiseMode::Count; ++Mode)
+	{
+		if (GensysImage::SaveMap(Folder / LayerNames[Mode] + ".png", Layers[Mode]))
+			OutFiles.Add(LayerNames[Mode]);
+	}
+}
+
+void FGenSysModule::TraceRiverGraph(const GensysParameters& Params, const FString& Folder, FGensysRiverGraph& OutGraph)
+{
+	FGensysMap RiverMap;
+	if (!GensysImage::LoadMap(Folder + "/RiverErosionMap.png", RiverMap, &BufferPool))
+		return;
+
+	FGensysRiverTraceSettings Settings;
+	Settings.NodeSpacing = FMath::Max(Params.RiverGraphNodeSpacing, 1.f);
+	Settings.MergeRadius = Settings.NodeSpacing * 3.f;
+	Settings.bMergeLooseEnds = Params.RiverAllowNodeMismatch;
+
+	GensysRiverGraph::Trace(RiverMap, Settings, OutGraph);
+	UE_LOG(LogTemp, Log, TEXT("Gensys: traced %d river nodes, %d edges (%d merged)"), OutGraph.NumNodes(), OutGraph.Edges.Num(), OutGraph.NumMerged);
+
+	if (Params.ExportRiverGraph)
+		OutGraph.SaveJson(Folder + "/RiverGraph.json");
+}
+
+void FGenSysModule::RasteriseRivers(const GensysParameters& Params, const FString& Folder, const FGensysRiverGraph& Graph)
+{
+	if (Graph.IsEmpty())
+		return;
+
+	FGensysRiverRasterSettings Settings;
+	Settings.Thickness = FMath::Max(Params.RiverThickness, 1);
+	Settings.OrderWidening = FMath::Max(Params.RiverOrderWidening, 0.f);
+	Settings.Profile = (EGensysRiverProfile)FMath::Clamp(Params.RiverProfile, 0, (int32)EGensysRiverProfile::Count - 1);
+
+	// replaces the hard edged core map, the import picks it up under the same name
+	FGensysMap RiverMap;
+	GensysRiverRaster::Rasterise(Graph, Settings, RiverMap, &BufferPool);
+	if (FGensysProgress::IsActiveCancelled())
+		return;
+
+	GensysImage::SaveMap(Folder + "/RiverErosionMap.png", RiverMap);
+}
+
+void FGenSysModule::BuildRiverPolylines(const GensysParameters& Params, const FString& Folder, FGensysPreparedOutputs& Out)
+{
+	GensysRiverSplines::ExtractPolylines(Out.RiverGraph, Out.RiverPolylines);
+	for (FGensysRiverPolyline& Polyline : Out.RiverPolylines)
+		GensysRiverSplines::Simplify(Polyline.Points, FMath::Max(Params.RiverSplineTolerance, 0.f));
+
+	Out.RiverUnitsPerPixel = Params.RiverSplineUnitsPerPixel;
+	GensysRiverSplines::SaveJson(Out.RiverPolylines, Out.RiverGraph.Width, Out.RiverGraph.Height, Folder + "/RiverSplines.json");
+}
+
+void FGenSysModule::SpawnRiverSplines(const FGensysPreparedOutputs& Outputs)
+{
+	UWorld* World = GEditor ? GEditor->GetEditorWorldContext().World() : nullptr;
+	if (!World)
+		return;
+
+	const FString Label = "GensysRivers_" + Outputs.Identifier;
+
+	// the landscape built from this TerrainMap places the splines, its label carries the identifier when there are several
+	ALandscape* Landscape = nullptr;
+	int32 NumLandscapes = 0;
+	for (TActorIterator<ALandscape> It(World); It; ++It)
+	{
+		++NumLandscapes;
+		if (!Landscape || It->GetActorLabel().Contains(Outputs.Identifier))
+			Landscape = *It;
+	}
+	if (NumLandscapes > 1 && !Landscape->GetActorLabel().Contains(Outputs.Identifier))
+		Landscape = nullptr;
+
+	FGensysHeightMap HeightMap;
+	if (Landscape && !GensysImage::LoadMap(Outputs.Folder + "/TerrainMap.png", HeightMap, &BufferPool))
+		Landscape = nullptr;
+
+	if (!Landscape)
+		UE_LOG(LogTemp, Warning, TEXT("Gensys: no landscape found for %s, the river splines are flat at Z=0 and need projecting onto the terrain"), *Outputs.Identifier);
+
+	// a single undoable step however many rivers there are, regenerating replaces the previous actor
+	const FScopedTransaction Transaction(LOCTEXT("GensysSpawnRiverSplines", "Spawn Gensys River Splines"));
+
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		if (It->GetActorLabel() == Label)
+			World->EditorDestroyActor(*It, true);
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.ObjectFlags = RF_Transactional;
+	AActor* Actor = World->SpawnActor<AActor>(SpawnParams);
+	Actor->SetActorLabel(Label);
+
+	USceneComponent* Root = NewObject<USceneComponent>(Actor, "Root", RF_Transactional);
+	Actor->SetRootComponent(Root);
+	Actor->AddInstanceComponent(Root);
+
+	// the points are in landscape space (a vertex per TerrainMap pixel), the actor takes its transform
+	if (Landscape)
+		Actor->SetActorTransform(Landscape->GetActorTransform());
+
+	// river graph pixels to TerrainMap pixels, the two maps may differ in size
+	const FVector2f GraphToTerrain = Landscape
+		? FVector2f((float)HeightMap.Width / FMath::Max(Outputs.RiverGraph.Width, 1), (float)HeightMap.Height / FMath::Max(Outputs.RiverGraph.Height, 1))
+		: FVector2f::UnitVector;
+
+	const auto ToLocal = [&](const FVector2f& Point)
+	{
+		if (!Landscape)
+			return FVector(Point.X, Point.Y, 0.f) * Outputs.RiverUnitsPerPixel;
+
+		// pixel centres to vertices, heights bilinear in the same 16 bit encoding the landscape imports
+		const float X = FMath::Clamp(Point.X * GraphToTerrain.X - 0.5f, 0.f, HeightMap.Width - 1.f);
+		const float Y = FMath::Clamp(Point.Y * GraphToTerrain.Y - 0.5f, 0.f, HeightMap.Height - 1.f);
+		const int32 X0 = FMath::FloorToInt(X);
+		const int32 Y0 = FMath::FloorToInt(Y);
+		const float Height = FMath::BiLerp(HeightMap.AtClamped(X0, Y0), HeightMap.AtClamped(X0 + 1, Y0),
+			HeightMap.AtClamped(X0, Y0 + 1), HeightMap.AtClamped(X0 + 1, Y0 + 1), X - X0, Y - Y0);
+
+		// landscape heights are centred on 32768 with 128 steps per unit before the actor scale
+		return FVector(X, Y, (Height * 65535.f - 32768.f) / 128.f);
+	};
+
+	for (int32 Index = 0; Index < Outputs.RiverPolylines.Num(); ++Index)
+	{
+		const FGensysRiverPolyline& Polyline = Outputs.RiverPolylines[Index];
+
+		TArray<FVector> Points;
+		Points.Reserve(Polyline.Points.Num());
+		for (const FVector2f& Point : Polyline.Points)
+			Points.Add(ToLocal(Point));
+
+		USplineComponent* Spline = NewObject<USplineComponent>(Actor, *FString::Printf(TEXT("River%d_Order%d"), Index, Polyline.Order), RF_Transactional);
+		Spline->SetupAttachment(Root);
+
+		// the curve is only rebuilt once all of its points are in
+		Spline->SetSplinePoints(Points, ESplineCoordinateSpace::Local, false);
+		Spline->SetClosedLoop(Polyline.bClosed, false);
+		Spline->UpdateSpline();
+
+		Actor->AddInstanceComponent(Spline);
+	}
+
+	Actor->RegisterAllComponents();
+	Actor->PostEditChange();
+}
+
+void FGenSysModule::GenerateDistanceFields(const GensysParameters& Params, const FString& Folder, TArray<FString>& OutFiles)
+{
+	FGensysMap Distance;
+	if (!ComputeRiverProximity(Params, Folder, Distance))
+		return;
+
+	const float Falloff = FMath::Max(Params.DistanceFalloff, 1.f);
+	const int32 Width = Distance.Width;
+	const int32 Height = Distance.Height;
+
+	if (GensysImage::SaveMap(Folder + "/RiverFalloffMap.png", Distance))
+		OutFiles.Add("RiverFalloffMap");
+
+	if (Params.User_TerrainOutlineMap.empty() && Params.User_TerrainOutlineAsset.empty())
+		return;
+
+	// the guide is at working resolution, the falloff is wanted at the output one
+	FGensysMaskMap Outline;
+	if (!LoadGuideAtSize(Params.User_TerrainOutlineMap, Params.User_TerrainOutlineAsset, Width, Height, Outline))
+		return;
+
+	// 0.5 on the coast, brighter inland
+	GensysDistanceField::ComputeSigned(Outline, 0.5f, Distance, &BufferPool);
+	if (FGensysProgress::IsActiveCancelled())
+		return;
+
+	for (int64 Index = 0; Index < Distance.Num(); ++Index)
+		Distance.Set(Index, FMath::Clamp(0.5f - Distance.Get(Index) / (2.f * Falloff), 0.f, 1.f));
+
+	if (GensysImage::SaveMap(Folder + "/OutlineDistanceMap.png", Distance))
+		OutFiles.Add("OutlineDistanceMap");
+}
+
+void FGenSysModule::GenerateLakes(const GensysParameters& Params, const FString& Folder, TArray<FString>& OutFiles)
+{
+	FGensysHeightMap HeightMap;
+	if (!GensysImage::LoadMap(Folder + "/TerrainMap.png", HeightMap, &BufferPool))
+		return;
+
+	FGensysLakeSettings Settings;
+	Settings.MinDepth = Params.LakeMinDepth;
+	Settings.MinArea = Params.LakeMinArea;
+
+	FGensysMaskMap LakeMask;
+	TArray<FGensysLake> Lakes;
+	GensysLakes::Detect(HeightMap, Settings, LakeMask, Lakes, &BufferPool);
+	if (FGensysProgress::IsActiveCancelled())
+		return;
+
+	UE_LOG(LogTemp, Log, TEXT("Gensys: %d lakes"), Lakes.Num());
+
+	if (GensysImage::SaveMap(Folder + "/LakeMaskMap.png", LakeMask))
+		OutFiles.Add("LakeMaskMap");
+
+	GensysLakes::SaveJson(Lakes, HeightMap.Width, HeightMap.Height, Folder + "/Lakes.json");
+}
+
+void FGenSysModule::GenerateTerrainAttributes(const GensysParameters& Params, const FString& Folder, bool bOutOfCore, TArray<FString>& OutFiles)
+{
+	if (bOutOfCore)
+	{
+		if (!EnsureTerrainStores(Params, Folder))
+			return;
+
+		// encoded a row of tiles at a time straight from their store
+		const TPair<FGensysMaskTileStore*, const TCHAR*> Outputs[] = {
+			{ &TerrainAttributeStores.Slope, TEXT("TerrainSlopeMap") },
+			{ &TerrainAttributeStores.Curvature, TEXT("TerrainCurvatureMap") },
+			{ &TerrainAttributeStores.Occlusion, TEXT("TerrainOcclusionMap") }
+		};
+
+		for (const TPair<FGensysMaskTileStore*, const TCHAR*>& Output : Outputs)
+		{
+			if (GensysImage::SaveStore(Folder / Output.Value + ".png", *Output.Key, &BufferPool))
+				OutFiles.Add(Output.Value);
+		}
+
+		// the normal map packs both stores, a band of rows of each at a time
+		const int32 Width = TerrainAttributeStores.NormalX.GetWidth();
+		const int32 Height = TerrainAttributeStores.NormalX.GetHeight();
+		FGensysPngWriter NormalWriter;
+		if (NormalWriter.Open(Folder + "/TerrainNormalMap.png", Width, Height, 4, 8))
+		{
+			FGensysMaskMap NormalX, NormalY;
+			for (int32 RowBegin = 0; RowBegin < Height; RowBegin += TerrainAttributeStores.NormalX.GetTileSize())
+			{
+				if (FGensysProgress::IsActiveCancelled())
+					break;
+
+				const FIntRect Rows(0, RowBegin, Width, FMath::Min(RowBegin + TerrainAttributeStores.NormalX.GetTileSize(), Height));
+				TerrainAttributeStores.NormalX.ReadWindow(Rows, NormalX, &BufferPool);
+				TerrainAttributeStores.NormalY.ReadWindow(Rows, NormalY, &BufferPool);
+				if (!GensysTerrainAttributes::WriteNormalRows(NormalX, NormalY, NormalWriter))
+					break;
+			}
+
+			// short of rows when cancelled or failed, the file is then removed
+			if (NormalWriter.Close())
+				OutFiles.Add("TerrainNormalMap");
+		}
+		return;
+	}
+
+	// one fused pass, the results stay on the module for the later stages
+	FGensysHeightMap HeightMap;
+	if (!GensysImage::LoadMap(Folder + "/TerrainMap.png", HeightMap, &BufferPool))
+		return;
+
+	EnsureTerrainAttributes(Params, Folder, HeightMap);
+
+	// half computed attributes are neither saved nor reused by the later stages
+	if (TerrainAttributesFolder != Folder)
+		return;
+
+	if (GensysImage::SaveMap(Folder + "/TerrainSlopeMap.png", TerrainAttributes.Slope))
+		OutFiles.Add("TerrainSlopeMap");
+
+	if (GensysImage::SaveMap(Folder + "/TerrainCurvatureMap.png", TerrainAttributes.Curvature))
+		OutFiles.Add("TerrainCurvatureMap");
+
+	if (GensysImage::SaveMap(Folder + "/TerrainOcclusionMap.png", TerrainAttributes.Occlusion))
+		OutFiles.Add("TerrainOcclusionMap");
+
+	FGensysPngWriter NormalWriter;
+	if (NormalWriter.Open(Folder + "/TerrainNormalMap.png", TerrainAttributes.NormalX.Width, TerrainAttributes.NormalX.Height, 4, 8)
+		&& GensysTerrainAttributes::WriteNormalRows(TerrainAttributes.NormalX, TerrainAttributes.NormalY, NormalWriter) && NormalWriter.Close())
+		OutFiles.Add("TerrainNormalMap");
+}
+
+void FGenSysModule::EnsureTerrainAttributes(const GensysParameters& Params, const FString& Folder, const FGensysHeightMap& HeightMap)
+{
+	// already there when this generation exported them
+	if (TerrainAttributesFolder == Folder)
+		return;
+
+	GensysTerrainAttributes::Compute(HeightMap, Params.AttributeHeightScale, TerrainAttributes, &BufferPool);
+	if (!FGensysProgress::IsActiveCancelled())
+		TerrainAttributesFolder = Folder;
+}
+
+bool FGenSysModule::EnsureTerrainStores(const GensysParameters& Params, const FString& Folder)
+{
+	if (TerrainAttributesFolder == Folder)
+		return true;
+
+	// the heights are decoded into their store a row of tiles at a time, the stages read them back by windows
+	const FString StoreFolder = GetStoreFolder();
+	if (!GensysImage::LoadStore(Folder + "/TerrainMap.png", StoreFolder / "TerrainMap.tiles", TerrainHeightStore, &BufferPool))
+		return false;
+
+	// every result tile goes straight to disk, nothing full size is held while the attributes are computed
+	const int32 Width = TerrainHeightStore.GetWidth();
+	const int32 Height = TerrainHeightStore.GetHeight();
+	if (!TerrainAttributeStores.Slope.Create(StoreFolder / "TerrainSlopeMap.tiles", Width, Height, TerrainHeightStore.GetTileSize())
+		|| !TerrainAttributeStores.Curvature.Create(StoreFolder / "TerrainCurvatureMap.tiles", Width, Height, TerrainHeightStore.GetTileSize())
+		|| !TerrainAttributeStores.Occlusion.Create(StoreFolder / "TerrainOcclusionMap.tiles", Width, Height, TerrainHeightStore.GetTileSize())
+		|| !TerrainAttributeStores.NormalX.Create(StoreFolder / "TerrainNormalXMap.tiles", Width, Height, TerrainHeightStore.GetTileSize())
+		|| !TerrainAttributeStores.NormalY.Create(StoreFolder / "TerrainNormalYMap.tiles", Width, Height, TerrainHeightStore.GetTileSize()))
+		return false;
+
+	GensysTerrainAttributes::ComputeStreamed(TerrainHeightStore, Params.AttributeHeightScale, TerrainAttributeStores, &BufferPool);
+
+	if (FGensysProgress::IsActiveCancelled() || !TerrainAttributeStores.Slope.Finalize() || !TerrainAttributeStores.Curvature.Finalize()
+		|| !TerrainAttributeStores.Occlusion.Finalize() || !TerrainAttributeStores.NormalX.Finalize() || !TerrainAttributeStores.NormalY.Finalize())
+		return false;
+
+	TerrainAttributesFolder = Folder;
+	return true;
+}
+
+void FGenSysModule::CloseTerrainStores()
+{
+	TerrainHeightStore.Close();
+	TerrainAttributeStores.Slope.Close();
+	TerrainAttributeStores.Curvature.Close();
+	TerrainAttributeStores.Occlusion.Close();
+	TerrainAttributeStores.NormalX.Close();
+	TerrainAttributeStores.NormalY.Close();
+	RiverProximityStore.Close();
+
+	TerrainAttributesFolder.Empty();
+}
+
+bool FGenSysModule::ComputeRiverProximity(const GensysParameters& Params, const FString& Folder, FGensysMap& Out)
+{
+	FGensysMap RiverMap;
+	if (!GensysImage::LoadMap(Folder + "/RiverErosionMap.png", RiverMap, &BufferPool))
+		return false;
+
+	// 1 on the channels down to 0 a falloff away from them
+	const float Falloff = FMath::Max(Params.DistanceFalloff, 1.f);
+	GensysDistanceField::Compute(RiverMap, 0.5f, Out, &BufferPool);
+	if (FGensysProgress::IsActiveCancelled())
+		return false;
+
+	for (int64 Index = 0; Index < Out.Num(); ++Index)
+		Out.Set(Index, 1.f - FMath::Min(Out.Get(Index) / Falloff, 1.f));
+
+	return true;
+}
+
+bool FGenSysModule::ComputeRiverProximityStreamed(const GensysParameters& Params, const FString& Folder)
+{
+	const FString StoreFolder = GetStoreFolder();
+	FGensysHeightTileStore RiverStore;
+	if (!GensysImage::LoadStore(Folder + "/RiverErosionMap.png", StoreFolder / "RiverErosionMap.tiles", RiverStore, &BufferPool))
+		return false;
+
+	const int32 Width = RiverStore.GetWidth();
+	const int32 Height = RiverStore.GetHeight();
+	const int32 TileSize = RiverStore.GetTileSize();
+	if (!RiverProximityStore.Create(StoreFolder / "RiverProximity.tiles", Width, Height, TileSize))
+		return false;
+
+	// the proximity is 0 past the falloff, a channel further than that from a band of rows cannot change it,
+	// so each band only needs the falloff worth of rows above and below it
+	const float Falloff = FMath::Max(Params.DistanceFalloff, 1.f);
+	const int32 Halo = FMath::CeilToInt(Falloff);
+
+	FGensysHeightMap Window, Rows;
+	FGensysMap Distances;
+	for (int32 TileY = 0; TileY < RiverProximityStore.GetNumTilesY(); ++TileY)
+	{
+		if (FGensysProgress::IsActiveCancelled())
+			return false;
+
+		const int32 RowBegin = TileY * TileSize;
+		const int32 RowEnd = FMath::Min(RowBegin + TileSize, Height);
+		const int32 WindowBegin = FMath::Max(RowBegin - Halo, 0);
+
+		RiverStore.ReadWindow(FIntRect(0, WindowBegin, Width, FMath::Min(RowEnd + Halo, Height)), Window, &BufferPool);
+		GensysDistanceField::Compute(Window, 0.5f, Distances, &BufferPool);
+
+		Rows.Init(Width, RowEnd - RowBegin, &BufferPool);
+		const int64 Offset = (int64)(RowBegin - WindowBegin) * Width;
+		for (int64 Index = 0; Index < Rows.Num(); ++Index)
+			Rows.Set(Index, 1.f - FMath::Min(Distances.Get(Offset + Index) / Falloff, 1.f));
+
+		RiverProximityStore.WriteTileRow(TileY, Rows);
+	}
+
+	return RiverProximityStore.Finalize();
+}
+
+void FGenSysModule::ClassifyTerrainLayers(const GensysParameters& Params, const FString& Folder, bool bOutOfCore, TArray<FString>& OutFiles)
+{
+	TArray<FGensysLayerRule> Rules;
+	FString Error;
+	if (!GensysLayerClassification::LoadRules(UTF8_TO_TCHAR(Params.LayerRulesPath.c_str()), Rules, Error))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Gensys layer rules %s: %s"), UTF8_TO_TCHAR(Params.LayerRulesPath.c_str()), *Error);
+		return;
+	}
+
+	// full weightmaps only for the layers that need one, the top-k pair covers the rest
+	TArray<FString> Requested;
+	TArray<TPair<int32, FString>> Weightmaps;
+	FString(UTF8_TO_TCHAR(Params.LayerWeightmaps.c_str())).ParseIntoArray(Requested, TEXT(","));
+	for (FString& Name : Requested)
+	{
+		Name.TrimStartAndEndInline();
+		const int32 Layer = Rules.IndexOfByPredicate([&Name](const FGensysLayerRule& Rule) { return Rule.Name == Name; });
+		if (Layer != INDEX_NONE)
+			Weightmaps.Emplace(Layer, "TerrainLayer" + Name + "Map");
+	}
+
+	if (bOutOfCore)
+	{
+		ClassifyTerrainLayersStreamed(Params, Folder, Rules, Weightmaps, OutFiles);
+		return;
+	}
+
+	FGensysHeightMap HeightMap;
+	if (!GensysImage::LoadMap(Folder + "/TerrainMap.png", HeightMap, &BufferPool))
+		return;
+
+	EnsureTerrainAttributes(Params, Folder, HeightMap);
+
+	FGensysMap RiverProximity;
+	ComputeRiverProximity(Params, Folder, RiverProximity);
+
+	FGensysLayerWeights Layers;
+	GensysLayerClassification::Classify(Rules, HeightMap, TerrainAttributes.Slope, RiverProximity.IsEmpty() ? nullptr : &RiverProximity, Layers, &BufferPool);
+	if (FGensysProgress::IsActiveCancelled())
+		return;
+
+	if (Layers.Save(Folder + "/TerrainLayerIdsMap.png", Folder + "/TerrainLayerWeightsMap.png"))
+	{
+		OutFiles.Add("TerrainLayerIdsMap");
+		OutFiles.Add("TerrainLayerWeightsMap");
+	}
+
+	for (const TPair<int32, FString>& Weightmap : Weightmaps)
+	{
+		FGensysMaskMap Weights;
+		Layers.ExtractLayer(Weightmap.Key, Weights, &BufferPool);
+
+		if (GensysImage::SaveMap(Folder / Weightmap.Value + ".png", Weights))
+			OutFiles.Add(Weightmap.Value);
+	}
+}
+
+void FGenSysModule::ClassifyTerrainLayersStreamed(const GensysParameters& Params, const FString& Folder, const TArray<FGensysLayerRule>& Rules,
+	const TArray<TPair<int32, FString>>& Weightmaps, TArray<FString>& OutFiles)
+{
+	if (!EnsureTerrainStores(Params, Folder))
+		return;
+
+	const bool bHasRivers = ComputeRiverProximityStreamed(Params, Folder);
+	const int32 Width = TerrainHeightStore.GetWidth();
+	const int32 Height = TerrainHeightStore.GetHeight();
+
+	// every png is written a band of rows at a time as the bands are classified
+	FGensysPngWriter IdsWriter, WeightsWriter;
+	IdsWriter.Open(Folder + "/TerrainLayerIdsMap.png", Width, Height, 4, 8);
+	WeightsWriter.Open(Folder + "/TerrainLayerWeightsMap.png", Width, Height, 4, 8);
+
+	TArray<TUniquePtr<FGensysPngWriter>> WeightmapWriters;
+	for (const TPair<int32, FString>& Weightmap : Weightmaps)
+	{
+		WeightmapWriters.Add(MakeUnique<FGensysPngWriter>());
+		WeightmapWriters.Last()->Open(Folder / Weightmap.Value + ".png", Width, Height, 1, 16);
+	}
+
+	FGensysHeightMap Heights, RiverRows;
+	FGensysMaskMap Slope, Weights;
+	FGensysMap RiverProximity;
+	FGensysLayerWeights Band;
+
+	for (int32 RowBegin = 0; RowBegin < Height; RowBegin += TerrainHeightStore.GetTileSize())
+	{
+		if (FGensysProgress::IsActiveCancelled())
+			break;
+
+		const FIntRect Rows(0, RowBegin, Width, FMath::Min(RowBegin + TerrainHeightStore.GetTileSize(), Height));
+		TerrainHeightStore.ReadWindow(Rows, Heights, &BufferPool);
+		TerrainAttributeStores.Slope.ReadWindow(Rows, Slope, &BufferPool);
+
+		if (bHasRivers)
+		{
+			RiverProximityStore.ReadWindow(Rows, RiverRows, &BufferPool);
+			RiverProximity.Init(RiverRows.Width, RiverRows.Height, &BufferPool);
+			for (int64 Index = 0; Index < RiverRows.Num(); ++Index)
+				RiverProximity.Set(Index, RiverRows.Get(Index));
+		}
+
+		GensysLayerClassification::Classify(Rules, Heights, Slope, bHasRivers ? &RiverProximity : nullptr, Band, &BufferPool);
+
+		// a layer per RGBA channel, the layout FGensysLayerWeights::Save writes
+		for (int32 Y = 0; Y < Band.Height; ++Y)
+		{
+			const int64 RowStart = (int64)Y * Width * FGensysLayerWeights::LayersPerPixel;
+			IdsWriter.WriteRow(&Band.Ids[RowStart]);
+			WeightsWriter.WriteRow(&Band.Weights[RowStart]);
+		}
+
+		for (int32 Index = 0; Index < Weightmaps.Num(); ++Index)
+		{
+			Band.ExtractLayer(Weightmaps[Index].Key, Weights, &BufferPool);
+			WeightmapWriters[Index]->WriteRows(Weights);
+		}
+	}
+
+	// a writer short of rows (cancelled or failed) removes its file
+	const bool bIdsWritten = IdsWriter.Close();
+	const bool bWeightsWritten = WeightsWriter.Close();
+	if (bIdsWritten && bWeightsWritten)
+	{
+		OutFiles.Add("TerrainLayerIdsMap");
+		OutFiles.Add("TerrainLayerWeightsMap");
+	}
+
+	for (int32 Index = 0; Index < Weightmaps.Num(); ++Index)
+	{
+		if (WeightmapWriters[Index]->Close())
+			OutFiles.Add(Weightmaps[Index].Value);
+	}
+}
+
+// Splits the first NumChannels channels of a png into a mask store each, a row of tiles at a time
+static bool LoadChannelStores(const FString& Path, int32 NumChannels, FGensysMaskTileStore* OutStores, FGensysBufferPool* Pool)
+{
+	FGensysPngReader Reader;
+	if (!Reader.Open(Path))
+		return false;
+
+	const int32 Width = Reader.GetWidth();
+	const int32 Height = Reader.GetHeight();
+	for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+	{
+		if (!OutStores[Channel].Create(GetStoreFolder() / FString::Printf(TEXT("%s%d.tiles"), *FPaths::GetBaseFilename(Path), Channel), Width, Height))
+			return false;
+	}
+
+	TArray64<uint8> Row;
+	Row.SetNumUninitialized(Reader.GetRowBytes());
+	TArray<FGensysMaskMap> Bands;
+	Bands.SetNum(NumChannels);
+
+	// 16 bit files are rounded to 8 bit, the densities are bytes
+	const int32 BytesPerSample = Reader.GetBitDepth() / 8;
+	const int32 TileSize = OutStores[0].GetTileSize();
+	for (int32 TileY = 0; TileY < OutStores[0].GetNumTilesY(); ++TileY)
+	{
+		const int32 NumRows = FMath::Min(TileSize, Height - TileY * TileSize);
+		for (FGensysMaskMap& Band : Bands)
+			Band.Init(Width, NumRows, Pool);
+
+		for (int32 Y = 0; Y < NumRows; ++Y)
+		{
+			if (FGensysProgress::IsActiveCancelled() || !Reader.ReadRow(Row.GetData()))
+				return false;
+
+			for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+			{
+				uint8* Values = &Bands[Channel].Values[(int64)Y * Width];
+				for (int32 X = 0; X < Width; ++X)
+				{
+					const int64 Sample = ((int64)X * 4 + Channel) * BytesPerSample;
+					Values[X] = BytesPerSample == 2 ? TGensysStorage<uint8>::Encode(TGensysStorage<uint16>::Decode(*(const uint16*)&Row[Sample])) : Row[Sample];
+				}
+			}
+		}
+
+		for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+			OutStores[Channel].WriteTileRow(TileY, Bands[Channel]);
+	}
+
+	for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+	{
+		if (!OutStores[Channel].Finalize())
+			return false;
+	}
+	return true;
+}
+
+// Pixels of a foliage tile, clipped to the map
+static FIntRect GetFoliageTileRect(const FGensysSparseFoliage& Foliage, int32 TileX, int32 TileY)
+{
+	const FIntPoint Min(TileX * FGensysSparseFoliage::TileSize, TileY * FGensysSparseFoliage::TileSize);
+	return FIntRect(Min, FIntPoint(FMath::Min(Min.X + FGensysSparseFoliage::TileSize, Foliage.Width), FMath::Min(Min.Y + FGensysSparseFoliage::TileSize, Foliage.Height)));
+}
+
+void FGenSysModule::BuildSparseFoliage(const GensysParameters& Params, const FString& Folder, bool bOutOfCore, TArray<FString>& OutFiles)
+{
+	int32 Width = 0;
+	int32 Height = 0;
+	if (!GensysImage::ReadPngSize(Folder + "/TerrainMap.png", Width, Height))
+		return;
+
+	FGensysSparseFoliage Foliage;
+	Foliage.Init(Width, Height);
+
+	// the core layers come packed in the channels of the foliage map
+	const int32 NumCoreLayers = FMath::Clamp(Params.NumberOfFoliageLayers, 1, 4);
+	if (bOutOfCore)
+	{
+		// a store per channel, filled as the png is decoded, every tile reads its window back
+		FGensysMaskTileStore CoreStores[4];
+		if (LoadChannelStores(Folder + "/FoliageMap.png", NumCoreLayers, CoreStores, &BufferPool) && CoreStores[0].GetWidth() == Width && CoreStores[0].GetHeight() == Height)
+		{
+			for (int32 Channel = 0; Channel < NumCoreLayers; ++Channel)
+			{
+				Foliage.AddLayer(FString::Printf(TEXT("Core%d"), Channel), [&](int32 TileX, int32 TileY, uint8* OutDensities)
+				{
+					FGensysMaskMap Window;
+					CoreStores[Channel].ReadWindow(GetFoliageTileRect(Foliage, TileX, TileY), Window);
+
+					for (int32 Y = 0; Y < Window.Height; ++Y)
+						FMemory::Memcpy(OutDensities + Y * FGensysSparseFoliage::TileSize, &Window.Values[(int64)Y * Window.Width], Window.Width);
+				});
+			}
+		}
+	}
+	else
+	{
+		FImage FoliageImage;
+		if (FImageUtils::LoadImage(*(Folder + "/FoliageMap.png"), FoliageImage) && FoliageImage.SizeX == Width && FoliageImage.SizeY == Height)
+		{
+			FoliageImage.ChangeFormat(ERawImageFormat::BGRA8, EGammaSpace::Linear);
+			const FColor* Texels = FoliageImage.AsBGRA8().GetData();
+
+			for (int32 Channel = 0; Channel < NumCoreLayers; ++Channel)
+			{
+				Foliage.AddLayer(FString::Printf(TEXT("Core%d"), Channel), [&](int32 TileX, int32 TileY, uint8* OutDensities)
+				{
+					const FIntRect Rect = GetFoliageTileRect(Foliage, TileX, TileY);
+
+					for (int32 Y = Rect.Min.Y; Y < Rect.Max.Y; ++Y)
+					{
+						const FColor* Row = Texels + (int64)Y * Width;
+						for (int32 X = Rect.Min.X; X < Rect.Max.X; ++X)
+						{
+							const FColor& Texel = Row[X];
+							OutDensities[(Y - Rect.Min.Y) * FGensysSparseFoliage::TileSize + X - Rect.Min.X] = Channel == 0 ? Texel.R : Channel == 1 ? Texel.G : Channel == 2 ? Texel.B : Texel.A;
+						}
+					}
+				});
+			}
+		}
+	}
+
+	// any number of extra layers from rules on height, slope and river proximity, evaluated tile by tile
+	TArray<FGensysLayerRule> Rules;
+	FString Error;
+	if (!Params.FoliageRulesPath.empty() && !GensysLayerClassification::LoadRules(UTF8_TO_TCHAR(Params.FoliageRulesPath.c_str()), Rules, Error))
+		UE_LOG(LogTemp, Error, TEXT("Gensys foliage rules %s: %s"), UTF8_TO_TCHAR(Params.FoliageRulesPath.c_str()), *Error);
+
+	if (Rules.Num() > 0 && bOutOfCore)
+	{
+		if (!EnsureTerrainStores(Params, Folder))
+			return;
+
+		const bool bHasRivers = ComputeRiverProximityStreamed(Params, Folder);
+
+		for (const FGensysLayerRule& Rule : Rules)
+		{
+			Foliage.AddLayer(Rule.Name, [&](int32 TileX, int32 TileY, uint8* OutDensities)
+			{
+				const FIntRect Rect = GetFoliageTileRect(Foliage, TileX, TileY);
+				FGensysHeightMap Heights, RiverProximity;
+				FGensysMaskMap Slope;
+				TerrainHeightStore.ReadWindow(Rect, Heights);
+				TerrainAttributeStores.Slope.ReadWindow(Rect, Slope);
+				if (bHasRivers)
+					RiverProximityStore.ReadWindow(Rect, RiverProximity);
+
+				for (int32 Y = 0; Y < Rect.Height(); ++Y)
+				{
+					for (int32 X = 0; X < Rect.Width(); ++X)
+					{
+						const int64 Index = (int64)Y * Rect.Width() + X;
+						const float Density = GensysLayerClassification::Evaluate(Rule, Heights.Get(Index), Slope.Get(Index), bHasRivers ? RiverProximity.Get(Index) : 0.f);
+						OutDensities[Y * FGensysSparseFoliage::TileSize + X] = TGensysStorage<uint8>::Encode(Density);
+					}
+				}
+			});
+		}
+	}
+	else if (Rules.Num() > 0)
+	{
+		FGensysHeightMap HeightMap;
+		if (!GensysImage::LoadMap(Folder + "/TerrainMap.png", HeightMap, &BufferPool))
+			return;
+
+		EnsureTerrainAttributes(Params, Folder, HeightMap);
+
+		FGensysMap RiverProximity;
+		const bool bHasRivers = ComputeRiverProximity(Params, Folder, RiverProximity);
+
+		for (const FGensysLayerRule& Rule : Rules)
+		{
+			Foliage.AddLayer(Rule.Name, [&](int32 TileX, int32 TileY, uint8* OutDensities)
+			{
+				const FIntRect Rect = GetFoliageTileRect(Foliage, TileX, TileY);
+
+				for (int32 Y = Rect.Min.Y; Y < Rect.Max.Y; ++Y)
+				{
+					for (int32 X = Rect.Min.X; X < Rect.Max.X; ++X)
+					{
+						const int64 Index = (int64)Y * Width + X;
+						const float Density = GensysLayerClassification::Evaluate(Rule, HeightMap.Get(Index), TerrainAttributes.Slope.Get(Index),
+							bHasRivers ? RiverProximity.Get(Index) : 0.f);
+						OutDensities[(Y - Rect.Min.Y) * FGensysSparseFoliage::TileSize + X - Rect.Min.X] = TGensysStorage<uint8>::Encode(Density);
+					}
+				}
+			});
+		}
+	}
+
+	if (FGensysProgress::IsActiveCancelled())
+		return;
+
+	const int64 DenseBytes = (int64)Foliage.Layers.Num() * Width * Height;
+	UE_LOG(LogTemp, Log, TEXT("Gensys: %d foliage layers, %.1f MB sparse against %.1f MB dense"), Foliage.Layers.Num(),
+		Foliage.GetAllocatedSize() / (1024.0 * 1024.0), DenseBytes / (1024.0 * 1024.0));
+
+	Foliage.Save(Folder + "/FoliageLayers.gfsp");
+
+	// dense maps only for the layers still consumed as textures, encoded a band of rows at a time so no dense layer is ever whole
+	TArray<FString> Requested;
+	FString(UTF8_TO_TCHAR(Params.FoliageDensityMaps.c_str())).ParseIntoArray(Requested, TEXT(","));
+	for (FString& Name : Requested)
+	{
+		Name.TrimStartAndEndInline();
+		const int32 Layer = Foliage.LayerNames.IndexOfByKey(Name);
+		if (Layer == INDEX_NONE)
+			continue;
+
+		const FString FileName = "Foliage" + Name + "Map";
+		FGensysPngWriter Writer;
+		if (!Writer.Open(Folder / FileName + ".png", Width, Height, 1, 16))
+			continue;
+
+		FGensysMaskMap Densities;
+		for (int32 RowBegin = 0; RowBegin < Height && !FGensysProgress::IsActiveCancelled(); RowBegin += FGensysSparseFoliage::TileSize)
+		{
+			Foliage.ExtractRows(Layer, RowBegin, FMath::Min(RowBegin + FGensysSparseFoliage::TileSize, Height), Densities, &BufferPool);
+			if (!Writer.WriteRows(Densities))
+				break;
+		}
+
+		if (Writer.Close())
+			OutFiles.Add(FileName);
+	}
+}
+
+// filter used when building the mips of an output
+static EGensysMipFilter GetMipFilter(const FString& fileName)
+{
+	// the layer ID and weight pair is built with GensysMipChain::BuildIdWeightPair
+	if (fileName == "TerrainLayersMap")
+		return EGensysMipFilter::Mode;
+
+	if (fileName == "FoliageMap")
+		return EGensysMipFilter::Coverage;
+
+	return EGensysMipFilter::Average;
+}
+
+void FGenSysModule::GenerateMipChains(const GensysParameters& Params, const FString& Folder, const TArray<FString>& Files, TMap<FString, FGensysMipChain>& OutChains)
+{
+	// the layer IDs and their weights are reduced together, a pair imported only in part still gets matching mips
+	const TCHAR* LayerPair[] = { TEXT("TerrainLayerIdsMap"), TEXT("TerrainLayerWeightsMap") };
+	if (Files.Contains(LayerPair[0]) || Files.Contains(LayerPair[1]))
+	{
+		FImage Images[2];
+		if (FImageUtils::LoadImage(*(Folder / LayerPair[0] + ".png"), Images[0]) && FImageUtils::LoadImage(*(Folder / LayerPair[1] + ".png"), Images[1])
+			&& Images[0].SizeX == Images[1].SizeX && Images[0].SizeY == Images[1].SizeY)
+		{
+			Images[0].ChangeFormat(ERawImageFormat::BGRA8, Images[0].GammaSpace);
+			Images[1].ChangeFormat(ERawImageFormat::BGRA8, Images[1].GammaSpace);
+
+			FGensysMipChain Chains[2];
+			GensysMipChain::BuildIdWeightPair(Images[0], Images[1], Chains[0], Chains[1]);
+
+			for (int32 Index = 0; Index < 2; ++Index)
+			{
+				if (Files.Contains(LayerPair[Index]))
+					OutChains.Add(LayerPair[Index], MoveTemp(Chains[Index]));
+			}
+		}
+	}
+
+	for (auto& fileName : Files)
+	{
+		if (FGensysProgress::IsActiveCancelled())
+			return;
+
+		if (fileName == LayerPair[0] || fileName == LayerPair[1])
+			continue;
+
+		const FString Path = Folder + "/" + fileName + ".png";
+
+		// heights are kept at 16 bits, everything else goes through BGRA8
+		if (fileName == "TerrainMap")
+		{
+			FGensysHeightMap HeightMap;
+			if (GensysImage::LoadMap(Path, HeightMap, &BufferPool))
+				GensysMipChain::Build(HeightMap, Params.HeightMipsUseMax ? EGensysMipFilter::Max : EGensysMipFilter::Average, OutChains.Add(fileName));
+
+			continue;
+		}
+
+		FImage Image;
+		if (!FImageUtils::LoadImage(*Path, Image))
+			continue;
+
+		// keep the stored bits as they are, no gamma conversion
+		Image.ChangeFormat(ERawImageFormat::BGRA8, Image.GammaSpace);
+		GensysMipChain::Build(Image, GetMipFilter(fileName), OutChains.Add(fileName));
+	}
+}
+
+void FGenSysModule::WriteBlockCompressedOutputs(const GensysParameters& Params, const FString& Folder, const TArray<FString>& Files)
+{
+	for (auto& fileName : Files)
+	{
+		FImage Image;
+		if (!FImageUtils::LoadImage(*(Folder + "/" + fileName + ".png"), Image))
+			continue;
+
+		Image.ChangeFormat(ERawImageFormat::BGRA8, Image.GammaSpace);
+
+		FGensysMipChain Chain;
+		GensysMipChain::Build(Image, GetMipFilter(fileName), Chain);
+		if (FGensysProgress::IsActiveCancelled())
+			return;
+
+		// single channel maps go to BC4, packed masks to BC5 while they fit in two channels
+		EGensysBlockFormat Format = EGensysBlockFormat::BC4;
+		if (fileName == "TerrainLayersMap")
+			Format = Params.NumberOfTerrainLayers <= 2 ? EGensysBlockFormat::BC5 : EGensysBlockFormat::BC7;
+		else if (fileName == "FoliageMap")
+			Format = Params.NumberOfFoliageLayers <= 2 ? EGensysBlockFormat::BC5 : EGensysBlockFormat::BC7;
+
+		GensysBlockCompression::WriteDDS(Folder + "/" + fileName + ".dds", Chain, Format);
+	}
+}
+
+void FGenSysModule::ApplyMipChain(UTexture2D* Texture, const FGensysMipChain& Chain)
+{
+	if (Texture == nullptr || Chain.IsEmpty())
+		return;
+
+	// the asset keeps the source format it was imported with, the chain is converted level by level when it differs
+	const ETextureSourceFormat ChainFormat = Chain.BytesPerPixel == 2 ? TSF_G16 : TSF_BGRA8;
+	const ETextureSourceFormat SourceFormat = Texture->Source.GetFormat();
+
+	TArray64<uint8> Converted;
+	if (SourceFormat != ChainFormat)
+	{
+		const ERawImageFormat::Type ChainRawFormat = FImageCoreUtils::ConvertToRawImageFormat(ChainFormat);
+		const ERawImageFormat::Type SourceRawFormat = FImageCoreUtils::ConvertToRawImageFormat(SourceFormat);
+
+		const uint8* Level = Chain.Data.GetData();
+		for (int32 Mip = 0; Mip < Chain.NumMips; ++Mip)
+		{
+			const int32 Width = FMath::Max(Chain.Width >> Mip, 1);
+			const int32 Height = FMath::Max(Chain.Height >> Mip, 1);
+
+			// stored values are data, no gamma conversion either way
+			FImage LevelImage;
+			FImageView((void*)Level, Width, Height, 1, ChainRawFormat, EGammaSpace::Linear).CopyTo(LevelImage, SourceRawFormat, EGammaSpace::Linear);
+			Converted.Append(LevelImage.RawData);
+
+			Level += (int64)Width * Height * Chain.BytesPerPixel;
+		}
+	}
+
+	// replace the imported source with the full pyramid and tell the texture build to keep it
+	Texture->PreEditChange(nullptr);
+	Texture->Source.Init(Chain.Width, Chain.Height, 1, Chain.NumMips, SourceFormat, Converted.Num() > 0 ? Converted.GetData() : Chain.Data.GetData());
+	Texture->MipGenSettings = TMGS_LeaveExistingMips;
+	Texture->PostEditChange();
+	Texture->MarkPackageDirty();
+}
+
+void FGenSysModule::SavePendingPackages()
+{
+	TArray<UPackage*> Packages;
+	TArray<FString> Filenames;
+	for (const TWeakObjectPtr<UPackage>& Package : PendingSaves)
+	{
+		if (!Package.IsValid() || !Package->IsDirty())
+			continue;
+
+		Packages.Add(Package.Get());
+		Filenames.Add(FPackageName::LongPackageNameToFilename(Package->GetName(), FPackageName::GetAssetPackageExtension()));
+	}
+	PendingSaves.Reset();
+
+	if (Packages.Num() == 0)
+		return;
+
+	// a single source control round trip for the files that already exist, the new ones are added after the save
+	const bool bSourceControl = ISourceControlModule::Get().IsEnabled();
+	TArray<FString> NewFiles;
+	if (bSourceControl)
+	{
+		TArray<FString> ExistingFiles;
+		for (const FString& Filename : Filenames)
+			(FPaths::FileExists(Filename) ? ExistingFiles : NewFiles).Add(Filename);
+
+		if (ExistingFiles.Num() > 0)
+			SourceControlHelpers::CheckOutFiles(ExistingFiles, true);
+	}
+
+	// serialised here, written to disk in the background
+	for (int32 Index = 0; Index < Packages.Num(); ++Index)
+	{
+		FSavePackageArgs SaveArgs;
+		SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+		SaveArgs.SaveFlags = SAVE_Async | SAVE_NoError;
+		UPackage::SavePackage(Packages[Index], nullptr, *Filenames[Index], SaveArgs);
+	}
+
+	if (NewFiles.Num() > 0)
+	{
+		UPackage::WaitForAsyncFileWrites();
+		SourceControlHelpers::MarkFilesForAdd(NewFiles, true);
+	}
+}
+
+UObject* FGenSysModule::ImportFile(const FString& In, const FString& RelativeDest, const FString& Filename)
+{
+	const FString GensysImportDest = "/Game/Gensys/" + RelativeDest + Filename;
+	UAssetImportTask* importRequest = NewObject<UAssetImportTask>();
+
+	if (importRequest == nullptr)
+		return nullptr;
+
+	// specify the import rules
+	importRequest->Filename = In;
+	importRequest->DestinationPath = FPaths::GetPath(GensysImportDest);
+	importRequest->DestinationName = FPaths::GetCleanFilename(GensysImportDest);
+	// saved later together with the rest of the job
+	importRequest->bSave = false;
+	importRequest->bAutomated = true;
+	importRequest->bReplaceExisting = true;
+	importRequest->bReplaceExistingSettings = false;
+
+	// load the engine module responsible for assets handling
+	FAssetToolsModule* AssetTools = FModuleManager::LoadModulePtr<FAssetToolsModule>("AssetTools");
+
+	if (AssetTools == nullptr)
+		return nullptr;
+
+	// add the task for engine to execute
+	AssetTools->Get().ImportAssetTasks({ importRequest });
+
+	const TArray<UObject*>& Imported = importRequest->GetObjects();
+	return Imported.Num() > 0 ? Imported[0] : nullptr;
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -0,0 +1,86 @@
+#include "GensysBatchManifest.h"
+#include "GensysParametersJson.h"
+#include "GenSys.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+
+using json = nlohmann::json;
+
+bool GensysBatchManifest::Load(const FString& Path, TArray<GensysParameters>& OutEntries, int32& OutMaxConcurrentCores, FString& OutError)
+{
+	FString Text;
+	if (!FFileHelper::LoadFileToString(Text, *Path))
+	{
+		OutError = TEXT("cannot be read");
+		return false;
+	}
+
+	const json Manifest = json::parse(TCHAR_TO_UTF8(*Text), nullptr, false);
+	if (!Manifest.is_object() || !Manifest.contains("Entries") || !Manifest["Entries"].is_array())
+	{
+		OutError = TEXT("expected an object with an Entries array");
+		return false;
+	}
+
+	int32 MaxConcurrentCores = 1;
+	if (!GensysJson::Read(Manifest, "MaxConcurrentCores", MaxConcurrentCores, OutError))
+		return false;
+
+	OutMaxConcurrentCores = FMath::Clamp(MaxConcurrentCores, 1, MaxCoreSlots);
+
+	GensysParameters Defaults;
+	if (Manifest.contains("Defaults") && !ParseParamsFromJson(Manifest["Defaults"], Defaults, OutError))
+	{
+		OutError = TEXT("Defaults: ") + OutError;
+		return false;
+	}
+
+	const FString ManifestFolder = FPaths::GetPath(FPaths::ConvertRelativePathToFull(Path));
+	const auto MakeAbsolute = [&ManifestFolder](std::string& GuidePath)
+	{
+		if (!GuidePath.empty())
+			GuidePath = TCHAR_TO_UTF8(*FPaths::ConvertRelativePathToFull(ManifestFolder, UTF8_TO_TCHAR(GuidePath.c_str())));
+	};
+
+	TSet<FString> Identifiers;
+	for (const json& Entry : Manifest["Entries"])
+	{
+		GensysParameters& Params = OutEntries.Add_GetRef(Defaults);
+		if (!ParseParamsFromJson(Entry, Params, OutError))
+		{
+			OutError = FString::Printf(TEXT("entry %d: %s"), OutEntries.Num() - 1, *OutError);
+			OutEntries.Empty();
+			return false;
+		}
+
+		MakeAbsolute(Params.User_TerrainOutlineMap);
+		MakeAbsolute(Params.User_TerrainFeatureMap);
+		MakeAbsolute(Params.User_RiverOutline);
+		MakeAbsolute(Params.LayerRulesPath);
+		MakeAbsolute(Params.FoliageRulesPath);
+
+		// every entry lands in its own content folder
+		bool bDuplicate = false;
+		Identifiers.Add(UTF8_TO_TCHAR(Params.Identifier.c_str()), &bDuplicate);
+		if (bDuplicate)
+		{
+			OutError = FString::Printf(TEXT("identifier %s is used by more than one entry"), UTF8_TO_TCHAR(Params.Identifier.c_str()));
+			OutEntries.Empty();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+namespace
+{
+	FAutoConsoleCommand BatchCommand(
+		TEXT("Gensys.Batch"),
+		TEXT("Queues every landscape of a batch manifest. Args: <Manifest>"),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			if (Args.Num() > 0)
+				FGenSysModule::Get().QueueBatch(Args[0]);
+		}));
+}
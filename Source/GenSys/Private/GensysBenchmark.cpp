@@ -0,0 +1,234 @@
+#include "GensysBenchmark.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/FileHelper.h"
+#include "GensysParallel.h"
+#include "GensysNoise.h"
+#include "GensysJson.h"
+
+using json = nlohmann::json;
+
+DEFINE_LOG_CATEGORY_STATIC(LogGensysBenchmark, Log, All);
+
+FGensysBenchmarkStage::FGensysBenchmarkStage(const char* InName, bool bInThreaded, FSetup InSetup)
+	: Name(InName), bThreaded(bInThreaded), Setup(MoveTemp(InSetup))
+{
+	GetRegistry().Add(this);
+}
+
+TArray<const FGensysBenchmarkStage*>& FGensysBenchmarkStage::GetRegistry()
+{
+	// filled during static initialisation, the order of the translation units is not defined
+	static TArray<const FGensysBenchmarkStage*> Registry;
+	return Registry;
+}
+
+TArray<const FGensysBenchmarkStage*> FGensysBenchmarkStage::GetAll()
+{
+	TArray<const FGensysBenchmarkStage*> Stages = GetRegistry();
+	Stages.Sort([](const FGensysBenchmarkStage& A, const FGensysBenchmarkStage& B) { return FCStringAnsi::Strcmp(A.Name, B.Name) < 0; });
+	return Stages;
+}
+
+// Stage micro benchmark, run from the editor console:
+//   Gensys.Benchmark [MaxResolution=8192] [Tolerance=0.1]
+// Every registered stage (see GensysBenchmark.h) runs at each resolution with 1..N workers, the report goes to
+// Saved/Gensys/Benchmark.json and is compared against Saved/Gensys/BenchmarkBaseline.json (a previous report copied over)
+// when it exists
+namespace
+{
+	const int32 Resolutions[] = { 256, 512, 2048, 8192 };
+
+	// best of, to filter out the noise of a busy editor
+	constexpr int32 Repetitions = 3;
+
+	struct FBenchmarkResult
+	{
+		std::string Stage;
+		int32 Resolution = 0;
+		int32 Workers = 0;
+		double Seconds = 0;
+		double MegapixelsPerSecond = 0;
+		double ScalingEfficiency = 1;
+		// physical memory the stage still holds after its first timed run (its outputs and caches), MB
+		double UsedPhysicalDeltaMB = 0;
+		bool bRegressed = false;
+	};
+
+	void MakeInputs(int32 Resolution, const FString& Folder, FGensysBenchmarkInputs& Out)
+	{
+		Out.Resolution = Resolution;
+		Out.ScratchFolder = Folder;
+		Out.Heights.Init(Resolution, Resolution);
+
+		for (int32 Y = 0; Y < Resolution; ++Y)
+		{
+			for (int32 X = 0; X < Resolution; ++X)
+			{
+				const float U = (float)X / Resolution;
+				const float V = (float)Y / Resolution;
+				const float Rolling = 0.5f + 0.25f * FMath::Sin(U * 13.f) * FMath::Cos(V * 11.f) + 0.15f * FMath::Sin((U + V) * 41.f);
+				const float Grain = (float)(((uint32)X * 73856093u ^ (uint32)Y * 19349663u) & 0xff) / 255.f * 0.05f;
+				Out.Heights.Set(X, Y, Rolling + Grain);
+			}
+		}
+
+		Out.RiverMap.Init(Resolution, Resolution);
+		for (int64 Index = 0; Index < Out.Heights.Num(); ++Index)
+			Out.RiverMap.Set(Index, FMath::Abs(Out.Heights.Get(Index) - 0.5f) < 0.01f ? 1.f : 0.f);
+
+		Out.Colour.Init(Resolution, Resolution, ERawImageFormat::RGBA32F, EGammaSpace::Linear);
+		TArrayView64<FLinearColor> ColourPixels = Out.Colour.AsRGBA32F();
+		for (int64 Index = 0; Index < Out.Heights.Num(); ++Index)
+			ColourPixels[Index] = FLinearColor(Out.Heights.Get(Index), 1.f - Out.Heights.Get(Index), Out.Heights.Get(Index) * 0.5f, 1.f);
+
+		Out.Colour.CopyTo(Out.ColourBGRA8, ERawImageFormat::BGRA8, EGammaSpace::Linear);
+	}
+
+	double TimeBestOf(const TFunction<void()>& Run)
+	{
+		double Best = MAX_dbl;
+		for (int32 Repetition = 0; Repetition < Repetitions; ++Repetition)
+		{
+			const double Start = FPlatformTime::Seconds();
+			Run();
+			Best = FMath::Min(Best, FPlatformTime::Seconds() - Start);
+		}
+		return Best;
+	}
+
+	TArray<int32> GetWorkerCounts()
+	{
+		const int32 MaxWorkers = FPlatformMisc::NumberOfWorkerThreadsToSpawn() + 1;
+
+		TArray<int32> Counts;
+		for (int32 Workers = 1; Workers < MaxWorkers; Workers *= 2)
+			Counts.Add(Workers);
+		Counts.Add(MaxWorkers);
+		return Counts;
+	}
+
+	void RunBenchmark(const TArray<FString>& Args)
+	{
+		const int32 MaxResolution = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 8192;
+		const float Tolerance = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 0.1f;
+		const FString Folder = FPaths::ProjectSavedDir() / "Gensys";
+		const TArray<int32> WorkerCounts = GetWorkerCounts();
+		const TArray<const FGensysBenchmarkStage*> Stages = FGensysBenchmarkStage::GetAll();
+		IFileManager::Get().MakeDirectory(*Folder, true);
+
+		TArray<FBenchmarkResult> Results;
+		UE_LOG(LogGensysBenchmark, Display, TEXT("Noise kernel %s, %d stages"), GensysNoise::GetKernelName(GensysNoise::GetBestKernel()), Stages.Num());
+
+		for (int32 Resolution : Resolutions)
+		{
+			if (Resolution > MaxResolution)
+				break;
+
+			const FString ScratchFolder = Folder / FString::Printf(TEXT("Benchmark_%d"), Resolution);
+			IFileManager::Get().MakeDirectory(*ScratchFolder, true);
+
+			FGensysBenchmarkInputs Inputs;
+			MakeInputs(Resolution, ScratchFolder, Inputs);
+
+			for (const FGensysBenchmarkStage* Stage : Stages)
+			{
+				FGensysBenchmarkStage::FBody Body = Stage->Setup(Inputs);
+				const uint64 UsedBefore = FPlatformMemory::GetStats().UsedPhysical;
+				TOptional<double> UsedPhysicalDeltaMB;
+				double SingleWorkerSeconds = 0;
+
+				for (int32 Workers : WorkerCounts)
+				{
+					if (!Stage->bThreaded && Workers != WorkerCounts.Last())
+						continue;
+
+					GensysParallel::FScopedMaxWorkers ScopedWorkers(Workers);
+
+					FBenchmarkResult& Result = Results.AddDefaulted_GetRef();
+					Result.Stage = Stage->Name;
+					Result.Resolution = Resolution;
+					Result.Workers = Workers;
+					Result.Seconds = TimeBestOf(Body);
+					Result.MegapixelsPerSecond = (double)Resolution * Resolution / 1000000.0 / FMath::Max(Result.Seconds, 1e-9);
+
+					// the later runs reuse what the first one allocated, every row reports the first delta
+					if (!UsedPhysicalDeltaMB)
+						UsedPhysicalDeltaMB = ((double)FPlatformMemory::GetStats().UsedPhysical - (double)UsedBefore) / (1024.0 * 1024.0);
+					Result.UsedPhysicalDeltaMB = *UsedPhysicalDeltaMB;
+
+					if (Workers == 1)
+						SingleWorkerSeconds = Result.Seconds;
+
+					if (Stage->bThreaded && SingleWorkerSeconds > 0)
+						Result.ScalingEfficiency = SingleWorkerSeconds / (Workers * Result.Seconds);
+				}
+			}
+
+			IFileManager::Get().DeleteDirectory(*ScratchFolder, false, true);
+		}
+
+		// compare with the accepted baseline, a stage regressed when its throughput drops past the tolerance
+		json Baseline;
+		FString BaselineText;
+		if (FFileHelper::LoadFileToString(BaselineText, *(Folder / "BenchmarkBaseline.json")))
+			Baseline = json::parse(TCHAR_TO_UTF8(*BaselineText), nullptr, false);
+
+		json Report;
+		Report["Tolerance"] = Tolerance;
+		Report["NoiseKernel"] = TCHAR_TO_UTF8(GensysNoise::GetKernelName(GensysNoise::GetBestKernel()));
+		Report["Results"] = json::array();
+
+		int32 NumRegressed = 0;
+		for (FBenchmarkResult& Result : Results)
+		{
+			if (Baseline.is_object() && Baseline.contains("Results"))
+			{
+				for (const json& Previous : Baseline["Results"])
+				{
+					// a hand edited baseline with mistyped fields is skipped entry by entry
+					std::string Stage;
+					int32 PreviousResolution = 0;
+					int32 PreviousWorkers = 0;
+					double PreviousThroughput = 0;
+					FString Error;
+					if (!GensysJson::Read(Previous, "Stage", Stage, Error) || !GensysJson::Read(Previous, "Resolution", PreviousResolution, Error)
+						|| !GensysJson::Read(Previous, "Workers", PreviousWorkers, Error) || !GensysJson::Read(Previous, "MegapixelsPerSecond", PreviousThroughput, Error))
+						continue;
+
+					if (Stage == Result.Stage && PreviousResolution == Result.Resolution && PreviousWorkers == Result.Workers)
+						Result.bRegressed = Result.MegapixelsPerSecond < PreviousThroughput * (1.0 - Tolerance);
+				}
+			}
+
+			NumRegressed += Result.bRegressed;
+
+			Report["Results"].push_back({
+				{ "Stage", Result.Stage },
+				{ "Resolution", Result.Resolution },
+				{ "Workers", Result.Workers },
+				{ "Seconds", Result.Seconds },
+				{ "MegapixelsPerSecond", Result.MegapixelsPerSecond },
+				{ "ScalingEfficiency", Result.ScalingEfficiency },
+				{ "UsedPhysicalDeltaMB", Result.UsedPhysicalDeltaMB },
+				{ "Regressed", Result.bRegressed }
+			});
+
+			UE_LOG(LogGensysBenchmark, Display, TEXT("%-18s %5d px %2d workers %9.2f MPix/s  efficiency %.2f  %+8.1f MB%s"),
+				UTF8_TO_TCHAR(Result.Stage.c_str()), Result.Resolution, Result.Workers, Result.MegapixelsPerSecond, Result.ScalingEfficiency, Result.UsedPhysicalDeltaMB,
+				Result.bRegressed ? TEXT("  REGRESSED") : TEXT(""));
+		}
+
+		Report["Regressions"] = NumRegressed;
+
+		const FString ReportPath = Folder / "Benchmark.json";
+		FFileHelper::SaveStringToFile(UTF8_TO_TCHAR(Report.dump(1, '\t').c_str()), *ReportPath);
+
+		UE_LOG(LogGensysBenchmark, Display, TEXT("Report written to %s, %d regression(s)"), *ReportPath, NumRegressed);
+	}
+
+	FAutoConsoleCommand BenchmarkCommand(
+		TEXT("Gensys.Benchmark"),
+		TEXT("Benchmarks the Gensys plugin stages. Args: [MaxResolution=8192] [Tolerance=0.1]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&RunBenchmark));
+}
@@ -0,0 +1,317 @@
+#include "GensysBlockCompression.h"
+#include "GensysMipChain.h"
+#include "GensysParallel.h"
+#include "Misc/FileHelper.h"
+#include "GensysBenchmark.h"
+
+namespace
+{
+	// DXGI formats used in the DX10 extended header
+	constexpr uint32 DXGI_FORMAT_BC4_UNORM = 80;
+	constexpr uint32 DXGI_FORMAT_BC5_UNORM = 83;
+	constexpr uint32 DXGI_FORMAT_BC7_UNORM = 98;
+
+	// BC7 4 bit index interpolation weights
+	constexpr int32 BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// Gathers a 4x4 block, texels past the border repeat the last row/column
+	void FetchBlock(const FColor* Pixels, int32 Width, int32 Height, int32 BlockX, int32 BlockY, FColor (&OutBlock)[16])
+	{
+		for (int32 Y = 0; Y < 4; ++Y)
+		{
+			const int32 SourceY = FMath::Min(BlockY * 4 + Y, Height - 1);
+			for (int32 X = 0; X < 4; ++X)
+				OutBlock[Y * 4 + X] = Pixels[(int64)SourceY * Width + FMath::Min(BlockX * 4 + X, Width - 1)];
+		}
+	}
+
+	// 8 value BC4 block between the block min and max
+	void EncodeBC4(const uint8 (&Values)[16], uint8* Out)
+	{
+		uint8 Max = 0;
+		uint8 Min = 255;
+		for (uint8 Value : Values)
+		{
+			Max = FMath::Max(Max, Value);
+			Min = FMath::Min(Min, Value);
+		}
+
+		Out[0] = Max;
+		Out[1] = Min;
+
+		uint64 Indices = 0;
+		if (Max > Min)
+		{
+			for (int32 Texel = 0; Texel < 16; ++Texel)
+			{
+				// position along the ramp from red0 (0) to red1 (7), then remapped to the BC4 index order
+				const int32 Position = (((int32)Max - Values[Texel]) * 7 + (Max - Min) / 2) / (Max - Min);
+				const uint64 Index = Position == 0 ? 0 : Position == 7 ? 1 : Position + 1;
+				Indices |= Index << (Texel * 3);
+			}
+		}
+
+		for (int32 Byte = 0; Byte < 6; ++Byte)
+			Out[2 + Byte] = (uint8)(Indices >> (Byte * 8));
+	}
+
+	// LSB first writer for the 128 bit BC7 block
+	struct FBlockBitWriter
+	{
+		uint64 Bits[2] = {};
+		int32 Position = 0;
+
+		void Put(uint32 Value, int32 Count)
+		{
+			for (int32 Bit = 0; Bit < Count; ++Bit, ++Position)
+				Bits[Position / 64] |= (uint64)((Value >> Bit) & 1) << (Position % 64);
+		}
+	};
+
+	// BC7 mode 6, one subset, 7 bit RGBA endpoints with a p-bit each and 4 bit indices
+	void EncodeBC7(const FColor (&Block)[16], uint8* Out)
+	{
+		float Texels[16][4];
+		float Mean[4] = {};
+		for (int32 Texel = 0; Texel < 16; ++Texel)
+		{
+			Texels[Texel][0] = Block[Texel].R;
+			Texels[Texel][1] = Block[Texel].G;
+			Texels[Texel][2] = Block[Texel].B;
+			Texels[Texel][3] = Block[Texel].A;
+
+			for (int32 Channel = 0; Channel < 4; ++Channel)
+				Mean[Channel] += Texels[Texel][Channel] / 16.f;
+		}
+
+		// principal axis of the block by power iteration on the covariance
+		float Covariance[4][4] = {};
+		for (int32 Texel = 0; Texel < 16; ++Texel)
+			for (int32 Row = 0; Row < 4; ++Row)
+				for (int32 Column = 0; Column < 4; ++Column)
+					Covariance[Row][Column] += (Texels[Texel][Row] - Mean[Row]) * (Texels[Texel][Column] - Mean[Column]);
+
+		float Axis[4] = { 1.f, 1.f, 1.f, 1.f };
+		for (int32 Iteration = 0; Iteration < 4; ++Iteration)
+		{
+			float Next[4] = {};
+			float Length = 0.f;
+			for (int32 Row = 0; Row < 4; ++Row)
+			{
+				for (int32 Column = 0; Column < 4; ++Column)
+					Next[Row] += Covariance[Row][Column] * Axis[Column];
+				Length += Next[Row] * Next[Row];
+			}
+
+			// flat block, any axis will do
+			if (Length < KINDA_SMALL_NUMBER)
+				break;
+
+			Length = FMath::InvSqrt(Length);
+			for (int32 Channel = 0; Channel < 4; ++Channel)
+				Axis[Channel] = Next[Channel] * Length;
+		}
+
+		float MinT = 0.f;
+		float MaxT = 0.f;
+		for (int32 Texel = 0; Texel < 16; ++Texel)
+		{
+			float T = 0.f;
+			for (int32 Channel = 0; Channel < 4; ++Channel)
+				T += (Texels[Texel][Channel] - Mean[Channel]) * Axis[Channel];
+
+			MinT = FMath::Min(MinT, T);
+			MaxT = FMath::Max(MaxT, T);
+		}
+
+		// quantise both endpoints to 7 bits, picking the p-bit with the smaller error
+		uint32 Quantised[2][4] = {};
+		uint32 PBits[2] = {};
+		int32 Endpoints[2][4];
+		for (int32 Endpoint = 0; Endpoint < 2; ++Endpoint)
+		{
+			const float T = Endpoint == 0 ? MinT : MaxT;
+			float BestError = MAX_flt;
+
+			for (uint32 PBit = 0; PBit < 2; ++PBit)
+			{
+				uint32 Candidate[4];
+				float Error = 0.f;
+				for (int32 Channel = 0; Channel < 4; ++Channel)
+				{
+					const float Value = FMath::Clamp(Mean[Channel] + Axis[Channel] * T, 0.f, 255.f);
+					Candidate[Channel] = (uint32)FMath::Clamp(FMath::RoundToInt((Value - PBit) * 0.5f), 0, 127);
+					Error += FMath::Square(Value - (float)((Candidate[Channel] << 1) | PBit));
+				}
+
+				if (Error < BestError)
+				{
+					BestError = Error;
+					PBits[Endpoint] = PBit;
+					FMemory::Memcpy(Quantised[Endpoint], Candidate, sizeof(Candidate));
+				}
+			}
+
+			for (int32 Channel = 0; Channel < 4; ++Channel)
+				Endpoints[Endpoint][Channel] = (Quantised[Endpoint][Channel] << 1) | PBits[Endpoint];
+		}
+
+		uint32 Indices[16] = {};
+		for (int32 Texel = 0; Texel < 16; ++Texel)
+		{
+			int32 BestError = MAX_int32;
+			for (uint32 Index = 0; Index < 16; ++Index)
+			{
+				int32 Error = 0;
+				for (int32 Channel = 0; Channel < 4; ++Channel)
+				{
+					const int32 Palette = ((64 - BC7Weights[Index]) * Endpoints[0][Channel] + BC7Weights[Index] * Endpoints[1][Channel] + 32) >> 6;
+					Error += FMath::Square(Palette - (int32)Texels[Texel][Channel]);
+				}
+
+				if (Error < BestError)
+				{
+					BestError = Error;
+					Indices[Texel] = Index;
+				}
+			}
+		}
+
+		// the anchor index has an implicit zero top bit, flip the ramp if needed
+		if (Indices[0] & 8)
+		{
+			Swap(Quantised[0], Quantised[1]);
+			Swap(PBits[0], PBits[1]);
+			for (uint32& Index : Indices)
+				Index = 15 - Index;
+		}
+
+		FBlockBitWriter Writer;
+		Writer.Put(1 << 6, 7);
+		for (int32 Channel = 0; Channel < 4; ++Channel)
+		{
+			Writer.Put(Quantised[0][Channel], 7);
+			Writer.Put(Quantised[1][Channel], 7);
+		}
+		Writer.Put(PBits[0], 1);
+		Writer.Put(PBits[1], 1);
+
+		Writer.Put(Indices[0], 3);
+		for (int32 Texel = 1; Texel < 16; ++Texel)
+			Writer.Put(Indices[Texel], 4);
+
+		FMemory::Memcpy(Out, Writer.Bits, 16);
+	}
+}
+
+int32 GensysBlockCompression::GetBlockBytes(EGensysBlockFormat Format)
+{
+	return Format == EGensysBlockFormat::BC4 ? 8 : 16;
+}
+
+void GensysBlockCompression::CompressLevel(const FColor* Pixels, int32 Width, int32 Height, EGensysBlockFormat Format, TArray64<uint8>& Out)
+{
+	const int32 BlocksX = FMath::DivideAndRoundUp(Width, 4);
+	const int32 BlocksY = FMath::DivideAndRoundUp(Height, 4);
+	const int32 BlockBytes = GetBlockBytes(Format);
+
+	Out.SetNumUninitialized((int64)BlocksX * BlocksY * BlockBytes);
+
+	// blocks are independent, a task handles a run of block rows
+	GensysParallel::ForRowBlocks(BlocksY, 4, [&](int32 RowBegin, int32 RowEnd)
+	{
+		FColor Block[16];
+		uint8 Channel[16];
+
+		for (int32 BlockY = RowBegin; BlockY < RowEnd; ++BlockY)
+		{
+			for (int32 BlockX = 0; BlockX < BlocksX; ++BlockX)
+			{
+				uint8* Destination = Out.GetData() + ((int64)BlockY * BlocksX + BlockX) * BlockBytes;
+				FetchBlock(Pixels, Width, Height, BlockX, BlockY, Block);
+
+				switch (Format)
+				{
+				case EGensysBlockFormat::BC4:
+					for (int32 Texel = 0; Texel < 16; ++Texel)
+						Channel[Texel] = Block[Texel].R;
+					EncodeBC4(Channel, Destination);
+					break;
+
+				case EGensysBlockFormat::BC5:
+					for (int32 Texel = 0; Texel < 16; ++Texel)
+						Channel[Texel] = Block[Texel].R;
+					EncodeBC4(Channel, Destination);
+
+					for (int32 Texel = 0; Texel < 16; ++Texel)
+						Channel[Texel] = Block[Texel].G;
+					EncodeBC4(Channel, Destination + 8);
+					break;
+
+				case EGensysBlockFormat::BC7:
+					EncodeBC7(Block, Destination);
+					break;
+				}
+			}
+		}
+	});
+}
+
+bool GensysBlockCompression::WriteDDS(const FString& Path, const FGensysMipChain& Chain, EGensysBlockFormat Format)
+{
+	if (Chain.IsEmpty() || !ensure(Chain.BytesPerPixel == sizeof(FColor)))
+		return false;
+
+	TArray64<uint8> FileData;
+
+	// "DDS " magic, 124 byte header and the DX10 extension
+	uint32 Header[1 + 31 + 5] = {};
+	Header[0] = 0x20534444;
+	Header[1] = 124;
+	Header[2] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;
+	Header[3] = Chain.Height;
+	Header[4] = Chain.Width;
+	Header[5] = FMath::DivideAndRoundUp(Chain.Width, 4) * FMath::DivideAndRoundUp(Chain.Height, 4) * GetBlockBytes(Format);
+	Header[7] = Chain.NumMips;
+	Header[19] = 32;
+	Header[20] = 0x4;
+	Header[21] = 0x30315844; // 'DX10'
+	Header[27] = 0x1000 | (Chain.NumMips > 1 ? 0x400000 | 0x8 : 0);
+	Header[32] = Format == EGensysBlockFormat::BC4 ? DXGI_FORMAT_BC4_UNORM : Format == EGensysBlockFormat::BC5 ? DXGI_FORMAT_BC5_UNORM : DXGI_FORMAT_BC7_UNORM;
+	Header[33] = 3;
+	Header[35] = 1;
+
+	FileData.Append(reinterpret_cast<const uint8*>(Header), sizeof(Header));
+
+	const FColor* Level = reinterpret_cast<const FColor*>(Chain.Data.GetData());
+	TArray64<uint8> Blocks;
+
+	for (int32 Mip = 0; Mip < Chain.NumMips; ++Mip)
+	{
+		const int32 Width = FMath::Max(Chain.Width >> Mip, 1);
+		const int32 Height = FMath::Max(Chain.Height >> Mip, 1);
+
+		CompressLevel(Level, Width, Height, Format, Blocks);
+		FileData.Append(Blocks);
+
+		Level += (int64)Width * Height;
+	}
+
+	return FFileHelper::SaveArrayToFile(FileData, *Path);
+}
+
+// Gensys.Benchmark stages
+namespace
+{
+	FGensysBenchmarkStage::FBody MakeCompressBenchmark(const FGensysBenchmarkInputs& Inputs, EGensysBlockFormat Format)
+	{
+		TSharedRef<TArray64<uint8>> Blocks = MakeShared<TArray64<uint8>>();
+		return [Blocks, Format, &Colour = Inputs.ColourBGRA8]()
+		{
+			GensysBlockCompression::CompressLevel((const FColor*)Colour.RawData.GetData(), Colour.SizeX, Colour.SizeY, Format, *Blocks);
+		};
+	}
+
+	FGensysBenchmarkStage CompressBC4Stage("CompressBC4", true, [](const FGensysBenchmarkInputs& Inputs) { return MakeCompressBenchmark(Inputs, EGensysBlockFormat::BC4); });
+	FGensysBenchmarkStage CompressBC7Stage("CompressBC7", true, [](const FGensysBenchmarkInputs& Inputs) { return MakeCompressBenchmark(Inputs, EGensysBlockFormat::BC7); });
+}
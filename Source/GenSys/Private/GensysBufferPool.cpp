@@ -0,0 +1,76 @@
+#include "GensysBufferPool.h"
+
+namespace
+{
+	// blocks are handed out aligned for the widest vector loads the stages use
+	constexpr uint32 BlockAlignment = 64;
+}
+
+FGensysBufferPool::~FGensysBufferPool()
+{
+	// every buffer must be returned before the session dies
+	ensure(BorrowedBytes == 0);
+	Trim();
+}
+
+int64 FGensysBufferPool::GetBucketSize(int64 Bytes)
+{
+	return (int64)FMath::RoundUpToPowerOfTwo64((uint64)FMath::Max<int64>(Bytes, BlockAlignment));
+}
+
+void* FGensysBufferPool::Acquire(int64 Bytes)
+{
+	const int64 BucketSize = GetBucketSize(Bytes);
+
+	{
+		FScopeLock ScopeLock(&Lock);
+		BorrowedBytes += BucketSize;
+
+		TArray<void*>* Bucket = FreeBlocks.Find(BucketSize);
+		if (Bucket && Bucket->Num() > 0)
+		{
+			PooledBytes -= BucketSize;
+			return Bucket->Pop(false);
+		}
+	}
+
+	// first use of this bucket, allocate outside of the lock
+	return FMemory::Malloc(BucketSize, BlockAlignment);
+}
+
+void FGensysBufferPool::Release(void* Block, int64 Bytes)
+{
+	if (Block == nullptr)
+		return;
+
+	const int64 BucketSize = GetBucketSize(Bytes);
+
+	FScopeLock ScopeLock(&Lock);
+	FreeBlocks.FindOrAdd(BucketSize).Add(Block);
+	PooledBytes += BucketSize;
+	BorrowedBytes -= BucketSize;
+}
+
+void FGensysBufferPool::Trim()
+{
+	FScopeLock ScopeLock(&Lock);
+
+	for (auto& Bucket : FreeBlocks)
+		for (void* Block : Bucket.Value)
+			FMemory::Free(Block);
+
+	FreeBlocks.Empty();
+	PooledBytes = 0;
+}
+
+int64 FGensysBufferPool::GetPooledBytes() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return PooledBytes;
+}
+
+int64 FGensysBufferPool::GetBorrowedBytes() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return BorrowedBytes;
+}
@@ -0,0 +1,119 @@
+#include "GensysDistanceField.h"
+#include "GensysParallel.h"
+#include "GensysBenchmark.h"
+
+namespace
+{
+	// Columns handled by a single task of the vertical pass
+	constexpr int32 ColumnsPerBlock = 16;
+
+	struct FEnvelopeScratch
+	{
+		void Init(int32 Count)
+		{
+			Input.SetNumUninitialized(Count);
+			Output.SetNumUninitialized(Count);
+			Vertices.SetNumUninitialized(Count);
+			Bounds.SetNumUninitialized(Count + 1);
+		}
+
+		TArray<float> Input;
+		TArray<float> Output;
+		// parabola of every envelope segment and where each one starts, in double: the squared distances of multi
+		// kilopixel lines lose the parabola intersections in float
+		TArray<int32> Vertices;
+		TArray<double> Bounds;
+	};
+
+	// where the parabola rooted at Q overtakes the one rooted at R < Q
+	FORCEINLINE double Intersect(const float* F, int32 Q, int32 R)
+	{
+		return (((double)F[Q] + (double)Q * Q) - ((double)F[R] + (double)R * R)) / (2.0 * (Q - R));
+	}
+
+	// 1D squared distance transform of Scratch.Input into Scratch.Output
+	void TransformLine(FEnvelopeScratch& Scratch, int32 Count)
+	{
+		const float* F = Scratch.Input.GetData();
+		int32* V = Scratch.Vertices.GetData();
+		double* Z = Scratch.Bounds.GetData();
+
+		int32 K = 0;
+		V[0] = 0;
+		Z[0] = -MAX_dbl;
+		Z[1] = MAX_dbl;
+
+		for (int32 Q = 1; Q < Count; ++Q)
+		{
+			// drop the parabolas the new one hides entirely
+			double S = Intersect(F, Q, V[K]);
+			while (S <= Z[K])
+			{
+				--K;
+				S = Intersect(F, Q, V[K]);
+			}
+
+			++K;
+			V[K] = Q;
+			Z[K] = S;
+			Z[K + 1] = MAX_dbl;
+		}
+
+		float* D = Scratch.Output.GetData();
+		K = 0;
+		for (int32 Q = 0; Q < Count; ++Q)
+		{
+			while (Z[K + 1] < Q)
+				++K;
+
+			D[Q] = (float)FMath::Min((double)(Q - V[K]) * (Q - V[K]) + F[V[K]], (double)GensysDistanceField::FarSquared);
+		}
+	}
+}
+
+void GensysDistanceField::TransformSquared(float* Grid, int32 Width, int32 Height)
+{
+	// columns first, gathered into contiguous scratch lines
+	GensysParallel::ForRowBlocks(FMath::DivideAndRoundUp(Width, ColumnsPerBlock), 1, [&](int32 BlockBegin, int32 BlockEnd)
+	{
+		FEnvelopeScratch Scratch;
+		Scratch.Init(Height);
+
+		for (int32 X = BlockBegin * ColumnsPerBlock; X < FMath::Min(BlockEnd * ColumnsPerBlock, Width); ++X)
+		{
+			for (int32 Y = 0; Y < Height; ++Y)
+				Scratch.Input[Y] = Grid[(int64)Y * Width + X];
+
+			TransformLine(Scratch, Height);
+
+			for (int32 Y = 0; Y < Height; ++Y)
+				Grid[(int64)Y * Width + X] = Scratch.Output[Y];
+		}
+	});
+
+	GensysParallel::ForRowBlocks(Height, GensysParallel::DefaultRowsPerBlock, [&](int32 RowBegin, int32 RowEnd)
+	{
+		FEnvelopeScratch Scratch;
+		Scratch.Init(Width);
+
+		for (int32 Y = RowBegin; Y < RowEnd; ++Y)
+		{
+			float* Row = Grid + (int64)Y * Width;
+			FMemory::Memcpy(Scratch.Input.GetData(), Row, Width * sizeof(float));
+
+			TransformLine(Scratch, Width);
+
+			FMemory::Memcpy(Row, Scratch.Output.GetData(), Width * sizeof(float));
+		}
+	});
+}
+
+// Gensys.Benchmark stage
+namespace
+{
+	FGensysBenchmarkStage DistanceFieldStage("DistanceField", true, [](const FGensysBenchmarkInputs& Inputs) -> FGensysBenchmarkStage::FBody
+	{
+		TSharedRef<FGensysMap> Distance = MakeShared<FGensysMap>();
+		return [Distance, &Heights = Inputs.Heights]() { GensysDistanceField::ComputeSigned(Heights, 0.5f, *Distance); };
+	});
+}
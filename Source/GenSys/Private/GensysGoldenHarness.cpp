@@ -0,0 +1,588 @@
+#include "CoreMinimal.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "ImageCore.h"
+#include "ImageUtils.h"
+#include "GenSys.h"
+#include "GensysParametersJson.h"
+#include "GensysRiverGraph.h"
+#include "GensysSpatialGrid.h"
+
+using json = nlohmann::json;
+
+DEFINE_LOG_CATEGORY_STATIC(LogGensysGolden, Log, All);
+
+// Golden output harness, run from the editor console or headless with -ExecCmds:
+//   Gensys.Golden Record <Corpus>
+//   Gensys.Golden Compare <Corpus> [Candidate=<Folder>] [-Exit]
+// Every sub folder of the corpus is a case holding a params.json (input.json keys, guide paths relative to the case)
+// and its guide images. Record runs the core and the plugin stages and stores every map they produce in
+// <Case>/Reference, Compare runs them again and checks the maps against the references (a map missing on either
+// side fails), writing <Case>/Diff/<Map>.png and <Corpus>/GoldenReport.json
+// A case exporting its river graph has RiverGraph.json checked too, node by node and edge by edge
+// Candidate= compares outputs produced elsewhere (<Folder>/<Case>/<Map>.png, RiverGraph.json) without running the core,
+// which is how the harness runs on machines that cannot start it (the core and its xcopy steps are Windows only),
+// -Exit quits with a non zero code when a case fails
+namespace
+{
+	// the default when neither the corpus nor the case has a tolerances.json entry for the map
+	struct FMapTolerance
+	{
+		double MaxAbs = 2.0 / 255.0;
+		double Rms = 0.5 / 255.0;
+		// river texels (red above half) allowed to change side between reference and candidate
+		int32 MaxRiverTexels = 0;
+		int32 MaxRiverComponents = 0;
+		// river graph only (the RiverGraph entry), nodes of either graph allowed without a node of the other within
+		// MaxNodeDistance pixels, and edges allowed without the matching edge on the other side
+		int32 MaxGraphNodes = 0;
+		int32 MaxGraphEdges = 0;
+		double MaxNodeDistance = 1.0;
+	};
+
+	struct FMapResult
+	{
+		FString Map;
+		double MaxAbs = 0;
+		double Rms = 0;
+		int64 RiverTexels[2] = {};
+		int32 RiverComponents[2] = {};
+		FString Error;
+		bool bPassed = false;
+	};
+
+	struct FGraphResult
+	{
+		// reference then candidate
+		int32 Nodes[2] = {};
+		int32 Edges[2] = {};
+		int32 UnmatchedNodes[2] = {};
+		int32 UnmatchedEdges[2] = {};
+		// farthest a matched node sits from its match, pixels
+		double MaxNodeDistance = 0;
+		FString Error;
+		bool bPassed = false;
+	};
+
+	// A missing file keeps the tolerances as they are, a malformed one is reported and fails the run
+	bool ReadTolerances(const FString& Path, TMap<FString, FMapTolerance>& InOut)
+	{
+		FString Text;
+		if (!FFileHelper::LoadFileToString(Text, *Path))
+			return true;
+
+		const json Parsed = json::parse(TCHAR_TO_UTF8(*Text), nullptr, false);
+		if (!Parsed.is_object())
+		{
+			UE_LOG(LogGensysGolden, Error, TEXT("%s: expected an object of maps"), *Path);
+			return false;
+		}
+
+		for (const auto& [Map, Entry] : Parsed.items())
+		{
+			FString Error = TEXT("expected an object");
+			FMapTolerance& Tolerance = InOut.FindOrAdd(UTF8_TO_TCHAR(Map.c_str()));
+
+			const bool bRead = Entry.is_object()
+				&& GensysJson::Read(Entry, "MaxAbs", Tolerance.MaxAbs, Error)
+				&& GensysJson::Read(Entry, "Rms", Tolerance.Rms, Error)
+				&& GensysJson::Read(Entry, "MaxRiverTexels", Tolerance.MaxRiverTexels, Error)
+				&& GensysJson::Read(Entry, "MaxRiverComponents", Tolerance.MaxRiverComponents, Error)
+				&& GensysJson::Read(Entry, "MaxGraphNodes", Tolerance.MaxGraphNodes, Error)
+				&& GensysJson::Read(Entry, "MaxGraphEdges", Tolerance.MaxGraphEdges, Error)
+				&& GensysJson::Read(Entry, "MaxNodeDistance", Tolerance.MaxNodeDistance, Error);
+
+			if (!bRead)
+			{
+				UE_LOG(LogGensysGolden, Error, TEXT("%s: %s: %s"), *Path, UTF8_TO_TCHAR(Map.c_str()), *Error);
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Names of the png maps of a folder, sorted
+	TArray<FString> FindMaps(const FString& Folder)
+	{
+		TArray<FString> Files;
+		IFileManager::Get().FindFiles(Files, *(Folder / "*.png"), true, false);
+
+		for (FString& File : Files)
+			File = FPaths::GetBaseFilename(File);
+
+		Files.Sort();
+		return Files;
+	}
+
+	bool LoadLinear(const FString& Path, FImage& Out)
+	{
+		if (!FImageUtils::LoadImage(*Path, Out))
+			return false;
+
+		// the outputs are data, compare the stored values
+		Out.GammaSpace = EGammaSpace::Linear;
+		Out.ChangeFormat(ERawImageFormat::RGBA32F, EGammaSpace::Linear);
+		return true;
+	}
+
+	// Structure of the rasterised rivers, for the cases that do not export their graph:
+	// amount of river texels and 8-connected river networks
+	void MeasureRivers(FImage& Image, int64& OutTexels, int32& OutComponents)
+	{
+		const TArrayView64<FLinearColor> Pixels = Image.AsRGBA32F();
+		const int32 Width = Image.SizeX;
+		const int32 Height = Image.SizeY;
+
+		TBitArray<> Visited(false, Width * Height);
+		TArray<int32> Stack;
+		OutTexels = 0;
+		OutComponents = 0;
+
+		for (int32 Start = 0; Start < Width * Height; ++Start)
+		{
+			if (Pixels[Start].R <= 0.5f)
+				continue;
+
+			++OutTexels;
+			if (Visited[Start])
+				continue;
+
+			++OutComponents;
+			Visited[Start] = true;
+			Stack.Add(Start);
+
+			while (Stack.Num() > 0)
+			{
+				const int32 Index = Stack.Pop(false);
+				const int32 X = Index % Width;
+				const int32 Y = Index / Width;
+
+				for (int32 NeighbourY = FMath::Max(Y - 1, 0); NeighbourY <= FMath::Min(Y + 1, Height - 1); ++NeighbourY)
+				{
+					for (int32 NeighbourX = FMath::Max(X - 1, 0); NeighbourX <= FMath::Min(X + 1, Width - 1); ++NeighbourX)
+					{
+						const int32 Neighbour = NeighbourY * Width + NeighbourX;
+						if (!Visited[Neighbour] && Pixels[Neighbour].R > 0.5f)
+						{
+							Visited[Neighbour] = true;
+							Stack.Add(Neighbour);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	FMapResult CompareMap(const FString& Map, const FString& ReferencePath, const FString& CandidatePath, const FString& DiffPath, const FMapTolerance& Tolerance)
+	{
+		FMapResult Result;
+		Result.Map = Map;
+
+		FImage Reference;
+		FImage Candidate;
+		if (!LoadLinear(ReferencePath, Reference))
+		{
+			Result.Error = TEXT("missing reference");
+			return Result;
+		}
+		if (!LoadLinear(CandidatePath, Candidate))
+		{
+			Result.Error = TEXT("missing output");
+			return Result;
+		}
+		if (Reference.SizeX != Candidate.SizeX || Reference.SizeY != Candidate.SizeY)
+		{
+			Result.Error = FString::Printf(TEXT("size %dx%d, expected %dx%d"), Candidate.SizeX, Candidate.SizeY, Reference.SizeX, Reference.SizeY);
+			return Result;
+		}
+
+		const TArrayView64<FLinearColor> ReferencePixels = Reference.AsRGBA32F();
+		const TArrayView64<FLinearColor> CandidatePixels = Candidate.AsRGBA32F();
+
+		// absolute difference per channel, amplified so small drifts are visible
+		FImage Diff(Reference.SizeX, Reference.SizeY, ERawImageFormat::BGRA8, EGammaSpace::Linear);
+		const TArrayView64<FColor> DiffPixels = Diff.AsBGRA8();
+
+		double SquaredSum = 0;
+		for (int64 Index = 0; Index < ReferencePixels.Num(); ++Index)
+		{
+			const FLinearColor Delta = CandidatePixels[Index] - ReferencePixels[Index];
+			const double Channels[4] = { FMath::Abs(Delta.R), FMath::Abs(Delta.G), FMath::Abs(Delta.B), FMath::Abs(Delta.A) };
+
+			for (double Channel : Channels)
+			{
+				Result.MaxAbs = FMath::Max(Result.MaxAbs, Channel);
+				SquaredSum += Channel * Channel;
+			}
+
+			DiffPixels[Index] = FColor(
+				(uint8)FMath::Min(Channels[0] * 16.0 * 255.0, 255.0),
+				(uint8)FMath::Min(Channels[1] * 16.0 * 255.0, 255.0),
+				(uint8)FMath::Min(Channels[2] * 16.0 * 255.0, 255.0),
+				255);
+		}
+
+		Result.Rms = FMath::Sqrt(SquaredSum / FMath::Max<int64>(ReferencePixels.Num() * 4, 1));
+		Result.bPassed = Result.MaxAbs <= Tolerance.MaxAbs && Result.Rms <= Tolerance.Rms;
+
+		if (Map == TEXT("RiverErosionMap"))
+		{
+			MeasureRivers(Reference, Result.RiverTexels[0], Result.RiverComponents[0]);
+			MeasureRivers(Candidate, Result.RiverTexels[1], Result.RiverComponents[1]);
+
+			Result.bPassed &= FMath::Abs(Result.RiverTexels[1] - Result.RiverTexels[0]) <= Tolerance.MaxRiverTexels;
+			Result.bPassed &= FMath::Abs(Result.RiverComponents[1] - Result.RiverComponents[0]) <= Tolerance.MaxRiverComponents;
+		}
+
+		if (!Result.bPassed)
+			FImageUtils::SaveImageByExtension(*DiffPath, Diff);
+
+		return Result;
+	}
+
+	// Reads back what FGensysRiverGraph::SaveJson wrote, positions in pixels again
+	bool LoadRiverGraph(const FString& Path, FGensysRiverGraph& Out, FString& OutError)
+	{
+		FString Text;
+		if (!FFileHelper::LoadFileToString(Text, *Path))
+		{
+			OutError = TEXT("cannot read the file");
+			return false;
+		}
+
+		const json Parsed = json::parse(TCHAR_TO_UTF8(*Text), nullptr, false);
+		if (!Parsed.is_object() || !GensysJson::Read(Parsed, "Width", Out.Width, OutError) || !GensysJson::Read(Parsed, "Height", Out.Height, OutError))
+		{
+			OutError = OutError.IsEmpty() ? TEXT("expected an object") : OutError;
+			return false;
+		}
+
+		if (!Parsed.contains("Nodes") || !Parsed["Nodes"].is_array() || !Parsed.contains("Edges") || !Parsed["Edges"].is_array())
+		{
+			OutError = TEXT("expected Nodes and Edges arrays");
+			return false;
+		}
+
+		for (const json& Node : Parsed["Nodes"])
+		{
+			float U = 0.f, V = 0.f;
+			if (!Node.is_object() || !GensysJson::Read(Node, "U", U, OutError) || !GensysJson::Read(Node, "V", V, OutError))
+			{
+				OutError = FString::Printf(TEXT("node %d: %s"), Out.Positions.Num(), OutError.IsEmpty() ? TEXT("expected an object") : *OutError);
+				return false;
+			}
+			Out.Positions.Add(FVector2f(U * Out.Width, V * Out.Height));
+		}
+
+		for (const json& Edge : Parsed["Edges"])
+		{
+			if (!Edge.is_array() || Edge.size() != 2 || !Edge[0].is_number_integer() || !Edge[1].is_number_integer()
+				|| !Out.Positions.IsValidIndex(Edge[0].get<int32>()) || !Out.Positions.IsValidIndex(Edge[1].get<int32>()))
+			{
+				OutError = FString::Printf(TEXT("edge %d: expected two node indices"), Out.Edges.Num());
+				return false;
+			}
+			Out.Edges.Add(FIntPoint(Edge[0].get<int32>(), Edge[1].get<int32>()));
+		}
+
+		return true;
+	}
+
+	// Matches every node of From to the closest node of To within the tolerance, INDEX_NONE when there is none
+	int32 MatchNodes(const FGensysRiverGraph& From, const FGensysRiverGraph& To, double MaxDistance, TArray<int32>& OutMatches, double& InOutMaxDistance)
+	{
+		const float Radius = (float)FMath::Max(MaxDistance, 0.0);
+		FGensysSpatialGrid Grid(FMath::Max(Radius, 1.f));
+		Grid.Reserve(To.NumNodes());
+		for (const FVector2f& Position : To.Positions)
+			Grid.Add(Position);
+
+		int32 NumUnmatched = 0;
+		OutMatches.SetNumUninitialized(From.NumNodes());
+		for (int32 Node = 0; Node < From.NumNodes(); ++Node)
+		{
+			OutMatches[Node] = Grid.FindNearest(From.Positions[Node], Radius);
+			if (OutMatches[Node] == INDEX_NONE)
+				++NumUnmatched;
+			else
+				InOutMaxDistance = FMath::Max(InOutMaxDistance, (double)FVector2f::Distance(From.Positions[Node], To.Positions[OutMatches[Node]]));
+		}
+
+		return NumUnmatched;
+	}
+
+	// Edges of From whose matched ends are not linked in To
+	int32 CountUnmatchedEdges(const FGensysRiverGraph& From, const FGensysRiverGraph& To, const TArray<int32>& Matches)
+	{
+		TSet<uint64> ToEdges;
+		ToEdges.Reserve(To.Edges.Num());
+		for (const FIntPoint& Edge : To.Edges)
+			ToEdges.Add(FGensysRiverGraph::GetEdgeKey(Edge.X, Edge.Y));
+
+		int32 NumUnmatched = 0;
+		for (const FIntPoint& Edge : From.Edges)
+		{
+			const int32 A = Matches[Edge.X];
+			const int32 B = Matches[Edge.Y];
+			NumUnmatched += A == INDEX_NONE || B == INDEX_NONE || !ToEdges.Contains(FGensysRiverGraph::GetEdgeKey(A, B));
+		}
+
+		return NumUnmatched;
+	}
+
+	// The traced network itself, every node has to sit near a node of the other graph and every edge has to link
+	// the matches of its ends there, in both directions so nothing added or dropped goes unnoticed
+	FGraphResult CompareRiverGraph(const FString& ReferencePath, const FString& CandidatePath, const FMapTolerance& Tolerance)
+	{
+		FGraphResult Result;
+		FGensysRiverGraph Graphs[2];
+		FString Error;
+
+		if (!LoadRiverGraph(ReferencePath, Graphs[0], Error))
+		{
+			Result.Error = TEXT("reference: ") + Error;
+			return Result;
+		}
+		if (!LoadRiverGraph(CandidatePath, Graphs[1], Error))
+		{
+			Result.Error = TEXT("output: ") + Error;
+			return Result;
+		}
+		if (Graphs[0].Width != Graphs[1].Width || Graphs[0].Height != Graphs[1].Height)
+		{
+			Result.Error = FString::Printf(TEXT("traced at %dx%d, expected %dx%d"), Graphs[1].Width, Graphs[1].Height, Graphs[0].Width, Graphs[0].Height);
+			return Result;
+		}
+
+		TArray<int32> Matches[2];
+		for (int32 Side = 0; Side < 2; ++Side)
+		{
+			Result.Nodes[Side] = Graphs[Side].NumNodes();
+			Result.Edges[Side] = Graphs[Side].Edges.Num();
+			Result.UnmatchedNodes[Side] = MatchNodes(Graphs[Side], Graphs[1 - Side], Tolerance.MaxNodeDistance, Matches[Side], Result.MaxNodeDistance);
+		}
+
+		for (int32 Side = 0; Side < 2; ++Side)
+			Result.UnmatchedEdges[Side] = CountUnmatchedEdges(Graphs[Side], Graphs[1 - Side], Matches[Side]);
+
+		Result.bPassed = FMath::Max(Result.UnmatchedNodes[0], Result.UnmatchedNodes[1]) <= Tolerance.MaxGraphNodes
+			&& FMath::Max(Result.UnmatchedEdges[0], Result.UnmatchedEdges[1]) <= Tolerance.MaxGraphEdges;
+		return Result;
+	}
+
+	// Runs the core and the plugin stages for a case and copies every map they produce into the destination folder
+	bool GenerateCase(const FString& CaseFolder, const FString& Destination)
+	{
+		FString Text;
+		if (!FFileHelper::LoadFileToString(Text, *(CaseFolder / "params.json")))
+			return false;
+
+		const json Parsed = json::parse(TCHAR_TO_UTF8(*Text), nullptr, false);
+		if (!Parsed.is_object())
+			return false;
+
+		GensysParameters Params;
+		FString Error;
+		if (!ParseParamsFromJson(Parsed, Params, Error))
+		{
+			UE_LOG(LogGensysGolden, Error, TEXT("%s: %s"), *(CaseFolder / "params.json"), *Error);
+			return false;
+		}
+
+		// guides travel with the case, content browser assets are not part of a corpus
+		const auto MakeAbsolute = [&CaseFolder](std::string& Path)
+		{
+			if (!Path.empty())
+				Path = TCHAR_TO_UTF8(*FPaths::ConvertRelativePathToFull(CaseFolder, UTF8_TO_TCHAR(Path.c_str())));
+		};
+		MakeAbsolute(Params.User_TerrainOutlineMap);
+		MakeAbsolute(Params.User_TerrainFeatureMap);
+		MakeAbsolute(Params.User_RiverOutline);
+		MakeAbsolute(Params.LayerRulesPath);
+		MakeAbsolute(Params.FoliageRulesPath);
+		Params.User_TerrainOutlineAsset.clear();
+		Params.User_TerrainFeatureAsset.clear();
+		Params.User_RiverOutlineAsset.clear();
+
+		// the stages run in a content folder of their own, every map they produce is listed and nothing is imported
+		Params.Identifier = TCHAR_TO_UTF8(*("GensysGolden_" + FPaths::GetCleanFilename(CaseFolder)));
+		Params.SkipTextureImport = false;
+		Params.AlwaysReimport = true;
+		Params.GenerateMipChains = false;
+
+		FGenSysModule& Module = FGenSysModule::Get();
+		FGensysProgress Progress(2);
+		FGensysPreparedOutputs Outputs;
+		if (!Module.GenerateCoreOutputs(Params, Progress) || !Module.PrepareGensysOutput(Params, Progress, Outputs))
+			return false;
+
+		// a map dropped by a stage must fail the comparison, not linger from a previous run
+		IFileManager::Get().DeleteDirectory(*Destination, false, true);
+		IFileManager::Get().MakeDirectory(*Destination, true);
+
+		bool bCopied = true;
+		for (const FString& Map : Outputs.Files)
+			bCopied &= IFileManager::Get().Copy(*(Destination / Map + ".png"), *(Outputs.Folder / Map + ".png")) == COPY_OK;
+
+		if (FPaths::FileExists(Outputs.Folder / "RiverGraph.json"))
+			bCopied &= IFileManager::Get().Copy(*(Destination / "RiverGraph.json"), *(Outputs.Folder / "RiverGraph.json")) == COPY_OK;
+
+		IFileManager::Get().DeleteDirectory(*Outputs.Folder, false, true);
+		return bCopied;
+	}
+
+	void RunGolden(const TArray<FString>& Args)
+	{
+		if (Args.Num() < 2 || (Args[0] != TEXT("Record") && Args[0] != TEXT("Compare")))
+		{
+			UE_LOG(LogGensysGolden, Error, TEXT("Usage: Gensys.Golden Record|Compare <Corpus> [Candidate=<Folder>] [-Exit]"));
+			return;
+		}
+
+		const bool bRecord = Args[0] == TEXT("Record");
+		const FString Corpus = FPaths::ConvertRelativePathToFull(Args[1]);
+		FString CandidateRoot;
+		bool bExit = false;
+
+		for (int32 Index = 2; Index < Args.Num(); ++Index)
+		{
+			if (Args[Index].StartsWith(TEXT("Candidate=")))
+				CandidateRoot = FPaths::ConvertRelativePathToFull(Args[Index].RightChop(10));
+			else if (Args[Index] == TEXT("-Exit"))
+				bExit = true;
+		}
+
+		TArray<FString> Cases;
+		IFileManager::Get().FindFiles(Cases, *(Corpus / "*"), false, true);
+		Cases.Sort();
+
+		TMap<FString, FMapTolerance> CorpusTolerances;
+		if (!bRecord && !ReadTolerances(Corpus / "tolerances.json", CorpusTolerances))
+		{
+			if (bExit)
+				FPlatformMisc::RequestExitWithStatus(false, 1);
+			return;
+		}
+
+		json Report;
+		Report["Cases"] = json::array();
+		int32 NumFailed = 0;
+
+		for (const FString& Case : Cases)
+		{
+			const FString CaseFolder = Corpus / Case;
+			if (!FPaths::FileExists(CaseFolder / "params.json"))
+				continue;
+
+			if (bRecord)
+			{
+				const bool bRecorded = GenerateCase(CaseFolder, CaseFolder / "Reference");
+				NumFailed += !bRecorded;
+				UE_LOG(LogGensysGolden, Display, TEXT("%-24s %s"), *Case, bRecorded ? TEXT("recorded") : TEXT("FAILED to record"));
+				continue;
+			}
+
+			FString CandidateFolder = CandidateRoot / Case;
+			if (CandidateRoot.IsEmpty())
+			{
+				CandidateFolder = CaseFolder / "Candidate";
+				if (!GenerateCase(CaseFolder, CandidateFolder))
+					UE_LOG(LogGensysGolden, Warning, TEXT("%-24s the core did not run"), *Case);
+			}
+
+			// a case can override the corpus wide tolerances per map
+			TMap<FString, FMapTolerance> Tolerances = CorpusTolerances;
+			bool bCasePassed = ReadTolerances(CaseFolder / "tolerances.json", Tolerances);
+
+			const FString DiffFolder = CaseFolder / "Diff";
+			IFileManager::Get().DeleteDirectory(*DiffFolder, false, true);
+			IFileManager::Get().MakeDirectory(*DiffFolder, true);
+
+			json CaseReport;
+			CaseReport["Case"] = TCHAR_TO_UTF8(*Case);
+			CaseReport["Maps"] = json::array();
+
+			// the core maps and every map derived by the plugin stages, on either side
+			TArray<FString> Maps = FindMaps(CaseFolder / "Reference");
+			for (const FString& Map : FindMaps(CandidateFolder))
+				Maps.AddUnique(Map);
+
+			for (const FString& Map : Maps)
+			{
+				const FMapTolerance* Tolerance = Tolerances.Find(Map);
+				const FMapResult Result = CompareMap(Map, CaseFolder / "Reference" / Map + ".png", CandidateFolder / Map + ".png",
+					DiffFolder / Map + ".png", Tolerance ? *Tolerance : FMapTolerance());
+
+				bCasePassed &= Result.bPassed;
+
+				json MapReport = {
+					{ "Map", TCHAR_TO_UTF8(*Map) },
+					{ "MaxAbs", Result.MaxAbs },
+					{ "Rms", Result.Rms },
+					{ "Passed", Result.bPassed }
+				};
+				if (!Result.Error.IsEmpty())
+					MapReport["Error"] = TCHAR_TO_UTF8(*Result.Error);
+				if (Map == TEXT("RiverErosionMap"))
+				{
+					MapReport["RiverTexels"] = { Result.RiverTexels[0], Result.RiverTexels[1] };
+					MapReport["RiverComponents"] = { Result.RiverComponents[0], Result.RiverComponents[1] };
+				}
+				CaseReport["Maps"].push_back(MapReport);
+
+				UE_LOG(LogGensysGolden, Display, TEXT("%-24s %-18s max %.5f rms %.5f%s%s"), *Case, *Map, Result.MaxAbs, Result.Rms,
+					Result.bPassed ? TEXT("") : TEXT("  FAILED "), *Result.Error);
+			}
+
+			// only checked when either side has a graph, a graph on one side alone fails like a missing map
+			const FString ReferenceGraph = CaseFolder / "Reference" / "RiverGraph.json";
+			const FString CandidateGraph = CandidateFolder / "RiverGraph.json";
+			if (FPaths::FileExists(ReferenceGraph) || FPaths::FileExists(CandidateGraph))
+			{
+				const FMapTolerance* Tolerance = Tolerances.Find(TEXT("RiverGraph"));
+				const FGraphResult Result = CompareRiverGraph(ReferenceGraph, CandidateGraph, Tolerance ? *Tolerance : FMapTolerance());
+
+				bCasePassed &= Result.bPassed;
+
+				json GraphReport = {
+					{ "Nodes", { Result.Nodes[0], Result.Nodes[1] } },
+					{ "Edges", { Result.Edges[0], Result.Edges[1] } },
+					{ "UnmatchedNodes", { Result.UnmatchedNodes[0], Result.UnmatchedNodes[1] } },
+					{ "UnmatchedEdges", { Result.UnmatchedEdges[0], Result.UnmatchedEdges[1] } },
+					{ "MaxNodeDistance", Result.MaxNodeDistance },
+					{ "Passed", Result.bPassed }
+				};
+				if (!Result.Error.IsEmpty())
+					GraphReport["Error"] = TCHAR_TO_UTF8(*Result.Error);
+				CaseReport["RiverGraph"] = GraphReport;
+
+				UE_LOG(LogGensysGolden, Display, TEXT("%-24s %-18s nodes %d/%d edges %d/%d unmatched %d/%d nodes %d/%d edges max %.2f px%s%s"), *Case,
+					TEXT("RiverGraph"), Result.Nodes[0], Result.Nodes[1], Result.Edges[0], Result.Edges[1], Result.UnmatchedNodes[0],
+					Result.UnmatchedNodes[1], Result.UnmatchedEdges[0], Result.UnmatchedEdges[1], Result.MaxNodeDistance,
+					Result.bPassed ? TEXT("") : TEXT("  FAILED "), *Result.Error);
+			}
+
+			CaseReport["Passed"] = bCasePassed;
+			Report["Cases"].push_back(CaseReport);
+			NumFailed += !bCasePassed;
+		}
+
+		if (!bRecord)
+		{
+			Report["Failed"] = NumFailed;
+			const FString ReportPath = Corpus / "GoldenReport.json";
+			FFileHelper::SaveStringToFile(UTF8_TO_TCHAR(Report.dump(1, '\t').c_str()), *ReportPath);
+			UE_LOG(LogGensysGolden, Display, TEXT("Report written to %s, %d failing case(s)"), *ReportPath, NumFailed);
+		}
+
+		if (bExit)
+			FPlatformMisc::RequestExitWithStatus(false, NumFailed > 0 ? 1 : 0);
+	}
+
+	FAutoConsoleCommand GoldenCommand(
+		TEXT("Gensys.Golden"),
+		TEXT("Records or checks the golden outputs of a corpus. Args: Record|Compare <Corpus> [Candidate=<Folder>] [-Exit]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&RunGolden));
+}
@@ -0,0 +1,155 @@
+#include "GensysGuideCache.h"
+#include "GensysResample.h"
+#include "GensysProgress.h"
+#include "ImageUtils.h"
+#include "Engine/Texture2D.h"
+
+const FString* FGensysGuideCache::FindCurrent(const FString& Key, const FString& Version) const
+{
+	const FEntry* Cached = Entries.Find(Key);
+	if (Cached && Cached->Version == Version && FPaths::FileExists(Cached->ResolvedPath))
+		return &Cached->ResolvedPath;
+
+	return nullptr;
+}
+
+FGensysGuideCache::FEntry* FGensysGuideCache::FindEntry(const FString& KeyOrResolvedPath)
+{
+	if (FEntry* Entry = Entries.Find(KeyOrResolvedPath))
+		return Entry;
+
+	for (TPair<FString, FEntry>& Pair : Entries)
+	{
+		if (Pair.Value.ResolvedPath == KeyOrResolvedPath)
+			return &Pair.Value;
+	}
+
+	return nullptr;
+}
+
+FString FGensysGuideCache::Resolve(const FString& SourcePath)
+{
+	if (SourcePath.IsEmpty())
+		return SourcePath;
+
+	// a working copy already written for a texture guide, handed to a queue worker that cannot load the texture
+	if (!Entries.Contains(SourcePath) && FPaths::IsUnderDirectory(SourcePath, CacheFolder))
+	{
+		if (FEntry* Written = FindEntry(SourcePath))
+			return Written->ResolvedPath;
+	}
+
+	const FDateTime Timestamp = IFileManager::Get().GetTimeStamp(*SourcePath);
+	if (Timestamp == FDateTime::MinValue())
+		return FString();
+
+	// same file, same version, nothing to decode
+	const FString Version = Timestamp.ToString();
+	if (const FString* Cached = FindCurrent(SourcePath, Version))
+		return *Cached;
+
+	FImage Decoded;
+	if (!FImageUtils::LoadImage(*SourcePath, Decoded))
+		return FString();
+
+	return Store(SourcePath, Version, Decoded, SourcePath);
+}
+
+FString FGensysGuideCache::Resolve(UTexture2D* Texture)
+{
+	if (Texture == nullptr || !Texture->Source.IsValid())
+		return FString();
+
+	// the source id changes whenever the texture is reimported or edited
+	const FString Key = Texture->GetPathName();
+	const FString Version = Texture->Source.GetId().ToString();
+	if (const FString* Cached = FindCurrent(Key, Version))
+		return *Cached;
+
+	FImage Decoded;
+	if (!Texture->Source.GetMipImage(Decoded, 0))
+		return FString();
+
+	// there is no file the core could read directly, always write the working copy
+	return Store(Key, Version, Decoded, FString());
+}
+
+FString FGensysGuideCache::Store(const FString& Key, const FString& Version, FImage& Decoded, const FString& PassThroughPath)
+{
+	FEntry& Entry = Entries.Add(Key);
+	Entry.Version = Version;
+
+	// guides are data, the stored values are resampled as they are without any gamma conversion
+	Decoded.GammaSpace = EGammaSpace::Linear;
+	Decoded.ChangeFormat(ERawImageFormat::RGBA32F, EGammaSpace::Linear);
+	GensysImage::ImageToMap(Decoded, Entry.Source);
+
+	// already the size the core wants, it can read the original directly
+	if (!PassThroughPath.IsEmpty() && Decoded.SizeX == WorkingResolution && Decoded.SizeY == WorkingResolution)
+	{
+		Entry.ResolvedPath = PassThroughPath;
+		return Entry.ResolvedPath;
+	}
+
+	FImage Working;
+	if (Decoded.SizeX == WorkingResolution && Decoded.SizeY == WorkingResolution)
+		Working = MoveTemp(Decoded);
+	else
+		GensysResample::Resize(Decoded, WorkingResolution, WorkingResolution, Working);
+
+	// one file per source, overwritten when the source changes
+	Entry.ResolvedPath = CacheFolder / FString::Printf(TEXT("Guide_%08x.png"), GetTypeHash(Key));
+
+	// 16 bits so the guide heights are not quantised on the way to the core
+	FImage Encoded;
+	Working.CopyTo(Encoded, ERawImageFormat::RGBA16, EGammaSpace::Linear);
+
+	if (!FImageUtils::SaveImageByExtension(*Entry.ResolvedPath, Encoded))
+	{
+		Entries.Remove(Key);
+		return FString();
+	}
+
+	return Entry.ResolvedPath;
+}
+
+const FGensysHeightMap* FGensysGuideCache::Sample(const FString& Key, int32 Width, int32 Height)
+{
+	FEntry* Entry = FindEntry(Key);
+	if (Entry == nullptr || Entry->Source.IsEmpty())
+		return nullptr;
+
+	if (Entry->Resampled.Width == Width && Entry->Resampled.Height == Height)
+		return &Entry->Resampled;
+
+	const FGensysHeightMap& Source = Entry->Source;
+	Entry->Resampled.Init(Width, Height);
+
+	if (Source.Width == Width && Source.Height == Height)
+	{
+		FMemory::Memcpy(Entry->Resampled.Values.GetData(), Source.Values.GetData(), Source.GetAllocatedSize());
+		return &Entry->Resampled;
+	}
+
+	// the resampler filters RGBA32F, only the red channel is filled in and read back
+	FImage SourceImage(Source.Width, Source.Height, ERawImageFormat::RGBA32F, EGammaSpace::Linear);
+	const TArrayView64<FLinearColor> SourcePixels = SourceImage.AsRGBA32F();
+	for (int64 Index = 0; Index < Source.Num(); ++Index)
+		SourcePixels[Index] = FLinearColor(Source.Get(Index), 0.f, 0.f, 0.f);
+
+	FImage Resized;
+	GensysResample::Resize(SourceImage, Width, Height, Resized);
+
+	// a cancelled resize skipped some rows, it must not stay cached
+	if (FGensysProgress::IsActiveCancelled())
+	{
+		Entry->Resampled.Reset();
+		return nullptr;
+	}
+
+	const TArrayView64<FLinearColor> ResizedPixels = Resized.AsRGBA32F();
+	for (int64 Index = 0; Index < Entry->Resampled.Num(); ++Index)
+		Entry->Resampled.Set(Index, ResizedPixels[Index].R);
+
+	return &Entry->Resampled;
+}
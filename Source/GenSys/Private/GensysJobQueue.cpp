@@ -0,0 +1,237 @@
+#include "GensysJobQueue.h"
+#include "HAL/RunnableThread.h"
+#include "Framework/Notifications/NotificationManager.h"
+#include "Widgets/Notifications/SNotificationList.h"
+
+#define LOCTEXT_NAMESPACE "FGenSysModule"
+
+FGensysJobQueue::FGensysJobQueue(FGenerateFunction InGenerate, FImportFunction InImport, FIdleFunction InIdle)
+	: Generate(MoveTemp(InGenerate))
+	, Import(MoveTemp(InImport))
+	, Idle(MoveTemp(InIdle))
+{
+	// manual reset, a single trigger has to wake every idle worker
+	WakeUp = FPlatformProcess::GetSynchEventFromPool(true);
+	EnsureWorkers(1);
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FGensysJobQueue::TickImport));
+}
+
+FGensysJobQueue::~FGensysJobQueue()
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+
+	// the running core is killed through the cancelled progress
+	CancelAll();
+
+	Stop();
+	for (FRunnableThread* Thread : Threads)
+	{
+		Thread->Kill(true);
+		delete Thread;
+	}
+
+	FPlatformProcess::ReturnSynchEventToPool(WakeUp);
+
+	if (TSharedPtr<SNotificationItem> Item = Notification.Pin())
+		Item->ExpireAndFadeout();
+}
+
+void FGensysJobQueue::Enqueue(const GensysParameters& Params, int32 NumStages)
+{
+	{
+		FScopeLock ScopeLock(&Lock);
+		Pending.Add(MakeShared<FGensysJob>(Params, NumStages));
+	}
+
+	WakeUp->Trigger();
+
+	if (!Notification.IsValid())
+	{
+		FNotificationInfo Info(LOCTEXT("GensysQueueStarted", "Gensys queue"));
+		Info.bFireAndForget = false;
+		Info.ButtonDetails.Add(FNotificationButtonInfo(
+			LOCTEXT("GensysQueueCancel", "Cancel"),
+			LOCTEXT("GensysQueueCancelTooltip", "Cancels the running landscapes and drops the queued ones"),
+			FSimpleDelegate::CreateRaw(this, &FGensysJobQueue::CancelAll),
+			SNotificationItem::CS_Pending));
+
+		Notification = FSlateNotificationManager::Get().AddNotification(Info);
+		NumFinished = 0;
+
+		if (TSharedPtr<SNotificationItem> Item = Notification.Pin())
+			Item->SetCompletionState(SNotificationItem::CS_Pending);
+	}
+
+	UpdateNotification();
+}
+
+void FGensysJobQueue::EnsureWorkers(int32 NumWorkers)
+{
+	FScopeLock ScopeLock(&Lock);
+	while (Threads.Num() < NumWorkers)
+		Threads.Add(FRunnableThread::Create(this, *FString::Printf(TEXT("GensysJobQueue%d"), Threads.Num()), 0, TPri_BelowNormal));
+}
+
+void FGensysJobQueue::CancelAll()
+{
+	FScopeLock ScopeLock(&Lock);
+
+	for (const TSharedRef<FGensysJob>& Job : Pending)
+		Job->Progress.Cancel();
+	for (const TSharedRef<FGensysJob>& Job : Ready)
+		Job->Progress.Cancel();
+	for (const TSharedRef<FGensysJob>& Job : Generating)
+		Job->Progress.Cancel();
+	if (Importing)
+		Importing->Progress.Cancel();
+
+	Pending.Empty();
+	Ready.Empty();
+}
+
+int32 FGensysJobQueue::GetNumJobs() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return Pending.Num() + Ready.Num() + Generating.Num() + Importing.IsValid();
+}
+
+TSharedPtr<FGensysJob> FGensysJobQueue::PopPending()
+{
+	FScopeLock ScopeLock(&Lock);
+
+	// the import stage is full (counting the jobs that will land in it), wait for it to catch up
+	if (Ready.Num() + Generating.Num() >= MaxReadyJobs + Threads.Num() - 1)
+		return nullptr;
+
+	// the copy stage would overwrite the pngs of a job with the same identifier while they are generated or imported
+	const auto IsFolderBusy = [this](const GensysParameters& Params)
+	{
+		const auto SameFolder = [&Params](const TSharedRef<FGensysJob>& Job) { return Job->Params.Identifier == Params.Identifier; };
+
+		if (Importing && Importing->Params.Identifier == Params.Identifier)
+			return true;
+
+		return Ready.ContainsByPredicate(SameFolder) || Generating.ContainsByPredicate(SameFolder);
+	};
+
+	for (int32 Index = 0; Index < Pending.Num(); ++Index)
+	{
+		if (IsFolderBusy(Pending[Index]->Params))
+			continue;
+
+		TSharedRef<FGensysJob> Job = Pending[Index];
+		Pending.RemoveAt(Index);
+		Generating.Add(Job);
+		return Job;
+	}
+
+	return nullptr;
+}
+
+uint32 FGensysJobQueue::Run()
+{
+	// every worker runs its own core slot
+	const int32 Slot = NextSlot++;
+
+	while (!bStopping)
+	{
+		TSharedPtr<FGensysJob> Job = PopPending();
+		if (!Job)
+		{
+			// woken up by a new job or a finished import
+			WakeUp->Wait(100);
+			WakeUp->Reset();
+			continue;
+		}
+
+		bool bGenerated = false;
+		{
+			FGensysProgress::FScopedActive ActiveProgress(Job->Progress);
+			bGenerated = Generate(*Job, Slot) && !Job->Progress.IsCancelled();
+		}
+
+		FScopeLock ScopeLock(&Lock);
+		Generating.Remove(Job.ToSharedRef());
+		if (bGenerated)
+			Ready.Add(Job.ToSharedRef());
+	}
+
+	return 0;
+}
+
+void FGensysJobQueue::Stop()
+{
+	bStopping = true;
+	WakeUp->Trigger();
+}
+
+bool FGensysJobQueue::TickImport(float DeltaTime)
+{
+	TSharedPtr<FGensysJob> Job;
+	{
+		FScopeLock ScopeLock(&Lock);
+		if (Ready.Num() > 0)
+		{
+			Job = Ready[0];
+			Ready.RemoveAt(0);
+			Importing = Job;
+		}
+	}
+
+	if (Job)
+	{
+		// one job per tick, the editor stays responsive between imports
+		Import(*Job);
+
+		FScopeLock ScopeLock(&Lock);
+		Importing.Reset();
+		NumFinished += !Job->Progress.IsCancelled();
+	}
+
+	// a slot freed up for the generation stage
+	if (Job)
+		WakeUp->Trigger();
+
+	UpdateNotification();
+	return true;
+}
+
+void FGensysJobQueue::UpdateNotification()
+{
+	TSharedPtr<SNotificationItem> Item = Notification.Pin();
+	if (!Item)
+		return;
+
+	FText Status;
+	int32 NumQueued = 0;
+	int32 NumWaiting = 0;
+	bool bIdle = false;
+	{
+		FScopeLock ScopeLock(&Lock);
+		NumQueued = Pending.Num();
+		NumWaiting = Ready.Num();
+		bIdle = NumQueued == 0 && NumWaiting == 0 && Generating.Num() == 0 && !Importing;
+
+		TArray<FText> Lines;
+		for (const TSharedRef<FGensysJob>& Job : Generating)
+			Lines.Add(FText::Format(LOCTEXT("GensysQueueGenerating", "{0}: {1}"), FText::FromString(Job->Params.Identifier.data()), Job->Progress.GetStatusText()));
+		Status = FText::Join(FText::FromString("\n"), Lines);
+	}
+
+	if (bIdle)
+	{
+		// the batch is over, a failed or cancelled last job never reaches the import
+		Idle();
+
+		Item->SetText(FText::Format(LOCTEXT("GensysQueueFinished", "Gensys queue finished, {0} landscape(s) imported"), NumFinished));
+		Item->SetCompletionState(SNotificationItem::CS_Success);
+		Item->ExpireAndFadeout();
+		Notification.Reset();
+		return;
+	}
+
+	Item->SetText(FText::Format(LOCTEXT("GensysQueueStatus", "Gensys queue: {0} queued, {1} waiting for import"), NumQueued, NumWaiting));
+	Item->SetSubText(Status);
+}
+
+#undef LOCTEXT_NAMESPACE
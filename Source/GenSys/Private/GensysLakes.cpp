@@ -0,0 +1,313 @@
+#include "GensysLakes.h"
+#include "GensysParallel.h"
+#include "GensysUnionFind.h"
+#include "GensysRiverSplines.h"
+#include "Misc/FileHelper.h"
+#include "GensysBenchmark.h"
+
+//external JSON library by nlohmann
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+namespace
+{
+	// Moore neighbourhood, clockwise from the west
+	const int32 MooreX[8] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+	const int32 MooreY[8] = { 0, -1, -1, -1, 0, 1, 1, 1 };
+
+	// Moore neighbour tracing of the outer boundary, starting from the first pixel of the component in raster order
+	void TraceOutline(const TArray64<int64>& Labels, int32 Width, int32 Height, int64 Start, TArray<FVector2f>& Out)
+	{
+		const int64 Label = Labels[Start];
+		const auto IsInside = [&](int32 X, int32 Y)
+		{
+			return X >= 0 && Y >= 0 && X < Width && Y < Height && Labels[(int64)Y * Width + X] == Label;
+		};
+
+		const int32 StartX = (int32)(Start % Width);
+		const int32 StartY = (int32)(Start / Width);
+		int32 X = StartX;
+		int32 Y = StartY;
+		// the western neighbour of the first pixel is outside by construction
+		int32 SearchFrom = 0;
+		int32 FirstMove = INDEX_NONE;
+
+		Out.Add(FVector2f(X + 0.5f, Y + 0.5f));
+
+		while (true)
+		{
+			int32 Move = INDEX_NONE;
+			for (int32 Step = 0; Step < 8 && Move == INDEX_NONE; ++Step)
+			{
+				const int32 Direction = (SearchFrom + Step) % 8;
+				if (IsInside(X + MooreX[Direction], Y + MooreY[Direction]))
+					Move = Direction;
+			}
+
+			// single pixel lake
+			if (Move == INDEX_NONE)
+				return;
+
+			// back at the start heading the same way, the boundary is closed
+			if (X == StartX && Y == StartY)
+			{
+				if (Move == FirstMove)
+					break;
+				if (FirstMove == INDEX_NONE)
+					FirstMove = Move;
+			}
+
+			X += MooreX[Move];
+			Y += MooreY[Move];
+			SearchFrom = (Move + 6) % 8;
+			Out.Add(FVector2f(X + 0.5f, Y + 0.5f));
+		}
+	}
+}
+
+void GensysLakes::FillDepressions(const FGensysHeightMap& Heights, FGensysHeightMap& OutFilled, FGensysBufferPool* Pool)
+{
+	const int32 Width = Heights.Width;
+	const int32 Height = Heights.Height;
+
+	OutFilled.Init(Width, Height, Pool);
+	FMemory::Memcpy(OutFilled.Values.GetData(), Heights.Values.GetData(), Heights.GetAllocatedSize());
+
+	// a bit per pixel, TBitArray indices stop at 2^31
+	TArray64<uint64> Closed;
+	Closed.SetNumZeroed((Heights.Num() + 63) / 64);
+	TArray<TArray64<int64>> Buckets;
+	Buckets.SetNum(MAX_uint16 + 1);
+
+	const auto IsClosed = [&Closed](int64 Index) { return (Closed[Index >> 6] >> (Index & 63)) & 1; };
+	const auto Push = [&](int64 Index)
+	{
+		Closed[Index >> 6] |= 1ull << (Index & 63);
+		Buckets[OutFilled.Values[Index]].Add(Index);
+	};
+
+	// water leaves the map over its border
+	for (int32 X = 0; X < Width; ++X)
+	{
+		Push(X);
+		if (Height > 1)
+			Push((int64)(Height - 1) * Width + X);
+	}
+	for (int32 Y = 1; Y < Height - 1; ++Y)
+	{
+		Push((int64)Y * Width);
+		if (Width > 1)
+			Push((int64)Y * Width + Width - 1);
+	}
+
+	// levels only ever grow, a single sweep over the buckets sees every pixel once
+	for (int32 Level = 0; Level <= MAX_uint16; ++Level)
+	{
+		TArray64<int64>& Bucket = Buckets[Level];
+		while (Bucket.Num() > 0)
+		{
+			const int64 Index = Bucket.Pop(false);
+			const int32 X = (int32)(Index % Width);
+			const int32 Y = (int32)(Index / Width);
+
+			for (int32 Direction = 0; Direction < 8; ++Direction)
+			{
+				const int32 NX = X + MooreX[Direction];
+				const int32 NY = Y + MooreY[Direction];
+				if (NX < 0 || NY < 0 || NX >= Width || NY >= Height)
+					continue;
+
+				const int64 Neighbour = (int64)NY * Width + NX;
+				if (IsClosed(Neighbour))
+					continue;
+
+				OutFilled.Values[Neighbour] = FMath::Max(OutFilled.Values[Neighbour], (uint16)Level);
+				Push(Neighbour);
+			}
+		}
+
+		Bucket.Empty();
+	}
+}
+
+int32 GensysLakes::LabelComponents(const FGensysMaskMap& Mask, TArray64<int64>& OutLabels)
+{
+	const int32 Width = Mask.Width;
+	const int32 Height = Mask.Height;
+	const int32 RowsPerBlock = GensysParallel::DefaultRowsPerBlock;
+
+	OutLabels.SetNumUninitialized(Mask.Num());
+
+	// every block only links pixels of its own rows, so the blocks never touch the same parents
+	GensysParallel::ForRowBlocks(Height, RowsPerBlock, [&](int32 RowBegin, int32 RowEnd)
+	{
+		for (int32 Y = RowBegin; Y < RowEnd; ++Y)
+		{
+			for (int32 X = 0; X < Width; ++X)
+			{
+				const int64 Index = (int64)Y * Width + X;
+				if (Mask.Values[Index] == 0)
+				{
+					OutLabels[Index] = INDEX_NONE;
+					continue;
+				}
+
+				OutLabels[Index] = Index;
+				if (X > 0 && Mask.Values[Index - 1] != 0)
+					GensysUnionFind::Union(OutLabels, Index, Index - 1);
+
+				if (Y == RowBegin)
+					continue;
+
+				// north west, north and north east
+				for (int32 Direction = 1; Direction < 4; ++Direction)
+				{
+					const int32 NX = X + MooreX[Direction];
+					if (NX >= 0 && NX < Width && Mask.Values[Index - Width + NX - X] != 0)
+						GensysUnionFind::Union(OutLabels, Index, Index - Width + NX - X);
+				}
+			}
+		}
+	});
+
+	// first row of every block against the last row of the previous one
+	for (int32 Y = RowsPerBlock; Y < Height; Y += RowsPerBlock)
+	{
+		for (int32 X = 0; X < Width; ++X)
+		{
+			const int64 Index = (int64)Y * Width + X;
+			if (OutLabels[Index] == INDEX_NONE)
+				continue;
+
+			for (int32 Direction = 1; Direction < 4; ++Direction)
+			{
+				const int32 NX = X + MooreX[Direction];
+				if (NX >= 0 && NX < Width && OutLabels[Index - Width + NX - X] != INDEX_NONE)
+					GensysUnionFind::Union(OutLabels, Index, Index - Width + NX - X);
+			}
+		}
+	}
+
+	// parents always precede their children, by the time a pixel is reached its parent already holds the final label
+	int32 NumComponents = 0;
+	for (int64 Index = 0; Index < OutLabels.Num(); ++Index)
+	{
+		const int64 Parent = OutLabels[Index];
+		if (Parent == INDEX_NONE)
+			continue;
+
+		OutLabels[Index] = Parent == Index ? NumComponents++ : OutLabels[Parent];
+	}
+
+	return NumComponents;
+}
+
+void GensysLakes::Detect(const FGensysHeightMap& Heights, const FGensysLakeSettings& Settings, FGensysMaskMap& OutMask, TArray<FGensysLake>& OutLakes,
+	FGensysBufferPool* Pool)
+{
+	const int32 Width = Heights.Width;
+	OutLakes.Reset();
+
+	FGensysHeightMap Filled;
+	FillDepressions(Heights, Filled, Pool);
+
+	// everything the flood raised is under water
+	OutMask.Init(Width, Heights.Height, Pool);
+	GensysParallel::ForRowBlocks(Heights.Height, GensysParallel::DefaultRowsPerBlock, [&](int32 RowBegin, int32 RowEnd)
+	{
+		for (int64 Index = (int64)RowBegin * Width; Index < (int64)RowEnd * Width; ++Index)
+			OutMask.Values[Index] = Filled.Values[Index] > Heights.Values[Index] ? MAX_uint8 : 0;
+	});
+
+	TArray64<int64> Labels;
+	const int32 NumBasins = LabelComponents(OutMask, Labels);
+
+	// a flooded basin is flat, any of its pixels gives the spill height
+	TArray<FGensysLake> Basins;
+	TArray<int64> FirstPixels;
+	Basins.SetNum(NumBasins);
+	FirstPixels.Init(INDEX_NONE, NumBasins);
+
+	for (int64 Index = 0; Index < Labels.Num(); ++Index)
+	{
+		if (Labels[Index] == INDEX_NONE)
+			continue;
+
+		const int32 Label = (int32)Labels[Index];
+
+		FGensysLake& Basin = Basins[Label];
+		if (FirstPixels[Label] == INDEX_NONE)
+		{
+			FirstPixels[Label] = Index;
+			Basin.SpillHeight = Filled.Get(Index);
+		}
+
+		++Basin.Area;
+		Basin.MaxDepth = FMath::Max(Basin.MaxDepth, Filled.Get(Index) - Heights.Get(Index));
+	}
+
+	TBitArray<> Kept(false, NumBasins);
+	for (int32 Label = 0; Label < NumBasins; ++Label)
+	{
+		FGensysLake& Basin = Basins[Label];
+		if (Basin.Area < Settings.MinArea || Basin.MaxDepth < Settings.MinDepth)
+			continue;
+
+		Kept[Label] = true;
+		TraceOutline(Labels, Width, Heights.Height, FirstPixels[Label], Basin.Outline);
+
+		// the trace ends on its first point, simplified as an open line then closed again
+		GensysRiverSplines::Simplify(Basin.Outline, Settings.OutlineTolerance);
+		if (Basin.Outline.Num() > 1)
+			Basin.Outline.Pop();
+
+		OutLakes.Add(MoveTemp(Basin));
+	}
+
+	// puddles too small or too shallow are not lakes
+	GensysParallel::ForRowBlocks(Heights.Height, GensysParallel::DefaultRowsPerBlock, [&](int32 RowBegin, int32 RowEnd)
+	{
+		for (int64 Index = (int64)RowBegin * Width; Index < (int64)RowEnd * Width; ++Index)
+		{
+			if (Labels[Index] != INDEX_NONE && !Kept[(int32)Labels[Index]])
+				OutMask.Values[Index] = 0;
+		}
+	});
+}
+
+bool GensysLakes::SaveJson(const TArray<FGensysLake>& Lakes, int32 Width, int32 Height, const FString& Path)
+{
+	json LakeList = json::array();
+	for (const FGensysLake& Lake : Lakes)
+	{
+		json Outline = json::array();
+		for (const FVector2f& Point : Lake.Outline)
+			Outline.push_back({ Point.X / FMath::Max(Width, 1), Point.Y / FMath::Max(Height, 1) });
+
+		LakeList.push_back({
+			{ "Area", Lake.Area },
+			{ "SpillHeight", Lake.SpillHeight },
+			{ "MaxDepth", Lake.MaxDepth },
+			{ "Outline", Outline }
+		});
+	}
+
+	json Out;
+	Out["Width"] = Width;
+	Out["Height"] = Height;
+	Out["Lakes"] = LakeList;
+
+	return FFileHelper::SaveStringToFile(UTF8_TO_TCHAR(Out.dump().c_str()), *Path);
+}
+
+// Gensys.Benchmark stage
+namespace
+{
+	FGensysBenchmarkStage LakesStage("Lakes", true, [](const FGensysBenchmarkInputs& Inputs) -> FGensysBenchmarkStage::FBody
+	{
+		TSharedRef<FGensysMaskMap> Mask = MakeShared<FGensysMaskMap>();
+		TSharedRef<TArray<FGensysLake>> Lakes = MakeShared<TArray<FGensysLake>>();
+		return [Mask, Lakes, &Heights = Inputs.Heights]() { GensysLakes::Detect(Heights, FGensysLakeSettings(), *Mask, *Lakes); };
+	});
+}
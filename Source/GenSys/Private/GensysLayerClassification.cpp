@@ -0,0 +1,238 @@
+#include "GensysLayerClassification.h"
+#include "GensysParallel.h"
+#include "ImageCore.h"
+#include "ImageUtils.h"
+#include "Misc/FileHelper.h"
+#include "GensysJson.h"
+#include "GensysTerrainAttributes.h"
+#include "GensysBenchmark.h"
+
+using json = nlohmann::json;
+
+namespace
+{
+	// A missing range keeps the default, anything but two numbers is an error
+	bool ParseRange(const json& Rule, const char* Key, FVector2f& InOut, FString& OutError)
+	{
+		if (!Rule.contains(Key))
+			return true;
+
+		const json& Range = Rule[Key];
+		if (!Range.is_array() || Range.size() != 2 || !Range[0].is_number() || !Range[1].is_number())
+		{
+			OutError = FString::Printf(TEXT("%s should be an array of two numbers"), UTF8_TO_TCHAR(Key));
+			return false;
+		}
+
+		InOut = FVector2f(Range[0].get<float>(), Range[1].get<float>());
+		return true;
+	}
+}
+
+void FGensysLayerWeights::ExtractLayer(int32 Layer, FGensysMaskMap& Out, FGensysBufferPool* Pool) const
+{
+	Out.Init(Width, Height, Pool);
+
+	GensysParallel::ForRowBlocks(Height, GensysParallel::DefaultRowsPerBlock, [&](int32 RowBegin, int32 RowEnd)
+	{
+		for (int64 Index = (int64)RowBegin * Width; Index < (int64)RowEnd * Width; ++Index)
+		{
+			// a layer holds at most one slot of a pixel
+			uint8 Weight = 0;
+			for (int32 Slot = 0; Slot < LayersPerPixel; ++Slot)
+			{
+				if (Ids[(int64)Index * LayersPerPixel + Slot] == Layer)
+				{
+					Weight = Weights[(int64)Index * LayersPerPixel + Slot];
+					break;
+				}
+			}
+			Out.Values[Index] = Weight;
+		}
+	});
+}
+
+bool FGensysLayerWeights::Save(const FString& IdsPath, const FString& WeightsPath) const
+{
+	static_assert(LayersPerPixel == 4, "a layer per RGBA channel");
+
+	FImage IdsImage(Width, Height, ERawImageFormat::BGRA8, EGammaSpace::Linear);
+	FImage WeightsImage(Width, Height, ERawImageFormat::BGRA8, EGammaSpace::Linear);
+	TArrayView64<FColor> IdTexels = IdsImage.AsBGRA8();
+	TArrayView64<FColor> WeightTexels = WeightsImage.AsBGRA8();
+
+	for (int64 Index = 0; Index < IdTexels.Num(); ++Index)
+	{
+		const uint8* PixelIds = &Ids[Index * LayersPerPixel];
+		const uint8* PixelWeights = &Weights[Index * LayersPerPixel];
+		IdTexels[Index] = FColor(PixelIds[0], PixelIds[1], PixelIds[2], PixelIds[3]);
+		WeightTexels[Index] = FColor(PixelWeights[0], PixelWeights[1], PixelWeights[2], PixelWeights[3]);
+	}
+
+	return FImageUtils::SaveImageByExtension(*IdsPath, IdsImage) && FImageUtils::SaveImageByExtension(*WeightsPath, WeightsImage);
+}
+
+bool GensysLayerClassification::LoadRules(const FString& Path, TArray<FGensysLayerRule>& OutRules, FString& OutError)
+{
+	FString Text;
+	if (!FFileHelper::LoadFileToString(Text, *Path))
+	{
+		OutError = "cannot read the file";
+		return false;
+	}
+
+	const json Document = json::parse(TCHAR_TO_UTF8(*Text), nullptr, false);
+	if (Document.is_discarded() || !Document.contains("Layers") || !Document["Layers"].is_array())
+	{
+		OutError = "expected an object with a \"Layers\" array";
+		return false;
+	}
+
+	OutRules.Reset();
+	OutError.Reset();
+	for (const json& Layer : Document["Layers"])
+	{
+		FGensysLayerRule& Rule = OutRules.AddDefaulted_GetRef();
+		std::string Name = "Layer";
+
+		const bool bParsed = Layer.is_object()
+			&& GensysJson::Read(Layer, "Name", Name, OutError)
+			&& ParseRange(Layer, "Height", Rule.Height, OutError)
+			&& ParseRange(Layer, "Slope", Rule.Slope, OutError)
+			&& ParseRange(Layer, "River", Rule.River, OutError)
+			&& GensysJson::Read(Layer, "Blend", Rule.Blend, OutError)
+			&& GensysJson::Read(Layer, "Weight", Rule.Weight, OutError);
+
+		if (!bParsed)
+		{
+			OutError = FString::Printf(TEXT("layer %d: %s"), OutRules.Num() - 1, OutError.IsEmpty() ? TEXT("expected an object") : *OutError);
+			OutRules.Reset();
+			return false;
+		}
+
+		Rule.Name = UTF8_TO_TCHAR(Name.c_str());
+	}
+
+	if (OutRules.Num() == 0 || OutRules.Num() > FGensysLayerWeights::MaxLayers)
+	{
+		OutError = FString::Printf(TEXT("between 1 and %d layers expected, got %d"), FGensysLayerWeights::MaxLayers, OutRules.Num());
+		return false;
+	}
+
+	return true;
+}
+
+void GensysLayerClassification::Classify(const TArray<FGensysLayerRule>& Rules, const FGensysHeightMap& Heights, const FGensysMaskMap& Slope,
+	const FGensysMap* RiverProximity, FGensysLayerWeights& Out, FGensysBufferPool* Pool)
+{
+	constexpr int32 K = FGensysLayerWeights::LayersPerPixel;
+	const int32 Width = Heights.Width;
+	const int32 NumRules = FMath::Min(Rules.Num(), FGensysLayerWeights::MaxLayers);
+
+	Out.Width = Width;
+	Out.Height = Heights.Height;
+	Out.NumLayers = NumRules;
+	Out.Ids.Allocate((int64)Heights.Num() * K, Pool);
+	Out.Weights.Allocate((int64)Heights.Num() * K, Pool);
+
+	GensysParallel::ForRowBlocks(Heights.Height, GensysParallel::DefaultRowsPerBlock, [&](int32 RowBegin, int32 RowEnd)
+	{
+		// a row of every attribute and of every rule weight, structure of arrays
+		TArray<float> HeightRow, SlopeRow, RiverRow, RuleWeights;
+		HeightRow.SetNumUninitialized(Width);
+		SlopeRow.SetNumUninitialized(Width);
+		RiverRow.SetNumZeroed(Width);
+		RuleWeights.SetNumUninitialized(NumRules * Width);
+
+		for (int32 Y = RowBegin; Y < RowEnd; ++Y)
+		{
+			const int64 RowStart = (int64)Y * Width;
+			for (int32 X = 0; X < Width; ++X)
+			{
+				HeightRow[X] = Heights.Get(RowStart + X);
+				SlopeRow[X] = Slope.Get(RowStart + X);
+			}
+
+			if (RiverProximity)
+				FMemory::Memcpy(RiverRow.GetData(), &RiverProximity->Values[RowStart], Width * sizeof(float));
+
+			for (int32 RuleIndex = 0; RuleIndex < NumRules; ++RuleIndex)
+			{
+				const FGensysLayerRule& Rule = Rules[RuleIndex];
+				const float InvBlend = 1.f / FMath::Max(Rule.Blend, 1e-4f);
+				float* Weights = &RuleWeights[RuleIndex * Width];
+
+				for (int32 X = 0; X < Width; ++X)
+				{
+					Weights[X] = Rule.Weight * GetMembership(HeightRow[X], Rule.Height, InvBlend) * GetMembership(SlopeRow[X], Rule.Slope, InvBlend)
+						* GetMembership(RiverRow[X], Rule.River, InvBlend);
+				}
+			}
+
+			for (int32 X = 0; X < Width; ++X)
+			{
+				// strongest K rules by insertion, K is tiny
+				int32 TopIds[K] = { FGensysLayerWeights::EmptyId, FGensysLayerWeights::EmptyId, FGensysLayerWeights::EmptyId, FGensysLayerWeights::EmptyId };
+				float TopWeights[K] = {};
+				for (int32 RuleIndex = 0; RuleIndex < NumRules; ++RuleIndex)
+				{
+					float Weight = RuleWeights[RuleIndex * Width + X];
+					if (Weight <= TopWeights[K - 1])
+						continue;
+
+					int32 Slot = K - 1;
+					for (; Slot > 0 && TopWeights[Slot - 1] < Weight; --Slot)
+					{
+						TopWeights[Slot] = TopWeights[Slot - 1];
+						TopIds[Slot] = TopIds[Slot - 1];
+					}
+					TopWeights[Slot] = Weight;
+					TopIds[Slot] = RuleIndex;
+				}
+
+				float Total = 0.f;
+				for (int32 Slot = 0; Slot < K; ++Slot)
+					Total += TopWeights[Slot];
+
+				if (Total <= 0.f)
+				{
+					TopWeights[0] = Total = 1.f;
+					TopIds[0] = 0;
+				}
+
+				// quantised so the weights of the pixel add up to exactly 255, the rounding goes to the strongest
+				uint8* PixelIds = &Out.Ids[(int64)(RowStart + X) * K];
+				uint8* PixelWeights = &Out.Weights[(int64)(RowStart + X) * K];
+				int32 Remaining = 255;
+				for (int32 Slot = K - 1; Slot >= 0; --Slot)
+				{
+					const int32 Quantised = Slot == 0 ? Remaining : FMath::FloorToInt(TopWeights[Slot] / Total * 255.f);
+					PixelIds[Slot] = (uint8)TopIds[Slot];
+					PixelWeights[Slot] = (uint8)Quantised;
+					Remaining -= Quantised;
+				}
+			}
+		}
+	});
+}
+
+// Gensys.Benchmark stage, sixteen layers in height and slope bands
+namespace
+{
+	FGensysBenchmarkStage LayerClassificationStage("LayerClassification", true, [](const FGensysBenchmarkInputs& Inputs) -> FGensysBenchmarkStage::FBody
+	{
+		TSharedRef<TArray<FGensysLayerRule>> Rules = MakeShared<TArray<FGensysLayerRule>>();
+		for (int32 Layer = 0; Layer < 16; ++Layer)
+		{
+			FGensysLayerRule& Rule = Rules->AddDefaulted_GetRef();
+			Rule.Height = FVector2f((Layer / 4) * 0.25f, (Layer / 4 + 1) * 0.25f);
+			Rule.Slope = FVector2f((Layer % 4) * 0.25f, (Layer % 4 + 1) * 0.25f);
+		}
+
+		TSharedRef<FGensysTerrainAttributes> Attributes = MakeShared<FGensysTerrainAttributes>();
+		GensysTerrainAttributes::Compute(Inputs.Heights, 64.f, *Attributes);
+
+		TSharedRef<FGensysLayerWeights> Weights = MakeShared<FGensysLayerWeights>();
+		return [Rules, Attributes, Weights, &Heights = Inputs.Heights]() { GensysLayerClassification::Classify(*Rules, Heights, Attributes->Slope, nullptr, *Weights); };
+	});
+}
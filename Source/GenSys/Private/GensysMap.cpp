@@ -0,0 +1,76 @@
+#include "GensysMap.h"
+#include "ImageCore.h"
+#include "ImageUtils.h"
+#include "GensysBenchmark.h"
+
+template<typename StorageType>
+bool GensysImage::LoadMap(const FString& Path, TGensysMap<StorageType>& Out, FGensysBufferPool* Pool)
+{
+	FImage Image;
+	if (!FImageUtils::LoadImage(*Path, Image))
+		return false;
+
+	ImageToMap(Image, Out, Pool);
+	return true;
+}
+
+template<typename StorageType>
+void GensysImage::ImageToMap(FImage& Image, TGensysMap<StorageType>& Out, FGensysBufferPool* Pool)
+{
+	// the core maps hold data, not colour, an 8-bit png would otherwise get the sRGB curve removed
+	Image.GammaSpace = EGammaSpace::Linear;
+
+	// let the engine do the per format decoding and conversion, we only keep the red channel
+	Image.ChangeFormat(ERawImageFormat::RGBA32F, EGammaSpace::Linear);
+	const TArrayView64<FLinearColor> Pixels = Image.AsRGBA32F();
+
+	Out.Init(Image.SizeX, Image.SizeY, Pool);
+	for (int64 Index = 0; Index < Out.Num(); ++Index)
+		Out.Set(Index, Pixels[Index].R);
+}
+
+template<typename StorageType>
+bool GensysImage::SaveMap(const FString& Path, const TGensysMap<StorageType>& Map)
+{
+	if (Map.IsEmpty())
+		return false;
+
+	FImage Image(Map.Width, Map.Height, ERawImageFormat::G16, EGammaSpace::Linear);
+	const TArrayView64<uint16> Pixels = Image.AsG16();
+
+	for (int64 Index = 0; Index < Map.Num(); ++Index)
+		Pixels[Index] = TGensysStorage<uint16>::Encode(Map.Get(Index));
+
+	return FImageUtils::SaveImageByExtension(*Path, Image);
+}
+
+// the storage types used by the stages
+#define INSTANTIATE_GENSYS_IMAGE_IO(StorageType) \
+	template bool GensysImage::LoadMap<StorageType>(const FString&, TGensysMap<StorageType>&, FGensysBufferPool*); \
+	template void GensysImage::ImageToMap<StorageType>(FImage&, TGensysMap<StorageType>&, FGensysBufferPool*); \
+	template bool GensysImage::SaveMap<StorageType>(const FString&, const TGensysMap<StorageType>&);
+
+INSTANTIATE_GENSYS_IMAGE_IO(float)
+INSTANTIATE_GENSYS_IMAGE_IO(FFloat16)
+INSTANTIATE_GENSYS_IMAGE_IO(uint16)
+INSTANTIATE_GENSYS_IMAGE_IO(uint8)
+
+#undef INSTANTIATE_GENSYS_IMAGE_IO
+
+// Gensys.Benchmark stages, the png round trip of the heightmap through the scratch folder
+namespace
+{
+	FGensysBenchmarkStage PngExportStage("PngExport", false, [](const FGensysBenchmarkInputs& Inputs) -> FGensysBenchmarkStage::FBody
+	{
+		return [Path = Inputs.ScratchFolder / "Export.png", &Heights = Inputs.Heights]() { GensysImage::SaveMap(Path, Heights); };
+	});
+
+	FGensysBenchmarkStage PngImportStage("PngImport", false, [](const FGensysBenchmarkInputs& Inputs) -> FGensysBenchmarkStage::FBody
+	{
+		const FString Path = Inputs.ScratchFolder / "Import.png";
+		GensysImage::SaveMap(Path, Inputs.Heights);
+
+		TSharedRef<FGensysHeightMap> Loaded = MakeShared<FGensysHeightMap>();
+		return [Path, Loaded]() { GensysImage::LoadMap(Path, *Loaded); };
+	});
+}
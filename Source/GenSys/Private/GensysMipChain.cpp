@@ -0,0 +1,333 @@
+#include "GensysMipChain.h"
+#include "GensysParallel.h"
+#include "ImageCore.h"
+#include "GensysBenchmark.h"
+
+namespace
+{
+	// texels above this count as covered for the coverage preserving filter
+	constexpr uint8 CoverageThreshold = 127;
+
+	// texels rescaled by a single task of the coverage filter
+	constexpr int32 TexelsPerBlock = 16384;
+
+	int32 GetNumMips(int32 Width, int32 Height)
+	{
+		return FMath::FloorLog2(FMath::Max(Width, Height)) + 1;
+	}
+
+	// Sizes the chain and returns a pointer to the base level
+	template<typename PixelType>
+	PixelType* AllocateChain(int32 Width, int32 Height, FGensysMipChain& Out)
+	{
+		Out.Width = Width;
+		Out.Height = Height;
+		Out.NumMips = GetNumMips(Width, Height);
+		Out.BytesPerPixel = sizeof(PixelType);
+
+		int64 NumPixels = 0;
+		for (int32 Mip = 0; Mip < Out.NumMips; ++Mip)
+			NumPixels += (int64)FMath::Max(Width >> Mip, 1) * FMath::Max(Height >> Mip, 1);
+
+		Out.Data.SetNumUninitialized(NumPixels * sizeof(PixelType));
+		return reinterpret_cast<PixelType*>(Out.Data.GetData());
+	}
+
+	// Reduces every level from the previous one, the rows of a level are split over the task graph
+	// PostLevel runs once a level is complete (used by the coverage filter)
+	template<typename PixelType, typename ReduceFunction, typename PostLevelFunction>
+	void BuildLevels(FGensysMipChain& Chain, ReduceFunction Reduce, PostLevelFunction PostLevel)
+	{
+		PixelType* Source = reinterpret_cast<PixelType*>(Chain.Data.GetData());
+		int32 SourceWidth = Chain.Width;
+		int32 SourceHeight = Chain.Height;
+
+		for (int32 Mip = 1; Mip < Chain.NumMips; ++Mip)
+		{
+			const int32 Width = FMath::Max(SourceWidth / 2, 1);
+			const int32 Height = FMath::Max(SourceHeight / 2, 1);
+			PixelType* Destination = Source + (int64)SourceWidth * SourceHeight;
+
+			GensysParallel::ForRowBlocks(Height, GensysParallel::DefaultRowsPerBlock, [&](int32 RowBegin, int32 RowEnd)
+			{
+				for (int32 Y = RowBegin; Y < RowEnd; ++Y)
+				{
+					// odd sizes repeat the last row/column
+					const PixelType* Row0 = Source + (int64)FMath::Min(Y * 2, SourceHeight - 1) * SourceWidth;
+					const PixelType* Row1 = Source + (int64)FMath::Min(Y * 2 + 1, SourceHeight - 1) * SourceWidth;
+					PixelType* Out = Destination + (int64)Y * Width;
+
+					for (int32 X = 0; X < Width; ++X)
+					{
+						const int32 X0 = FMath::Min(X * 2, SourceWidth - 1);
+						const int32 X1 = FMath::Min(X * 2 + 1, SourceWidth - 1);
+						Out[X] = Reduce(Row0[X0], Row0[X1], Row1[X0], Row1[X1]);
+					}
+				}
+			});
+
+			PostLevel(Destination, (int64)Width * Height);
+
+			Source = Destination;
+			SourceWidth = Width;
+			SourceHeight = Height;
+		}
+	}
+
+	struct FNoPostLevel
+	{
+		template<typename PixelType>
+		void operator()(PixelType*, int64) const {}
+	};
+
+	// per channel histograms, used to measure and rescale the coverage of a level
+	struct FChannelHistograms
+	{
+		int64 Bins[4][256] = {};
+		int64 Total = 0;
+
+		void Add(const FColor* Pixels, int64 Count)
+		{
+			for (int64 Index = 0; Index < Count; ++Index)
+			{
+				++Bins[0][Pixels[Index].B];
+				++Bins[1][Pixels[Index].G];
+				++Bins[2][Pixels[Index].R];
+				++Bins[3][Pixels[Index].A];
+			}
+			Total += Count;
+		}
+
+		// share of texels above the threshold once the channel is scaled
+		double GetCoverage(int32 Channel, float Scale) const
+		{
+			int64 Covered = 0;
+			for (int32 Value = 0; Value < 256; ++Value)
+				if (FMath::Min(Value * Scale, 255.f) > CoverageThreshold)
+					Covered += Bins[Channel][Value];
+
+			return Total > 0 ? (double)Covered / Total : 0.0;
+		}
+	};
+}
+
+void GensysMipChain::Build(const FGensysHeightMap& Base, EGensysMipFilter Filter, FGensysMipChain& Out)
+{
+	uint16* Level0 = AllocateChain<uint16>(Base.Width, Base.Height, Out);
+	FMemory::Memcpy(Level0, Base.Values.GetData(), (int64)Base.Num() * sizeof(uint16));
+
+	if (Filter == EGensysMipFilter::Max)
+	{
+		BuildLevels<uint16>(Out, [](uint16 A, uint16 B, uint16 C, uint16 D)
+		{
+			return FMath::Max(FMath::Max(A, B), FMath::Max(C, D));
+		}, FNoPostLevel());
+	}
+	else
+	{
+		BuildLevels<uint16>(Out, [](uint16 A, uint16 B, uint16 C, uint16 D)
+		{
+			return (uint16)(((uint32)A + B + C + D + 2) / 4);
+		}, FNoPostLevel());
+	}
+}
+
+void GensysMipChain::Build(const FImage& BaseBGRA8, EGensysMipFilter Filter, FGensysMipChain& Out)
+{
+	check(BaseBGRA8.Format == ERawImageFormat::BGRA8);
+
+	FColor* Level0 = AllocateChain<FColor>(BaseBGRA8.SizeX, BaseBGRA8.SizeY, Out);
+	FMemory::Memcpy(Level0, BaseBGRA8.RawData.GetData(), (int64)BaseBGRA8.SizeX * BaseBGRA8.SizeY * sizeof(FColor));
+
+	const auto Average = [](const FColor& A, const FColor& B, const FColor& C, const FColor& D)
+	{
+		return FColor(
+			(uint8)(((uint32)A.R + B.R + C.R + D.R + 2) / 4),
+			(uint8)(((uint32)A.G + B.G + C.G + D.G + 2) / 4),
+			(uint8)(((uint32)A.B + B.B + C.B + D.B + 2) / 4),
+			(uint8)(((uint32)A.A + B.A + C.A + D.A + 2) / 4));
+	};
+
+	switch (Filter)
+	{
+	case EGensysMipFilter::Max:
+		BuildLevels<FColor>(Out, [](const FColor& A, const FColor& B, const FColor& C, const FColor& D)
+		{
+			return FColor(
+				FMath::Max(FMath::Max(A.R, B.R), FMath::Max(C.R, D.R)),
+				FMath::Max(FMath::Max(A.G, B.G), FMath::Max(C.G, D.G)),
+				FMath::Max(FMath::Max(A.B, B.B), FMath::Max(C.B, D.B)),
+				FMath::Max(FMath::Max(A.A, B.A), FMath::Max(C.A, D.A)));
+		}, FNoPostLevel());
+		break;
+
+	case EGensysMipFilter::Mode:
+		BuildLevels<FColor>(Out, [](const FColor& A, const FColor& B, const FColor& C, const FColor& D)
+		{
+			// ties go to the top left texel
+			const FColor Candidates[] = { A, B, C, D };
+			int32 BestCount = 0;
+			FColor Best = A;
+
+			for (const FColor& Candidate : Candidates)
+			{
+				const int32 Count = (Candidate == A) + (Candidate == B) + (Candidate == C) + (Candidate == D);
+				if (Count > BestCount)
+				{
+					BestCount = Count;
+					Best = Candidate;
+				}
+			}
+
+			return Best;
+		}, FNoPostLevel());
+		break;
+
+	case EGensysMipFilter::Coverage:
+	{
+		FChannelHistograms BaseHistograms;
+		BaseHistograms.Add(Level0, (int64)Out.Width * Out.Height);
+
+		BuildLevels<FColor>(Out, Average, [&BaseHistograms](FColor* Pixels, int64 Count)
+		{
+			FChannelHistograms LevelHistograms;
+			LevelHistograms.Add(Pixels, Count);
+
+			// per channel scale found by bisection so the covered share matches the base level
+			float Scales[4];
+			for (int32 Channel = 0; Channel < 4; ++Channel)
+			{
+				const double Target = BaseHistograms.GetCoverage(Channel, 1.f);
+
+				// nothing or everything covered, plain average is already right
+				if (Target <= 0.0 || Target >= 1.0)
+				{
+					Scales[Channel] = 1.f;
+					continue;
+				}
+
+				float Low = 0.f;
+				float High = 4.f;
+
+				for (int32 Iteration = 0; Iteration < 12; ++Iteration)
+				{
+					const float Middle = (Low + High) * 0.5f;
+					if (LevelHistograms.GetCoverage(Channel, Middle) < Target)
+						Low = Middle;
+					else
+						High = Middle;
+				}
+
+				Scales[Channel] = (Low + High) * 0.5f;
+			}
+
+			// split in runs of texels, a level 0 past 46k x 46k has more texels than an int32 counts
+			GensysParallel::ForRowBlocks((int32)FMath::DivideAndRoundUp<int64>(Count, TexelsPerBlock), 1, [&](int32 BlockBegin, int32 BlockEnd)
+			{
+				for (int64 Index = (int64)BlockBegin * TexelsPerBlock; Index < FMath::Min((int64)BlockEnd * TexelsPerBlock, Count); ++Index)
+				{
+					FColor& Pixel = Pixels[Index];
+					Pixel.B = (uint8)FMath::Min(FMath::RoundToInt(Pixel.B * Scales[0]), 255);
+					Pixel.G = (uint8)FMath::Min(FMath::RoundToInt(Pixel.G * Scales[1]), 255);
+					Pixel.R = (uint8)FMath::Min(FMath::RoundToInt(Pixel.R * Scales[2]), 255);
+					Pixel.A = (uint8)FMath::Min(FMath::RoundToInt(Pixel.A * Scales[3]), 255);
+				}
+			});
+		});
+		break;
+	}
+
+	default:
+		BuildLevels<FColor>(Out, Average, FNoPostLevel());
+		break;
+	}
+}
+
+void GensysMipChain::BuildIdWeightPair(const FImage& IdsBGRA8, const FImage& WeightsBGRA8, FGensysMipChain& OutIds, FGensysMipChain& OutWeights)
+{
+	check(IdsBGRA8.Format == ERawImageFormat::BGRA8 && WeightsBGRA8.Format == ERawImageFormat::BGRA8);
+	check(IdsBGRA8.SizeX == WeightsBGRA8.SizeX && IdsBGRA8.SizeY == WeightsBGRA8.SizeY);
+
+	// reduced as one texel so the weights always follow the ID chosen for them
+	struct FIdWeight
+	{
+		FColor Id;
+		FColor Weight;
+	};
+
+	const int32 Width = IdsBGRA8.SizeX;
+	const int32 Height = IdsBGRA8.SizeY;
+	const int64 NumPixels = (int64)Width * Height;
+	const FColor* Ids = reinterpret_cast<const FColor*>(IdsBGRA8.RawData.GetData());
+	const FColor* Weights = reinterpret_cast<const FColor*>(WeightsBGRA8.RawData.GetData());
+
+	FGensysMipChain Pairs;
+	FIdWeight* Level0 = AllocateChain<FIdWeight>(Width, Height, Pairs);
+	for (int64 Index = 0; Index < NumPixels; ++Index)
+		Level0[Index] = { Ids[Index], Weights[Index] };
+
+	BuildLevels<FIdWeight>(Pairs, [](const FIdWeight& A, const FIdWeight& B, const FIdWeight& C, const FIdWeight& D)
+	{
+		// same mode as the ID filter, ties go to the top left texel
+		const FIdWeight* Candidates[] = { &A, &B, &C, &D };
+		int32 BestCount = 0;
+		FColor BestId = A.Id;
+
+		for (const FIdWeight* Candidate : Candidates)
+		{
+			const int32 Count = (Candidate->Id == A.Id) + (Candidate->Id == B.Id) + (Candidate->Id == C.Id) + (Candidate->Id == D.Id);
+			if (Count > BestCount)
+			{
+				BestCount = Count;
+				BestId = Candidate->Id;
+			}
+		}
+
+		uint32 Sums[4] = {};
+		for (const FIdWeight* Candidate : Candidates)
+		{
+			if (Candidate->Id != BestId)
+				continue;
+
+			Sums[0] += Candidate->Weight.R;
+			Sums[1] += Candidate->Weight.G;
+			Sums[2] += Candidate->Weight.B;
+			Sums[3] += Candidate->Weight.A;
+		}
+
+		const uint32 Half = BestCount / 2;
+		return FIdWeight{ BestId, FColor(
+			(uint8)((Sums[0] + Half) / BestCount),
+			(uint8)((Sums[1] + Half) / BestCount),
+			(uint8)((Sums[2] + Half) / BestCount),
+			(uint8)((Sums[3] + Half) / BestCount)) };
+	}, FNoPostLevel());
+
+	// split back into the two texture layouts
+	FColor* IdMips = AllocateChain<FColor>(Width, Height, OutIds);
+	FColor* WeightMips = AllocateChain<FColor>(Width, Height, OutWeights);
+	const FIdWeight* PairMips = reinterpret_cast<const FIdWeight*>(Pairs.Data.GetData());
+	const int64 NumChainPixels = Pairs.Data.Num() / (int64)sizeof(FIdWeight);
+
+	for (int64 Index = 0; Index < NumChainPixels; ++Index)
+	{
+		IdMips[Index] = PairMips[Index].Id;
+		WeightMips[Index] = PairMips[Index].Weight;
+	}
+}
+
+// Gensys.Benchmark stages
+namespace
+{
+	FGensysBenchmarkStage MipChainHeightStage("MipChainHeight", true, [](const FGensysBenchmarkInputs& Inputs) -> FGensysBenchmarkStage::FBody
+	{
+		TSharedRef<FGensysMipChain> Chain = MakeShared<FGensysMipChain>();
+		return [Chain, &Heights = Inputs.Heights]() { GensysMipChain::Build(Heights, EGensysMipFilter::Average, *Chain); };
+	});
+
+	FGensysBenchmarkStage MipChainCoverageStage("MipChainCoverage", true, [](const FGensysBenchmarkInputs& Inputs) -> FGensysBenchmarkStage::FBody
+	{
+		TSharedRef<FGensysMipChain> Chain = MakeShared<FGensysMipChain>();
+		return [Chain, &Colour = Inputs.ColourBGRA8]() { GensysMipChain::Build(Colour, EGensysMipFilter::Coverage, *Chain); };
+	});
+}
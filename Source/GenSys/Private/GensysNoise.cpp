@@ -0,0 +1,604 @@
+#include "GensysNoise.h"
+#include "GensysParallel.h"
+#include "Math/VectorRegister.h"
+#include "GensysBenchmark.h"
+
+// the wide x86 kernels are compiled for their instruction set only, they run once cpuid says so
+#if PLATFORM_CPU_X86_FAMILY && PLATFORM_ENABLE_VECTORINTRINSICS
+	#define GENSYS_NOISE_X86 1
+	#include <immintrin.h>
+	#if PLATFORM_WINDOWS
+		#include <intrin.h>
+	#else
+		#include <cpuid.h>
+	#endif
+	#if defined(__clang__) || defined(__GNUC__)
+		#define GENSYS_TARGET(Isa) __attribute__((target(Isa)))
+	#else
+		#define GENSYS_TARGET(Isa)
+	#endif
+#else
+	#define GENSYS_NOISE_X86 0
+#endif
+
+DEFINE_LOG_CATEGORY_STATIC(LogGensysNoise, Log, All);
+
+namespace
+{
+	// lattice hash, every kernel has to reproduce it bit for bit
+	constexpr uint32 PrimeX = 0x27d4eb2du;
+	constexpr uint32 PrimeY = 0x165667b1u;
+	constexpr uint32 MixA = 0x2c1b3c6du;
+	constexpr uint32 MixB = 0x297a2d39u;
+	constexpr float ValueScale = 1.f / 16777216.f;
+
+	// kernels past this difference to the scalar reference are not used
+	constexpr float VerifyTolerance = 1e-5f;
+
+	// samples of one row evaluated per kernel call, keeps the coordinate and accumulator scratch in L1/L2
+	constexpr int32 SamplesPerChunk = 512;
+
+	// second lattice of the domain warp, decorrelated from the first
+	constexpr uint32 WarpSeed = 0x5bd1e995u;
+
+	FORCEINLINE float HashValue(uint32 CornerX, uint32 CornerY)
+	{
+		uint32 Hash = CornerX ^ CornerY;
+		Hash ^= Hash >> 15;
+		Hash *= MixA;
+		Hash ^= Hash >> 13;
+		Hash *= MixB;
+		Hash ^= Hash >> 16;
+		return (float)(int32)(Hash >> 8) * ValueScale;
+	}
+
+	void EvaluateScalar(const float* X, const float* Y, int32 Count, uint32 Seed, float* Out)
+	{
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			const float CellX = FMath::FloorToFloat(X[Index]);
+			const float CellY = FMath::FloorToFloat(Y[Index]);
+
+			float TX = X[Index] - CellX;
+			float TY = Y[Index] - CellY;
+			TX = TX * TX * (3.f - 2.f * TX);
+			TY = TY * TY * (3.f - 2.f * TY);
+
+			const uint32 HashX0 = (uint32)(int32)CellX * PrimeX;
+			const uint32 HashX1 = HashX0 + PrimeX;
+			const uint32 HashY0 = ((uint32)(int32)CellY * PrimeY) ^ Seed;
+			const uint32 HashY1 = ((uint32)(int32)CellY * PrimeY + PrimeY) ^ Seed;
+
+			const float V00 = HashValue(HashX0, HashY0);
+			const float V10 = HashValue(HashX1, HashY0);
+			const float V01 = HashValue(HashX0, HashY1);
+			const float V11 = HashValue(HashX1, HashY1);
+
+			const float Top = V00 + (V10 - V00) * TX;
+			const float Bottom = V01 + (V11 - V01) * TX;
+			Out[Index] = Top + (Bottom - Top) * TY;
+		}
+	}
+
+	FORCEINLINE VectorRegister4Float HashValue4(const VectorRegister4Int& CornerX, const VectorRegister4Int& CornerY)
+	{
+		VectorRegister4Int Hash = VectorIntXor(CornerX, CornerY);
+		Hash = VectorIntXor(Hash, VectorShiftRightImmLogical(Hash, 15));
+		Hash = VectorIntMultiply(Hash, VectorIntSet1((int32)MixA));
+		Hash = VectorIntXor(Hash, VectorShiftRightImmLogical(Hash, 13));
+		Hash = VectorIntMultiply(Hash, VectorIntSet1((int32)MixB));
+		Hash = VectorIntXor(Hash, VectorShiftRightImmLogical(Hash, 16));
+		return VectorMultiply(VectorIntToFloat(VectorShiftRightImmLogical(Hash, 8)), VectorSetFloat1(ValueScale));
+	}
+
+	FORCEINLINE VectorRegister4Float Fade4(const VectorRegister4Float& T)
+	{
+		return VectorMultiply(VectorMultiply(T, T), VectorSubtract(VectorSetFloat1(3.f), VectorMultiply(VectorSetFloat1(2.f), T)));
+	}
+
+	FORCEINLINE VectorRegister4Float Lerp4(const VectorRegister4Float& A, const VectorRegister4Float& B, const VectorRegister4Float& T)
+	{
+		return VectorAdd(A, VectorMultiply(VectorSubtract(B, A), T));
+	}
+
+	void EvaluateVector4(const float* X, const float* Y, int32 Count, uint32 Seed, float* Out)
+	{
+		const VectorRegister4Int VectorPrimeX = VectorIntSet1((int32)PrimeX);
+		const VectorRegister4Int VectorPrimeY = VectorIntSet1((int32)PrimeY);
+		const VectorRegister4Int VectorSeed = VectorIntSet1((int32)Seed);
+
+		int32 Index = 0;
+		for (; Index + 4 <= Count; Index += 4)
+		{
+			const VectorRegister4Float PositionX = VectorLoad(X + Index);
+			const VectorRegister4Float PositionY = VectorLoad(Y + Index);
+			const VectorRegister4Float CellX = VectorFloor(PositionX);
+			const VectorRegister4Float CellY = VectorFloor(PositionY);
+			const VectorRegister4Float TX = Fade4(VectorSubtract(PositionX, CellX));
+			const VectorRegister4Float TY = Fade4(VectorSubtract(PositionY, CellY));
+
+			const VectorRegister4Int HashX0 = VectorIntMultiply(VectorFloatToInt(CellX), VectorPrimeX);
+			const VectorRegister4Int HashX1 = VectorIntAdd(HashX0, VectorPrimeX);
+			const VectorRegister4Int RowY = VectorIntMultiply(VectorFloatToInt(CellY), VectorPrimeY);
+			const VectorRegister4Int HashY0 = VectorIntXor(RowY, VectorSeed);
+			const VectorRegister4Int HashY1 = VectorIntXor(VectorIntAdd(RowY, VectorPrimeY), VectorSeed);
+
+			const VectorRegister4Float Top = Lerp4(HashValue4(HashX0, HashY0), HashValue4(HashX1, HashY0), TX);
+			const VectorRegister4Float Bottom = Lerp4(HashValue4(HashX0, HashY1), HashValue4(HashX1, HashY1), TX);
+			VectorStore(Lerp4(Top, Bottom, TY), Out + Index);
+		}
+
+		EvaluateScalar(X + Index, Y + Index, Count - Index, Seed, Out + Index);
+	}
+
+#if GENSYS_NOISE_X86
+	GENSYS_TARGET("avx2") FORCEINLINE __m256 HashValue8(__m256i CornerX, __m256i CornerY)
+	{
+		__m256i Hash = _mm256_xor_si256(CornerX, CornerY);
+		Hash = _mm256_xor_si256(Hash, _mm256_srli_epi32(Hash, 15));
+		Hash = _mm256_mullo_epi32(Hash, _mm256_set1_epi32((int32)MixA));
+		Hash = _mm256_xor_si256(Hash, _mm256_srli_epi32(Hash, 13));
+		Hash = _mm256_mullo_epi32(Hash, _mm256_set1_epi32((int32)MixB));
+		Hash = _mm256_xor_si256(Hash, _mm256_srli_epi32(Hash, 16));
+		return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(Hash, 8)), _mm256_set1_ps(ValueScale));
+	}
+
+	GENSYS_TARGET("avx2") FORCEINLINE __m256 Fade8(__m256 T)
+	{
+		return _mm256_mul_ps(_mm256_mul_ps(T, T), _mm256_sub_ps(_mm256_set1_ps(3.f), _mm256_mul_ps(_mm256_set1_ps(2.f), T)));
+	}
+
+	GENSYS_TARGET("avx2") FORCEINLINE __m256 Lerp8(__m256 A, __m256 B, __m256 T)
+	{
+		return _mm256_add_ps(A, _mm256_mul_ps(_mm256_sub_ps(B, A), T));
+	}
+
+	GENSYS_TARGET("avx2") void EvaluateAVX2(const float* X, const float* Y, int32 Count, uint32 Seed, float* Out)
+	{
+		const __m256i VectorPrimeX = _mm256_set1_epi32((int32)PrimeX);
+		const __m256i VectorPrimeY = _mm256_set1_epi32((int32)PrimeY);
+		const __m256i VectorSeed = _mm256_set1_epi32((int32)Seed);
+
+		int32 Index = 0;
+		for (; Index + 8 <= Count; Index += 8)
+		{
+			const __m256 PositionX = _mm256_loadu_ps(X + Index);
+			const __m256 PositionY = _mm256_loadu_ps(Y + Index);
+			const __m256 CellX = _mm256_floor_ps(PositionX);
+			const __m256 CellY = _mm256_floor_ps(PositionY);
+			const __m256 TX = Fade8(_mm256_sub_ps(PositionX, CellX));
+			const __m256 TY = Fade8(_mm256_sub_ps(PositionY, CellY));
+
+			const __m256i HashX0 = _mm256_mullo_epi32(_mm256_cvttps_epi32(CellX), VectorPrimeX);
+			const __m256i HashX1 = _mm256_add_epi32(HashX0, VectorPrimeX);
+			const __m256i RowY = _mm256_mullo_epi32(_mm256_cvttps_epi32(CellY), VectorPrimeY);
+			const __m256i HashY0 = _mm256_xor_si256(RowY, VectorSeed);
+			const __m256i HashY1 = _mm256_xor_si256(_mm256_add_epi32(RowY, VectorPrimeY), VectorSeed);
+
+			const __m256 Top = Lerp8(HashValue8(HashX0, HashY0), HashValue8(HashX1, HashY0), TX);
+			const __m256 Bottom = Lerp8(HashValue8(HashX0, HashY1), HashValue8(HashX1, HashY1), TX);
+			_mm256_storeu_ps(Out + Index, Lerp8(Top, Bottom, TY));
+		}
+
+		EvaluateScalar(X + Index, Y + Index, Count - Index, Seed, Out + Index);
+	}
+
+	GENSYS_TARGET("avx512f") FORCEINLINE __m512 HashValue16(__m512i CornerX, __m512i CornerY)
+	{
+		__m512i Hash = _mm512_xor_si512(CornerX, CornerY);
+		Hash = _mm512_xor_si512(Hash, _mm512_srli_epi32(Hash, 15));
+		Hash = _mm512_mullo_epi32(Hash, _mm512_set1_epi32((int32)MixA));
+		Hash = _mm512_xor_si512(Hash, _mm512_srli_epi32(Hash, 13));
+		Hash = _mm512_mullo_epi32(Hash, _mm512_set1_epi32((int32)MixB));
+		Hash = _mm512_xor_si512(Hash, _mm512_srli_epi32(Hash, 16));
+		return _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_srli_epi32(Hash, 8)), _mm512_set1_ps(ValueScale));
+	}
+
+	GENSYS_TARGET("avx512f") FORCEINLINE __m512 Fade16(__m512 T)
+	{
+		return _mm512_mul_ps(_mm512_mul_ps(T, T), _mm512_sub_ps(_mm512_set1_ps(3.f), _mm512_mul_ps(_mm512_set1_ps(2.f), T)));
+	}
+
+	GENSYS_TARGET("avx512f") FORCEINLINE __m512 Lerp16(__m512 A, __m512 B, __m512 T)
+	{
+		return _mm512_add_ps(A, _mm512_mul_ps(_mm512_sub_ps(B, A), T));
+	}
+
+	GENSYS_TARGET("avx512f") void EvaluateAVX512(const float* X, const float* Y, int32 Count, uint32 Seed, float* Out)
+	{
+		const __m512i VectorPrimeX = _mm512_set1_epi32((int32)PrimeX);
+		const __m512i VectorPrimeY = _mm512_set1_epi32((int32)PrimeY);
+		const __m512i VectorSeed = _mm512_set1_epi32((int32)Seed);
+
+		int32 Index = 0;
+		for (; Index + 16 <= Count; Index += 16)
+		{
+			const __m512 PositionX = _mm512_loadu_ps(X + Index);
+			const __m512 PositionY = _mm512_loadu_ps(Y + Index);
+			const __m512 CellX = _mm512_roundscale_ps(PositionX, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+			const __m512 CellY = _mm512_roundscale_ps(PositionY, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+			const __m512 TX = Fade16(_mm512_sub_ps(PositionX, CellX));
+			const __m512 TY = Fade16(_mm512_sub_ps(PositionY, CellY));
+
+			const __m512i HashX0 = _mm512_mullo_epi32(_mm512_cvttps_epi32(CellX), VectorPrimeX);
+			const __m512i HashX1 = _mm512_add_epi32(HashX0, VectorPrimeX);
+			const __m512i RowY = _mm512_mullo_epi32(_mm512_cvttps_epi32(CellY), VectorPrimeY);
+			const __m512i HashY0 = _mm512_xor_si512(RowY, VectorSeed);
+			const __m512i HashY1 = _mm512_xor_si512(_mm512_add_epi32(RowY, VectorPrimeY), VectorSeed);
+
+			const __m512 Top = Lerp16(HashValue16(HashX0, HashY0), HashValue16(HashX1, HashY0), TX);
+			const __m512 Bottom = Lerp16(HashValue16(HashX0, HashY1), HashValue16(HashX1, HashY1), TX);
+			_mm512_storeu_ps(Out + Index, Lerp16(Top, Bottom, TY));
+		}
+
+		EvaluateScalar(X + Index, Y + Index, Count - Index, Seed, Out + Index);
+	}
+
+	void CpuId(int32 Leaf, int32 SubLeaf, uint32 (&OutRegisters)[4])
+	{
+	#if PLATFORM_WINDOWS
+		int32 Registers[4];
+		__cpuidex(Registers, Leaf, SubLeaf);
+		FMemory::Memcpy(OutRegisters, Registers, sizeof(Registers));
+	#else
+		__cpuid_count(Leaf, SubLeaf, OutRegisters[0], OutRegisters[1], OutRegisters[2], OutRegisters[3]);
+	#endif
+	}
+
+	// register state the OS saves on a context switch, the wide registers are unusable without it
+	uint64 GetEnabledRegisterState()
+	{
+	#if PLATFORM_WINDOWS
+		return _xgetbv(0);
+	#else
+		uint32 Low = 0;
+		uint32 High = 0;
+		__asm__ volatile("xgetbv" : "=a"(Low), "=d"(High) : "c"(0));
+		return ((uint64)High << 32) | Low;
+	#endif
+	}
+
+	bool DetectSupport(EGensysNoiseKernel Kernel)
+	{
+		uint32 Leaf1[4];
+		CpuId(1, 0, Leaf1);
+
+		const bool bOSXSave = (Leaf1[2] & (1u << 27)) != 0;
+		const bool bAVX = (Leaf1[2] & (1u << 28)) != 0;
+		if (!bOSXSave || !bAVX)
+			return false;
+
+		uint32 Leaf7[4];
+		CpuId(7, 0, Leaf7);
+		const uint64 RegisterState = GetEnabledRegisterState();
+
+		if (Kernel == EGensysNoiseKernel::AVX2)
+			return (RegisterState & 0x6) == 0x6 && (Leaf7[1] & (1u << 5)) != 0;
+
+		// opmask and both halves of the zmm registers on top of the ymm state
+		return (RegisterState & 0xe6) == 0xe6 && (Leaf7[1] & (1u << 16)) != 0;
+	}
+#endif
+
+	using FEvaluateFunction = void(*)(const float* X, const float* Y, int32 Count, uint32 Seed, float* Out);
+
+	FEvaluateFunction GetFunction(EGensysNoiseKernel Kernel)
+	{
+		switch (Kernel)
+		{
+		case EGensysNoiseKernel::Vector4:
+			return &EvaluateVector4;
+#if GENSYS_NOISE_X86
+		case EGensysNoiseKernel::AVX2:
+			return &EvaluateAVX2;
+		case EGensysNoiseKernel::AVX512:
+			return &EvaluateAVX512;
+#endif
+		default:
+			return &EvaluateScalar;
+		}
+	}
+
+	EGensysNoiseKernel DetectBestKernel()
+	{
+		for (int32 Kernel = (int32)EGensysNoiseKernel::Count - 1; Kernel > (int32)EGensysNoiseKernel::Scalar; --Kernel)
+		{
+			const EGensysNoiseKernel Candidate = (EGensysNoiseKernel)Kernel;
+			if (!GensysNoise::IsKernelSupported(Candidate))
+				continue;
+
+			const float Difference = GensysNoise::VerifyKernel(Candidate);
+			if (Difference <= VerifyTolerance)
+			{
+				UE_LOG(LogGensysNoise, Log, TEXT("Using the %s noise kernel"), GensysNoise::GetKernelName(Candidate));
+				return Candidate;
+			}
+
+			UE_LOG(LogGensysNoise, Warning, TEXT("The %s noise kernel differs from the scalar reference by %f, skipped"), GensysNoise::GetKernelName(Candidate), Difference);
+		}
+
+		return EGensysNoiseKernel::Scalar;
+	}
+}
+
+EGensysNoiseKernel GensysNoise::GetBestKernel()
+{
+	static const EGensysNoiseKernel BestKernel = DetectBestKernel();
+	return BestKernel;
+}
+
+bool GensysNoise::IsKernelSupported(EGensysNoiseKernel Kernel)
+{
+	switch (Kernel)
+	{
+	case EGensysNoiseKernel::Scalar:
+		return true;
+	case EGensysNoiseKernel::Vector4:
+		return PLATFORM_ENABLE_VECTORINTRINSICS != 0;
+#if GENSYS_NOISE_X86
+	case EGensysNoiseKernel::AVX2:
+	case EGensysNoiseKernel::AVX512:
+	{
+		static const bool bAVX2 = DetectSupport(EGensysNoiseKernel::AVX2);
+		static const bool bAVX512 = DetectSupport(EGensysNoiseKernel::AVX512);
+		return Kernel == EGensysNoiseKernel::AVX2 ? bAVX2 : bAVX512;
+	}
+#endif
+	default:
+		return false;
+	}
+}
+
+const TCHAR* GensysNoise::GetKernelName(EGensysNoiseKernel Kernel)
+{
+	switch (Kernel)
+	{
+	case EGensysNoiseKernel::Vector4:
+		return TEXT("Vector4");
+	case EGensysNoiseKernel::AVX2:
+		return TEXT("AVX2");
+	case EGensysNoiseKernel::AVX512:
+		return TEXT("AVX512");
+	default:
+		return TEXT("Scalar");
+	}
+}
+
+float GensysNoise::VerifyKernel(EGensysNoiseKernel Kernel)
+{
+	if (!IsKernelSupported(Kernel))
+		return MAX_flt;
+
+	// negative, lattice aligned and large coordinates, not a multiple of any kernel width
+	constexpr int32 NumSamples = 4099;
+	TArray<float> X;
+	TArray<float> Y;
+	X.SetNumUninitialized(NumSamples);
+	Y.SetNumUninitialized(NumSamples);
+
+	for (int32 Index = 0; Index < NumSamples; ++Index)
+	{
+		X[Index] = (Index % 7 == 0) ? (float)(Index - NumSamples / 2) : (Index - NumSamples / 2) * 0.37f;
+		Y[Index] = (Index % 5 == 0) ? (float)(Index / 3) : Index * -1.93f + 12345.f;
+	}
+
+	TArray<float> Expected;
+	TArray<float> Actual;
+	Expected.SetNumUninitialized(NumSamples);
+	Actual.SetNumUninitialized(NumSamples);
+
+	EvaluateScalar(X.GetData(), Y.GetData(), NumSamples, 0x9e3779b9u, Expected.GetData());
+	GetFunction(Kernel)(X.GetData(), Y.GetData(), NumSamples, 0x9e3779b9u, Actual.GetData());
+
+	float Difference = 0.f;
+	for (int32 Index = 0; Index < NumSamples; ++Index)
+		Difference = FMath::Max(Difference, FMath::Abs(Expected[Index] - Actual[Index]));
+
+	return Difference;
+}
+
+void GensysNoise::Evaluate(const float* X, const float* Y, int32 Count, uint32 Seed, float* Out, EGensysNoiseKernel Kernel)
+{
+	if (!IsKernelSupported(Kernel))
+		Kernel = EGensysNoiseKernel::Scalar;
+
+	GetFunction(Kernel)(X, Y, Count, Seed, Out);
+}
+
+void GensysNoise::Generate(const FGensysNoiseSettings& Settings, int32 Width, int32 Height, FGensysHalfMap& Out, FGensysBufferPool* Pool, EGensysNoiseKernel Kernel)
+{
+	FGensysHalfMap* Layers[(int32)EGensysNoiseMode::Count] = { &Out };
+	GenerateLayers(Settings, Width, Height, Layers, Pool, Kernel);
+}
+
+void GensysNoise::Generate(const FGensysNoiseSettings& Settings, EGensysNoiseMode Mode, int32 Width, int32 Height, FGensysHalfMap& Out, FGensysBufferPool* Pool)
+{
+	FGensysHalfMap* Layers[(int32)EGensysNoiseMode::Count] = {};
+	Layers[(int32)Mode] = &Out;
+	GenerateLayers(Settings, Width, Height, Layers, Pool);
+}
+
+void GensysNoise::GenerateLayers(const FGensysNoiseSettings& Settings, int32 Width, int32 Height, FGensysHalfMap* (&OutLayers)[(int32)EGensysNoiseMode::Count],
+	FGensysBufferPool* Pool, EGensysNoiseKernel Kernel)
+{
+	FGensysHalfMap* const FbmLayer = OutLayers[(int32)EGensysNoiseMode::Fbm];
+	FGensysHalfMap* const RidgedLayer = OutLayers[(int32)EGensysNoiseMode::Ridged];
+	FGensysHalfMap* const BillowLayer = OutLayers[(int32)EGensysNoiseMode::Billow];
+	FGensysHalfMap* const WarpedLayer = OutLayers[(int32)EGensysNoiseMode::Warped];
+
+	for (FGensysHalfMap* Layer : OutLayers)
+	{
+		if (Layer)
+			Layer->Init(Width, Height, Pool);
+	}
+
+	if (!IsKernelSupported(Kernel))
+		Kernel = EGensysNoiseKernel::Scalar;
+
+	const FEvaluateFunction Evaluate = GetFunction(Kernel);
+	const int32 Octaves = FMath::Max(Settings.Octaves, 1);
+	const float BaseFrequency = 1.f / FMath::Max(Settings.CellSize, 1.f);
+
+	float AmplitudeSum = 0.f;
+	for (int32 Octave = 0; Octave < Octaves; ++Octave)
+		AmplitudeSum += FMath::Pow(Settings.Persistence, (float)Octave);
+
+	// the ridges peak at Offset squared
+	const float RidgedScale = 1.f / (AmplitudeSum * FMath::Max(Settings.RidgeOffset * Settings.RidgeOffset, KINDA_SMALL_NUMBER));
+
+	GensysParallel::ForRowBlocks(Height, GensysParallel::DefaultRowsPerBlock, [&](int32 RowBegin, int32 RowEnd)
+	{
+		float PixelX[SamplesPerChunk];
+		float PixelY[SamplesPerChunk];
+		float X[SamplesPerChunk];
+		float Y[SamplesPerChunk];
+		float Values[SamplesPerChunk];
+		float Fbm[SamplesPerChunk];
+		float Ridged[SamplesPerChunk];
+		float Billow[SamplesPerChunk];
+		float RidgeWeight[SamplesPerChunk];
+		float WarpY[SamplesPerChunk];
+		float Warped[SamplesPerChunk];
+
+		// the chunk is converted to half only once it is final
+		const auto StoreChunk = [](FGensysHalfMap* Layer, int64 Offset, const float* Chunk, int32 Count)
+		{
+			for (int32 Index = 0; Index < Count; ++Index)
+				Layer->Set(Offset + Index, Chunk[Index]);
+		};
+
+		// plain fBm at arbitrary pixel positions, used by the warp
+		const auto AccumulateFbm = [&](int32 Count, uint32 Seed, float* Out)
+		{
+			float Frequency = BaseFrequency;
+			float Amplitude = 1.f / AmplitudeSum;
+			FMemory::Memzero(Out, Count * sizeof(float));
+
+			for (int32 Octave = 0; Octave < Octaves; ++Octave)
+			{
+				for (int32 Index = 0; Index < Count; ++Index)
+				{
+					X[Index] = PixelX[Index] * Frequency;
+					Y[Index] = PixelY[Index] * Frequency;
+				}
+
+				Evaluate(X, Y, Count, Seed + Octave * 0x9e3779b9u, Values);
+
+				for (int32 Index = 0; Index < Count; ++Index)
+					Out[Index] += Values[Index] * Amplitude;
+
+				Frequency *= Settings.Lacunarity;
+				Amplitude *= Settings.Persistence;
+			}
+		};
+
+		for (int32 Row = RowBegin; Row < RowEnd; ++Row)
+		{
+			const int64 RowOffset = (int64)Row * Width;
+
+			for (int32 Begin = 0; Begin < Width; Begin += SamplesPerChunk)
+			{
+				const int32 Count = FMath::Min(SamplesPerChunk, Width - Begin);
+
+				for (int32 Index = 0; Index < Count; ++Index)
+				{
+					PixelX[Index] = (float)(Begin + Index);
+					PixelY[Index] = (float)Row;
+					Fbm[Index] = 0.f;
+					Ridged[Index] = 0.f;
+					Billow[Index] = 0.f;
+					RidgeWeight[Index] = 1.f;
+				}
+
+				// one lattice evaluation per octave feeds every mode
+				float Frequency = BaseFrequency;
+				float Amplitude = 1.f / AmplitudeSum;
+
+				for (int32 Octave = 0; Octave < Octaves; ++Octave)
+				{
+					for (int32 Index = 0; Index < Count; ++Index)
+					{
+						X[Index] = PixelX[Index] * Frequency;
+						Y[Index] = PixelY[Index] * Frequency;
+					}
+
+					Evaluate(X, Y, Count, Settings.Seed + Octave * 0x9e3779b9u, Values);
+
+					for (int32 Index = 0; Index < Count; ++Index)
+					{
+						const float Value = Values[Index];
+						const float Folded = FMath::Abs(2.f * Value - 1.f);
+						Fbm[Index] += Value * Amplitude;
+						Billow[Index] += Folded * Amplitude;
+
+						// multifractal, the crest of the previous octave decides how much of this one shows
+						const float Signal = FMath::Square(Settings.RidgeOffset - Folded) * RidgeWeight[Index];
+						Ridged[Index] += Signal * Amplitude;
+						RidgeWeight[Index] = FMath::Clamp(Signal * Settings.RidgeGain, 0.f, 1.f);
+					}
+
+					Frequency *= Settings.Lacunarity;
+					Amplitude *= Settings.Persistence;
+				}
+
+				if (FbmLayer)
+					StoreChunk(FbmLayer, RowOffset + Begin, Fbm, Count);
+
+				if (BillowLayer)
+					StoreChunk(BillowLayer, RowOffset + Begin, Billow, Count);
+
+				if (RidgedLayer)
+				{
+					for (int32 Index = 0; Index < Count; ++Index)
+						Ridged[Index] = FMath::Min(Ridged[Index] * RidgedScale, 1.f);
+
+					StoreChunk(RidgedLayer, RowOffset + Begin, Ridged, Count);
+				}
+
+				// the shared fBm is the horizontal offset, a second lattice gives the vertical one
+				if (WarpedLayer)
+				{
+					AccumulateFbm(Count, Settings.Seed ^ WarpSeed, WarpY);
+
+					for (int32 Index = 0; Index < Count; ++Index)
+					{
+						PixelX[Index] += Settings.WarpStrength * (2.f * Fbm[Index] - 1.f);
+						PixelY[Index] += Settings.WarpStrength * (2.f * WarpY[Index] - 1.f);
+					}
+
+					AccumulateFbm(Count, Settings.Seed, Warped);
+					StoreChunk(WarpedLayer, RowOffset + Begin, Warped, Count);
+				}
+			}
+		}
+	});
+}
+
+// Gensys.Benchmark stages
+namespace
+{
+	FGensysBenchmarkStage ValueNoiseStage("ValueNoise", true, [](const FGensysBenchmarkInputs& Inputs) -> FGensysBenchmarkStage::FBody
+	{
+		TSharedRef<FGensysHalfMap> Noise = MakeShared<FGensysHalfMap>();
+		return [Noise, Resolution = Inputs.Resolution]() { GensysNoise::Generate(FGensysNoiseSettings(), Resolution, Resolution, *Noise); };
+	});
+
+	FGensysBenchmarkStage NoiseAllModesStage("NoiseAllModes", true, [](const FGensysBenchmarkInputs& Inputs) -> FGensysBenchmarkStage::FBody
+	{
+		TSharedRef<TArray<FGensysHalfMap>> Layers = MakeShared<TArray<FGensysHalfMap>>();
+		Layers->SetNum((int32)EGensysNoiseMode::Count);
+		return [Layers, Resolution = Inputs.Resolution]()
+		{
+			FGensysHalfMap* AllLayers[(int32)EGensysNoiseMode::Count];
+			for (int32 Mode = 0; Mode < (int32)EGensysNoiseMode::Count; ++Mode)
+				AllLayers[Mode] = &(*Layers)[Mode];
+			GensysNoise::GenerateLayers(FGensysNoiseSettings(), Resolution, Resolution, AllLayers);
+		};
+	});
+
+	FGensysBenchmarkStage ValueNoiseScalarStage("ValueNoiseScalar", true, [](const FGensysBenchmarkInputs& Inputs) -> FGensysBenchmarkStage::FBody
+	{
+		TSharedRef<FGensysHalfMap> Noise = MakeShared<FGensysHalfMap>();
+		return [Noise, Resolution = Inputs.Resolution]() { GensysNoise::Generate(FGensysNoiseSettings(), Resolution, Resolution, *Noise, nullptr, EGensysNoiseKernel::Scalar); };
+	});
+}
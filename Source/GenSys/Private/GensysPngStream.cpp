@@ -0,0 +1,350 @@
+#include "GensysPngStream.h"
+#include "GensysProgress.h"
+#include "HAL/PlatformFileManager.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "png.h"
+THIRD_PARTY_INCLUDES_END
+
+namespace
+{
+	// libpng calls abort if the error callback returns, it jumps back into the reader or writer call instead
+	void PngStreamError(png_structp Png, png_const_charp Message)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Gensys png: %s"), UTF8_TO_TCHAR(Message));
+		std::longjmp(*static_cast<std::jmp_buf*>(png_get_error_ptr(Png)), 1);
+	}
+
+	void PngStreamWarning(png_structp Png, png_const_charp Message)
+	{
+		UE_LOG(LogTemp, Verbose, TEXT("Gensys png: %s"), UTF8_TO_TCHAR(Message));
+	}
+
+	void PngStreamRead(png_structp Png, png_bytep Data, png_size_t Length)
+	{
+		if (!static_cast<IFileHandle*>(png_get_io_ptr(Png))->Read(Data, Length))
+			png_error(Png, "unexpected end of file");
+	}
+
+	void PngStreamWrite(png_structp Png, png_bytep Data, png_size_t Length)
+	{
+		if (!static_cast<IFileHandle*>(png_get_io_ptr(Png))->Write(Data, Length))
+			png_error(Png, "write failed");
+	}
+
+	void PngStreamFlush(png_structp Png)
+	{
+		static_cast<IFileHandle*>(png_get_io_ptr(Png))->Flush();
+	}
+}
+
+FGensysPngReader::~FGensysPngReader()
+{
+	Close();
+}
+
+bool FGensysPngReader::Open(const FString& Path)
+{
+	Close();
+
+	File.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*Path));
+	if (!File.IsValid())
+		return false;
+
+	// no object with a destructor may live in this scope past the setjmp
+	if (setjmp(ErrorJump))
+	{
+		Close();
+		return false;
+	}
+
+	Png = png_create_read_struct(PNG_LIBPNG_VER_STRING, &ErrorJump, PngStreamError, PngStreamWarning);
+	Info = Png ? png_create_info_struct(Png) : nullptr;
+	if (Info == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	png_set_read_fn(Png, File.Get(), PngStreamRead);
+	png_read_info(Png, Info);
+
+	if (png_get_interlace_type(Png, Info) != PNG_INTERLACE_NONE)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Gensys png: %s is interlaced, it cannot be streamed"), *Path);
+		Close();
+		return false;
+	}
+
+	// every layout is normalised to RGBA, palettes and low bit depths expanded to 8 bit
+	const int32 ColorType = png_get_color_type(Png, Info);
+	BitDepth = png_get_bit_depth(Png, Info) == 16 ? 16 : 8;
+
+	png_set_expand(Png);
+	if (ColorType == PNG_COLOR_TYPE_GRAY || ColorType == PNG_COLOR_TYPE_GRAY_ALPHA)
+		png_set_gray_to_rgb(Png);
+
+	// only applied to the layouts without alpha
+	png_set_add_alpha(Png, BitDepth == 16 ? 0xffff : 0xff, PNG_FILLER_AFTER);
+
+#if PLATFORM_LITTLE_ENDIAN
+	if (BitDepth == 16)
+		png_set_swap(Png);
+#endif
+
+	png_read_update_info(Png, Info);
+
+	Width = png_get_image_width(Png, Info);
+	Height = png_get_image_height(Png, Info);
+	if ((int64)png_get_rowbytes(Png, Info) != GetRowBytes())
+	{
+		Close();
+		return false;
+	}
+
+	Row.SetNumUninitialized(GetRowBytes());
+	return true;
+}
+
+bool FGensysPngReader::ReadRow(uint8* OutRow)
+{
+	if (Png == nullptr || NextRow >= Height)
+		return false;
+
+	if (setjmp(ErrorJump))
+	{
+		Close();
+		return false;
+	}
+
+	png_read_row(Png, OutRow, nullptr);
+	++NextRow;
+	return true;
+}
+
+template<typename StorageType>
+bool FGensysPngReader::ReadRows(int32 NumRows, TGensysMap<StorageType>& Out, FGensysBufferPool* Pool)
+{
+	Out.Init(Width, NumRows, Pool);
+
+	for (int32 Y = 0; Y < NumRows; ++Y)
+	{
+		if (!ReadRow(Row.GetData()))
+			return false;
+
+		// same values as GensysImage::LoadMap, the red channel normalised to 0-1
+		StorageType* Values = &Out.Values[(int64)Y * Width];
+		if (BitDepth == 16)
+		{
+			const uint16* Texels = reinterpret_cast<const uint16*>(Row.GetData());
+			for (int32 X = 0; X < Width; ++X)
+				Values[X] = TGensysStorage<StorageType>::Encode(TGensysStorage<uint16>::Decode(Texels[X * 4]));
+		}
+		else
+		{
+			for (int32 X = 0; X < Width; ++X)
+				Values[X] = TGensysStorage<StorageType>::Encode(TGensysStorage<uint8>::Decode(Row[X * 4]));
+		}
+	}
+
+	return true;
+}
+
+void FGensysPngReader::Close()
+{
+	if (Png)
+		png_destroy_read_struct(&Png, Info ? &Info : nullptr, nullptr);
+
+	Png = nullptr;
+	Info = nullptr;
+	File.Reset();
+	Width = Height = BitDepth = NextRow = 0;
+}
+
+FGensysPngWriter::~FGensysPngWriter()
+{
+	Close();
+}
+
+bool FGensysPngWriter::Open(const FString& InPath, int32 InWidth, int32 InHeight, int32 InChannels, int32 InBitDepth)
+{
+	Close();
+	check(InChannels == 1 || InChannels == 4);
+	check(InBitDepth == 8 || InBitDepth == 16);
+
+	Path = InPath;
+	Width = InWidth;
+	Height = InHeight;
+	Channels = InChannels;
+	BitDepth = InBitDepth;
+	NextRow = 0;
+	bFailed = false;
+
+	File.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Path));
+	if (!File.IsValid())
+		return false;
+
+	if (setjmp(ErrorJump))
+	{
+		bFailed = true;
+		Close();
+		return false;
+	}
+
+	Png = png_create_write_struct(PNG_LIBPNG_VER_STRING, &ErrorJump, PngStreamError, PngStreamWarning);
+	Info = Png ? png_create_info_struct(Png) : nullptr;
+	if (Info == nullptr)
+	{
+		bFailed = true;
+		Close();
+		return false;
+	}
+
+	png_set_write_fn(Png, File.Get(), PngStreamWrite, PngStreamFlush);
+	png_set_IHDR(Png, Info, Width, Height, BitDepth, Channels == 1 ? PNG_COLOR_TYPE_GRAY : PNG_COLOR_TYPE_RGB_ALPHA,
+		PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(Png, Info);
+
+#if PLATFORM_LITTLE_ENDIAN
+	if (BitDepth == 16)
+		png_set_swap(Png);
+#endif
+
+	return true;
+}
+
+bool FGensysPngWriter::WriteRow(const void* InRow)
+{
+	if (Png == nullptr || bFailed || NextRow >= Height)
+		return false;
+
+	if (setjmp(ErrorJump))
+	{
+		bFailed = true;
+		return false;
+	}
+
+	png_write_row(Png, static_cast<png_const_bytep>(InRow));
+	++NextRow;
+	return true;
+}
+
+template<typename StorageType>
+bool FGensysPngWriter::WriteRows(const TGensysMap<StorageType>& Rows)
+{
+	check(Channels == 1 && BitDepth == 16 && Rows.Width == Width);
+	Row.SetNumUninitialized(Width);
+
+	for (int32 Y = 0; Y < Rows.Height; ++Y)
+	{
+		for (int32 X = 0; X < Width; ++X)
+			Row[X] = TGensysStorage<uint16>::Encode(Rows.At(X, Y));
+
+		if (!WriteRow(Row.GetData()))
+			return false;
+	}
+
+	return true;
+}
+
+bool FGensysPngWriter::Close()
+{
+	if (Png == nullptr && !File.IsValid())
+		return false;
+
+	if (Png)
+	{
+		if (NextRow != Height)
+			bFailed = true;
+		else if (!bFailed)
+		{
+			if (setjmp(ErrorJump))
+				bFailed = true;
+			else
+				png_write_end(Png, Info);
+		}
+
+		png_destroy_write_struct(&Png, Info ? &Info : nullptr);
+	}
+
+	Png = nullptr;
+	Info = nullptr;
+	File.Reset();
+
+	// a truncated png is worse than none, the import would pick it up
+	if (bFailed)
+		FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*Path);
+
+	return !bFailed;
+}
+
+bool GensysImage::ReadPngSize(const FString& Path, int32& OutWidth, int32& OutHeight)
+{
+	FGensysPngReader Reader;
+	if (!Reader.Open(Path))
+		return false;
+
+	OutWidth = Reader.GetWidth();
+	OutHeight = Reader.GetHeight();
+	return true;
+}
+
+template<typename StorageType>
+bool GensysImage::LoadStore(const FString& Path, const FString& StorePath, TGensysTileStore<StorageType>& Out, FGensysBufferPool* Pool)
+{
+	FGensysPngReader Reader;
+	if (!Reader.Open(Path) || !Out.Create(StorePath, Reader.GetWidth(), Reader.GetHeight()))
+		return false;
+
+	// a row of tiles is the only part ever decoded at once
+	TGensysMap<StorageType> Rows;
+	for (int32 TileY = 0; TileY < Out.GetNumTilesY(); ++TileY)
+	{
+		const int32 NumRows = FMath::Min(Out.GetTileSize(), Out.GetHeight() - TileY * Out.GetTileSize());
+		if (FGensysProgress::IsActiveCancelled() || !Reader.ReadRows(NumRows, Rows, Pool))
+		{
+			Out.Close();
+			return false;
+		}
+
+		Out.WriteTileRow(TileY, Rows);
+	}
+
+	return Out.Finalize();
+}
+
+template<typename StorageType>
+bool GensysImage::SaveStore(const FString& Path, TGensysTileStore<StorageType>& Store, FGensysBufferPool* Pool)
+{
+	FGensysPngWriter Writer;
+	if (!Writer.Open(Path, Store.GetWidth(), Store.GetHeight(), 1, 16))
+		return false;
+
+	TGensysMap<StorageType> Band;
+	for (int32 Y = 0; Y < Store.GetHeight(); Y += Store.GetTileSize())
+	{
+		if (FGensysProgress::IsActiveCancelled())
+			break;
+
+		Store.ReadWindow(FIntRect(0, Y, Store.GetWidth(), FMath::Min(Y + Store.GetTileSize(), Store.GetHeight())), Band, Pool);
+		if (!Writer.WriteRows(Band))
+			break;
+	}
+
+	// short of rows when cancelled or failed, the file is then removed
+	return Writer.Close();
+}
+
+// the storage types used by the stages
+#define INSTANTIATE_GENSYS_PNG_STREAM(StorageType) \
+	template bool FGensysPngReader::ReadRows<StorageType>(int32, TGensysMap<StorageType>&, FGensysBufferPool*); \
+	template bool FGensysPngWriter::WriteRows<StorageType>(const TGensysMap<StorageType>&); \
+	template bool GensysImage::LoadStore<StorageType>(const FString&, const FString&, TGensysTileStore<StorageType>&, FGensysBufferPool*); \
+	template bool GensysImage::SaveStore<StorageType>(const FString&, TGensysTileStore<StorageType>&, FGensysBufferPool*);
+
+INSTANTIATE_GENSYS_PNG_STREAM(float)
+INSTANTIATE_GENSYS_PNG_STREAM(FFloat16)
+INSTANTIATE_GENSYS_PNG_STREAM(uint16)
+INSTANTIATE_GENSYS_PNG_STREAM(uint8)
+
+#undef INSTANTIATE_GENSYS_PNG_STREAM
@@ -0,0 +1,75 @@
+#include "GensysProgress.h"
+
+namespace
+{
+	// the generation running on this thread, every queue worker runs its own job
+	// the parallel helpers capture it on the calling thread before handing blocks to the task graph
+	thread_local FGensysProgress* ActiveProgress = nullptr;
+}
+
+void FGensysProgress::BeginStage(const FText& Name)
+{
+	{
+		FScopeLock ScopeLock(&Lock);
+		StageName = Name;
+		Detail.Empty();
+	}
+
+	StageFraction = 0.f;
+	++StageIndex;
+}
+
+void FGensysProgress::SetStageFraction(float Fraction)
+{
+	StageFraction = FMath::Clamp(Fraction, 0.f, 1.f);
+}
+
+void FGensysProgress::SetDetail(const FString& InDetail)
+{
+	FScopeLock ScopeLock(&Lock);
+	Detail = InDetail;
+}
+
+float FGensysProgress::GetOverallFraction() const
+{
+	return FMath::Clamp((FMath::Max((int32)StageIndex, 0) + StageFraction) / NumStages, 0.f, 1.f);
+}
+
+FText FGensysProgress::GetStatusText() const
+{
+	FScopeLock ScopeLock(&Lock);
+
+	if (Detail.IsEmpty())
+		return StageName;
+
+	return FText::Format(NSLOCTEXT("FGenSysModule", "GensysProgressDetail", "{0} - {1}"), StageName, FText::FromString(Detail));
+}
+
+bool FGensysProgress::Tick()
+{
+	if (OnTick && !OnTick(*this))
+		Cancel();
+
+	return !IsCancelled();
+}
+
+FGensysProgress::FScopedActive::FScopedActive(FGensysProgress& Progress)
+	: Previous(ActiveProgress)
+{
+	ActiveProgress = &Progress;
+}
+
+FGensysProgress::FScopedActive::~FScopedActive()
+{
+	ActiveProgress = Previous;
+}
+
+const FGensysProgress* FGensysProgress::GetActive()
+{
+	return ActiveProgress;
+}
+
+bool FGensysProgress::IsActiveCancelled()
+{
+	return ActiveProgress && ActiveProgress->IsCancelled();
+}
@@ -0,0 +1,229 @@
+#include "GensysPyramid.h"
+#include "GensysParallel.h"
+#include "GensysBenchmark.h"
+
+namespace
+{
+	// coarsest level kept by the blend
+	constexpr int32 MinLevelSize = 8;
+
+	float Binomial5(float A, float B, float C, float D, float E)
+	{
+		return (A + 4.f * B + 6.f * C + 4.f * D + E) * (1.f / 16.f);
+	}
+
+	// two output samples per input sample, the even one centred on it and the odd one between it and the next
+	float ExpandSample(const float* Row, int32 Width, int32 X)
+	{
+		const int32 I = X >> 1;
+		if (X & 1)
+			return 0.5f * (Row[I] + Row[FMath::Min(I + 1, Width - 1)]);
+
+		return (Row[FMath::Max(I - 1, 0)] + 6.f * Row[I] + Row[FMath::Min(I + 1, Width - 1)]) * (1.f / 8.f);
+	}
+}
+
+template<typename StorageType>
+void GensysPyramid::Reduce(const TGensysMap<StorageType>& In, FGensysHalfMap& Out, FGensysBufferPool* Pool)
+{
+	const int32 OutWidth = FMath::Max((In.Width + 1) / 2, 1);
+	const int32 OutHeight = FMath::Max((In.Height + 1) / 2, 1);
+	Out.Init(OutWidth, OutHeight, Pool);
+
+	GensysParallel::ForRowBlocks(OutHeight, GensysParallel::DefaultRowsPerBlock, [&](int32 RowBegin, int32 RowEnd)
+	{
+		// input rows 2 * RowBegin - 2 to 2 * RowEnd, filtered and decimated horizontally
+		const int32 FirstRow = 2 * RowBegin - 2;
+		const int32 NumRows = 2 * (RowEnd - RowBegin) + 3;
+
+		TArray<float> Band, Input;
+		Band.SetNumUninitialized(NumRows * OutWidth);
+		Input.SetNumUninitialized(In.Width);
+
+		for (int32 Row = 0; Row < NumRows; ++Row)
+		{
+			const int64 RowStart = (int64)FMath::Clamp(FirstRow + Row, 0, In.Height - 1) * In.Width;
+			for (int32 X = 0; X < In.Width; ++X)
+				Input[X] = In.Get(RowStart + X);
+
+			float* Filtered = &Band[Row * OutWidth];
+			const int32 Last = In.Width - 1;
+
+			for (int32 X = 0; X < OutWidth; ++X)
+			{
+				const int32 C = 2 * X;
+				Filtered[X] = Binomial5(Input[FMath::Max(C - 2, 0)], Input[FMath::Max(C - 1, 0)], Input[FMath::Min(C, Last)],
+					Input[FMath::Min(C + 1, Last)], Input[FMath::Min(C + 2, Last)]);
+			}
+		}
+
+		for (int32 Y = RowBegin; Y < RowEnd; ++Y)
+		{
+			const float* Rows = &Band[2 * (Y - RowBegin) * OutWidth];
+			const int64 RowStart = (int64)Y * OutWidth;
+
+			for (int32 X = 0; X < OutWidth; ++X)
+				Out.Set(RowStart + X, Binomial5(Rows[X], Rows[X + OutWidth], Rows[X + 2 * OutWidth], Rows[X + 3 * OutWidth], Rows[X + 4 * OutWidth]));
+		}
+	});
+}
+
+void GensysPyramid::Expand(const FGensysHalfMap& In, int32 Width, int32 Height, FGensysHalfMap& Out, FGensysBufferPool* Pool)
+{
+	Out.Init(Width, Height, Pool);
+
+	GensysParallel::ForRowBlocks(Height, GensysParallel::DefaultRowsPerBlock, [&](int32 RowBegin, int32 RowEnd)
+	{
+		// input rows the block reads, expanded horizontally once
+		const int32 FirstRow = FMath::Max((RowBegin >> 1) - 1, 0);
+		const int32 LastRow = FMath::Min(((RowEnd - 1) >> 1) + 1, In.Height - 1);
+
+		TArray<float> Band, Input;
+		Band.SetNumUninitialized((LastRow - FirstRow + 1) * Width);
+		Input.SetNumUninitialized(In.Width);
+
+		for (int32 Row = FirstRow; Row <= LastRow; ++Row)
+		{
+			const int64 RowStart = (int64)Row * In.Width;
+			for (int32 X = 0; X < In.Width; ++X)
+				Input[X] = In.Get(RowStart + X);
+
+			float* Expanded = &Band[(Row - FirstRow) * Width];
+			for (int32 X = 0; X < Width; ++X)
+				Expanded[X] = ExpandSample(Input.GetData(), In.Width, X);
+		}
+
+		for (int32 Y = RowBegin; Y < RowEnd; ++Y)
+		{
+			const int32 I = Y >> 1;
+			const float* Centre = &Band[(I - FirstRow) * Width];
+			const float* Above = &Band[(FMath::Max(I - 1, 0) - FirstRow) * Width];
+			const float* Below = &Band[(FMath::Min(I + 1, In.Height - 1) - FirstRow) * Width];
+			const int64 RowStart = (int64)Y * Width;
+
+			if (Y & 1)
+			{
+				for (int32 X = 0; X < Width; ++X)
+					Out.Set(RowStart + X, 0.5f * (Centre[X] + Below[X]));
+			}
+			else
+			{
+				for (int32 X = 0; X < Width; ++X)
+					Out.Set(RowStart + X, (Above[X] + 6.f * Centre[X] + Below[X]) * (1.f / 8.f));
+			}
+		}
+	});
+}
+
+template<typename StorageType>
+void GensysPyramid::Blend(const TGensysMap<StorageType>& A, const TGensysMap<StorageType>& B, const FGensysMaskMap& Mask, int32 MaxLevels,
+	TGensysMap<StorageType>& Out, FGensysBufferPool* Pool)
+{
+	const int32 Width = A.Width;
+	const int32 Height = A.Height;
+
+	// Gaussian pyramids of the difference and of the mask, level 0 of the mask is the mask itself
+	const int32 Levels = FMath::Max(MaxLevels, 1);
+	TArray<FGensysHalfMap> PyramidDifference, PyramidMask;
+	PyramidDifference.SetNum(Levels);
+	PyramidMask.SetNum(Levels);
+
+	FGensysHalfMap& Difference = PyramidDifference[0];
+	Difference.Init(Width, Height, Pool);
+	GensysParallel::ForRowBlocks(Height, GensysParallel::DefaultRowsPerBlock, [&](int32 RowBegin, int32 RowEnd)
+	{
+		for (int64 Index = (int64)RowBegin * Width; Index < (int64)RowEnd * Width; ++Index)
+			Difference.Set(Index, B.Get(Index) - A.Get(Index));
+	});
+
+	int32 NumLevels = 1;
+	while (NumLevels < Levels && FMath::Min(PyramidDifference[NumLevels - 1].Width, PyramidDifference[NumLevels - 1].Height) >= 2 * MinLevelSize)
+	{
+		Reduce(PyramidDifference[NumLevels - 1], PyramidDifference[NumLevels], Pool);
+		if (NumLevels == 1)
+			Reduce(Mask, PyramidMask[1], Pool);
+		else
+			Reduce(PyramidMask[NumLevels - 1], PyramidMask[NumLevels], Pool);
+
+		++NumLevels;
+	}
+
+	// the coarsest level blends the Gaussian directly
+	const int32 Top = NumLevels - 1;
+	FGensysHalfMap Result;
+	if (Top > 0)
+	{
+		Result.Init(PyramidDifference[Top].Width, PyramidDifference[Top].Height, Pool);
+		for (int64 Index = 0; Index < Result.Num(); ++Index)
+			Result.Set(Index, PyramidMask[Top].Get(Index) * PyramidDifference[Top].Get(Index));
+	}
+
+	// every finer level adds its blended Laplacian band, D - Expand(D + 1), onto the expanded result
+	for (int32 Level = Top - 1; Level >= 1; --Level)
+	{
+		const FGensysHalfMap& LevelDifference = PyramidDifference[Level];
+		const FGensysHalfMap& LevelMask = PyramidMask[Level];
+
+		FGensysHalfMap Collapsed, Coarse;
+		Expand(Result, LevelDifference.Width, LevelDifference.Height, Collapsed, Pool);
+		Expand(PyramidDifference[Level + 1], LevelDifference.Width, LevelDifference.Height, Coarse, Pool);
+
+		// the coarser level is no longer needed once its band is known
+		PyramidDifference[Level + 1].Reset();
+		PyramidMask[Level + 1].Reset();
+
+		GensysParallel::ForRowBlocks(LevelDifference.Height, GensysParallel::DefaultRowsPerBlock, [&](int32 RowBegin, int32 RowEnd)
+		{
+			for (int64 Index = (int64)RowBegin * LevelDifference.Width; Index < (int64)RowEnd * LevelDifference.Width; ++Index)
+				Collapsed.Set(Index, Collapsed.Get(Index) + LevelMask.Get(Index) * (LevelDifference.Get(Index) - Coarse.Get(Index)));
+		});
+
+		Result = MoveTemp(Collapsed);
+	}
+
+	// level 0 takes its band straight from B - A and lands on A in the storage of the inputs
+	FGensysHalfMap Collapsed, Coarse;
+	if (Top > 0)
+	{
+		Expand(Result, Width, Height, Collapsed, Pool);
+		Expand(PyramidDifference[1], Width, Height, Coarse, Pool);
+		Result.Reset();
+		PyramidDifference.Reset();
+		PyramidMask.Reset();
+	}
+
+	Out.Init(Width, Height, Pool);
+	GensysParallel::ForRowBlocks(Height, GensysParallel::DefaultRowsPerBlock, [&](int32 RowBegin, int32 RowEnd)
+	{
+		for (int64 Index = (int64)RowBegin * Width; Index < (int64)RowEnd * Width; ++Index)
+		{
+			const float Band = B.Get(Index) - A.Get(Index) - (Top > 0 ? Coarse.Get(Index) : 0.f);
+			Out.Set(Index, A.Get(Index) + (Top > 0 ? Collapsed.Get(Index) : 0.f) + Mask.Get(Index) * Band);
+		}
+	});
+}
+
+template void GensysPyramid::Reduce<FFloat16>(const FGensysHalfMap&, FGensysHalfMap&, FGensysBufferPool*);
+template void GensysPyramid::Reduce<uint8>(const FGensysMaskMap&, FGensysHalfMap&, FGensysBufferPool*);
+template void GensysPyramid::Blend<float>(const FGensysMap&, const FGensysMap&, const FGensysMaskMap&, int32, FGensysMap&, FGensysBufferPool*);
+template void GensysPyramid::Blend<uint16>(const FGensysHeightMap&, const FGensysHeightMap&, const FGensysMaskMap&, int32, FGensysHeightMap&, FGensysBufferPool*);
+
+// Gensys.Benchmark stage, blends the terrain with its inverse along the river contours
+namespace
+{
+	FGensysBenchmarkStage PyramidBlendStage("PyramidBlend", true, [](const FGensysBenchmarkInputs& Inputs) -> FGensysBenchmarkStage::FBody
+	{
+		TSharedRef<FGensysHeightMap> B = MakeShared<FGensysHeightMap>();
+		TSharedRef<FGensysMaskMap> Mask = MakeShared<FGensysMaskMap>();
+		B->Init(Inputs.Resolution, Inputs.Resolution);
+		Mask->Init(Inputs.Resolution, Inputs.Resolution);
+		for (int64 Index = 0; Index < Inputs.Heights.Num(); ++Index)
+		{
+			B->Set(Index, 1.f - Inputs.Heights.Get(Index));
+			Mask->Set(Index, Inputs.RiverMap.Get(Index));
+		}
+
+		TSharedRef<FGensysHeightMap> Blended = MakeShared<FGensysHeightMap>();
+		return [B, Mask, Blended, &A = Inputs.Heights]() { GensysPyramid::Blend(A, *B, *Mask, 6, *Blended); };
+	});
+}
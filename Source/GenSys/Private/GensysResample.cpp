@@ -0,0 +1,125 @@
+#include "GensysResample.h"
+#include "GensysParallel.h"
+#include "ImageCore.h"
+#include "Math/VectorRegister.h"
+#include "GensysBenchmark.h"
+
+namespace
+{
+	// contributions of the source texels to a single destination texel
+	struct FFilterTaps
+	{
+		int32 First = 0;
+		TArray<float, TInlineAllocator<16>> Weights;
+	};
+
+	// precomputes the normalised taps of every destination texel along one axis
+	void BuildTaps(int32 SourceSize, int32 DestinationSize, TArray<FFilterTaps>& OutTaps)
+	{
+		const float Scale = (float)SourceSize / DestinationSize;
+		const float Support = FMath::Max(Scale, 1.f);
+
+		OutTaps.SetNum(DestinationSize);
+		for (int32 Index = 0; Index < DestinationSize; ++Index)
+		{
+			const float Centre = (Index + 0.5f) * Scale;
+			const int32 First = FMath::Max(FMath::FloorToInt(Centre - Support), 0);
+			const int32 Last = FMath::Min(FMath::CeilToInt(Centre + Support), SourceSize - 1);
+
+			FFilterTaps& Taps = OutTaps[Index];
+			Taps.First = First;
+
+			float Total = 0.f;
+			for (int32 Source = First; Source <= Last; ++Source)
+			{
+				const float Weight = FMath::Max(0.f, 1.f - FMath::Abs(Source + 0.5f - Centre) / Support);
+				Taps.Weights.Add(Weight);
+				Total += Weight;
+			}
+
+			// the nearest texel when the filter misses every centre
+			if (Total <= 0.f)
+			{
+				Taps.First = FMath::Clamp(FMath::FloorToInt(Centre), 0, SourceSize - 1);
+				Taps.Weights = { 1.f };
+				continue;
+			}
+
+			for (float& Weight : Taps.Weights)
+				Weight /= Total;
+		}
+	}
+}
+
+void GensysResample::Resize(const FImage& Source, int32 Width, int32 Height, FImage& Out)
+{
+	check(Source.Format == ERawImageFormat::RGBA32F);
+
+	const int32 SourceWidth = Source.SizeX;
+	const int32 SourceHeight = Source.SizeY;
+
+	TArray<FFilterTaps> HorizontalTaps;
+	TArray<FFilterTaps> VerticalTaps;
+	BuildTaps(SourceWidth, Width, HorizontalTaps);
+	BuildTaps(SourceHeight, Height, VerticalTaps);
+
+	// horizontal pass into an intermediate of destination width and source height
+	TArray64<FLinearColor> Intermediate;
+	Intermediate.SetNumUninitialized((int64)Width * SourceHeight);
+
+	const FLinearColor* SourcePixels = reinterpret_cast<const FLinearColor*>(Source.RawData.GetData());
+
+	GensysParallel::ForRowBlocks(SourceHeight, GensysParallel::DefaultRowsPerBlock, [&](int32 RowBegin, int32 RowEnd)
+	{
+		for (int32 Y = RowBegin; Y < RowEnd; ++Y)
+		{
+			const FLinearColor* Row = SourcePixels + (int64)Y * SourceWidth;
+
+			for (int32 X = 0; X < Width; ++X)
+			{
+				const FFilterTaps& Taps = HorizontalTaps[X];
+				VectorRegister4Float Sum = VectorZeroFloat();
+
+				for (int32 Tap = 0; Tap < Taps.Weights.Num(); ++Tap)
+					Sum = VectorMultiplyAdd(VectorLoad(&Row[Taps.First + Tap].R), VectorSetFloat1(Taps.Weights[Tap]), Sum);
+
+				VectorStore(Sum, &Intermediate[(int64)Y * Width + X].R);
+			}
+		}
+	});
+
+	// vertical pass into the destination, accumulated a whole source row at a time so the reads stay sequential
+	Out.Init(Width, Height, ERawImageFormat::RGBA32F, Source.GammaSpace);
+	FLinearColor* OutPixels = reinterpret_cast<FLinearColor*>(Out.RawData.GetData());
+
+	GensysParallel::ForRowBlocks(Height, GensysParallel::DefaultRowsPerBlock, [&](int32 RowBegin, int32 RowEnd)
+	{
+		for (int32 Y = RowBegin; Y < RowEnd; ++Y)
+		{
+			const FFilterTaps& Taps = VerticalTaps[Y];
+			FLinearColor* OutRow = OutPixels + (int64)Y * Width;
+
+			for (int32 X = 0; X < Width; ++X)
+				VectorStore(VectorZeroFloat(), &OutRow[X].R);
+
+			for (int32 Tap = 0; Tap < Taps.Weights.Num(); ++Tap)
+			{
+				const FLinearColor* Row = &Intermediate[(int64)(Taps.First + Tap) * Width];
+				const VectorRegister4Float Weight = VectorSetFloat1(Taps.Weights[Tap]);
+
+				for (int32 X = 0; X < Width; ++X)
+					VectorStore(VectorMultiplyAdd(VectorLoad(&Row[X].R), Weight, VectorLoad(&OutRow[X].R)), &OutRow[X].R);
+			}
+		}
+	});
+}
+
+// Gensys.Benchmark stage
+namespace
+{
+	FGensysBenchmarkStage GuideResampleStage("GuideResample", true, [](const FGensysBenchmarkInputs& Inputs) -> FGensysBenchmarkStage::FBody
+	{
+		TSharedRef<FImage> Resized = MakeShared<FImage>();
+		return [Resized, &Colour = Inputs.Colour, Resolution = Inputs.Resolution]() { GensysResample::Resize(Colour, Resolution / 2, Resolution / 2, *Resized); };
+	});
+}
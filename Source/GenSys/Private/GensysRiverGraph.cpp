@@ -0,0 +1,198 @@
+#include "GensysRiverGraph.h"
+#include "GensysSpatialGrid.h"
+#include "GensysUnionFind.h"
+#include "Misc/FileHelper.h"
+#include "GensysBenchmark.h"
+
+//external JSON library by nlohmann
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+void FGensysRiverGraph::Reset()
+{
+	Width = 0;
+	Height = 0;
+	Positions.Empty();
+	Strength.Empty();
+	Edges.Empty();
+	NumMerged = 0;
+}
+
+void FGensysRiverGraph::GetAdjacency(TArray<TArray<int32, TInlineAllocator<4>>>& Out) const
+{
+	Out.Reset();
+	Out.SetNum(Positions.Num());
+
+	for (const FIntPoint& Edge : Edges)
+	{
+		Out[Edge.X].Add(Edge.Y);
+		Out[Edge.Y].Add(Edge.X);
+	}
+}
+
+bool FGensysRiverGraph::SaveJson(const FString& Path) const
+{
+	json Nodes = json::array();
+	for (int32 Node = 0; Node < Positions.Num(); ++Node)
+	{
+		Nodes.push_back({
+			{ "U", Positions[Node].X / FMath::Max(Width, 1) },
+			{ "V", Positions[Node].Y / FMath::Max(Height, 1) },
+			{ "Strength", Strength[Node] }
+		});
+	}
+
+	json EdgeList = json::array();
+	for (const FIntPoint& Edge : Edges)
+		EdgeList.push_back({ Edge.X, Edge.Y });
+
+	const json Graph = {
+		{ "Width", Width },
+		{ "Height", Height },
+		{ "Nodes", Nodes },
+		{ "Edges", EdgeList },
+		{ "Merged", NumMerged }
+	};
+
+	return FFileHelper::SaveStringToFile(UTF8_TO_TCHAR(Graph.dump(1, '\t').c_str()), *Path);
+}
+
+void GensysRiverGraph::Trace(const FGensysMap& RiverMap, const FGensysRiverTraceSettings& Settings, FGensysRiverGraph& Out)
+{
+	Out.Reset();
+	Out.Width = RiverMap.Width;
+	Out.Height = RiverMap.Height;
+
+	const int32 Width = RiverMap.Width;
+	FGensysSpatialGrid Grid(Settings.NodeSpacing);
+
+	TArray<FVector2f> PositionSums;
+	TArray<float> StrengthSums;
+	TArray<int32> PixelCounts;
+	TSet<uint64> EdgeKeys;
+
+	const auto AddEdge = [&](int32 A, int32 B)
+	{
+		bool bAlreadyLinked = false;
+		EdgeKeys.Add(FGensysRiverGraph::GetEdgeKey(A, B), &bAlreadyLinked);
+		if (!bAlreadyLinked)
+			Out.Edges.Add(FIntPoint(FMath::Min(A, B), FMath::Max(A, B)));
+	};
+
+	// node of every pixel of the previous and the current row, enough to find the touching neighbours
+	TArray<int32> PreviousRow;
+	TArray<int32> CurrentRow;
+	PreviousRow.Init(INDEX_NONE, Width);
+	CurrentRow.Init(INDEX_NONE, Width);
+
+	for (int32 Y = 0; Y < RiverMap.Height; ++Y)
+	{
+		for (int32 X = 0; X < Width; ++X)
+		{
+			const float Value = RiverMap.Get((int64)Y * Width + X);
+			if (Value <= Settings.Threshold)
+			{
+				CurrentRow[X] = INDEX_NONE;
+				continue;
+			}
+
+			// the seed of the closest node, a new node once the channel walks out of reach
+			const FVector2f Position(X + 0.5f, Y + 0.5f);
+			int32 Node = Grid.FindNearest(Position, Settings.NodeSpacing);
+			if (Node == INDEX_NONE)
+			{
+				Node = Grid.Add(Position);
+				PositionSums.Add(FVector2f::ZeroVector);
+				StrengthSums.Add(0.f);
+				PixelCounts.Add(0);
+			}
+
+			PositionSums[Node] += Position;
+			StrengthSums[Node] += Value;
+			++PixelCounts[Node];
+			CurrentRow[X] = Node;
+
+			// 8-connected, the left and the three upper neighbours are already assigned
+			const int32 Neighbours[] = {
+				X > 0 ? CurrentRow[X - 1] : INDEX_NONE,
+				X > 0 ? PreviousRow[X - 1] : INDEX_NONE,
+				PreviousRow[X],
+				X + 1 < Width ? PreviousRow[X + 1] : INDEX_NONE
+			};
+
+			for (int32 Neighbour : Neighbours)
+			{
+				if (Neighbour != INDEX_NONE && Neighbour != Node)
+					AddEdge(Node, Neighbour);
+			}
+		}
+
+		Swap(PreviousRow, CurrentRow);
+	}
+
+	// nodes move from their seed pixel to the centre of their pixels
+	const int32 NumNodes = Grid.Num();
+	Out.Positions.SetNumUninitialized(NumNodes);
+	Out.Strength.SetNumUninitialized(NumNodes);
+	for (int32 Node = 0; Node < NumNodes; ++Node)
+	{
+		Out.Positions[Node] = PositionSums[Node] / (float)PixelCounts[Node];
+		Out.Strength[Node] = StrengthSums[Node] / PixelCounts[Node];
+		Grid.Move(Node, Out.Positions[Node]);
+	}
+
+	if (!Settings.bMergeLooseEnds)
+		return;
+
+	// networks as disjoint sets, a loose end may only join a network it is not already part of
+	TArray<int32> Parents;
+	TArray<int32> Degrees;
+	Parents.SetNumUninitialized(NumNodes);
+	Degrees.Init(0, NumNodes);
+	for (int32 Node = 0; Node < NumNodes; ++Node)
+		Parents[Node] = Node;
+
+	for (const FIntPoint& Edge : Out.Edges)
+	{
+		GensysUnionFind::Union(Parents, Edge.X, Edge.Y);
+		++Degrees[Edge.X];
+		++Degrees[Edge.Y];
+	}
+
+	for (int32 Node = 0; Node < NumNodes; ++Node)
+	{
+		if (Degrees[Node] > 1)
+			continue;
+
+		const int32 Network = GensysUnionFind::FindRoot(Parents, Node);
+		const int32 Target = Grid.FindNearest(Out.Positions[Node], Settings.MergeRadius, [&](int32 Candidate)
+		{
+			return GensysUnionFind::FindRoot(Parents, Candidate) != Network;
+		});
+
+		if (Target == INDEX_NONE)
+			continue;
+
+		AddEdge(Node, Target);
+		Parents[Network] = GensysUnionFind::FindRoot(Parents, Target);
+		++Degrees[Node];
+		++Degrees[Target];
+		++Out.NumMerged;
+	}
+}
+
+// Gensys.Benchmark stage, traces the contour lines of the synthetic terrain
+namespace
+{
+	FGensysBenchmarkStage RiverGraphStage("RiverGraph", false, [](const FGensysBenchmarkInputs& Inputs) -> FGensysBenchmarkStage::FBody
+	{
+		TSharedRef<FGensysRiverGraph> Graph = MakeShared<FGensysRiverGraph>();
+		return [Graph, &RiverMap = Inputs.RiverMap]()
+		{
+			FGensysRiverTraceSettings Settings;
+			Settings.bMergeLooseEnds = true;
+			GensysRiverGraph::Trace(RiverMap, Settings, *Graph);
+		};
+	});
+}
@@ -0,0 +1,195 @@
+#include "GensysRiverRaster.h"
+#include "GensysParallel.h"
+#include "GensysBenchmark.h"
+
+namespace
+{
+	struct FRiverSegment
+	{
+		FVector2f Start;
+		FVector2f End;
+		float StartRadius;
+		float EndRadius;
+	};
+
+	float GetProfileDepth(EGensysRiverProfile Profile, float Offset)
+	{
+		switch (Profile)
+		{
+		case EGensysRiverProfile::Parabolic:
+			return 1.f - Offset * Offset;
+		case EGensysRiverProfile::VShaped:
+			return 1.f - Offset;
+		default:
+			return 1.f;
+		}
+	}
+}
+
+void GensysRiverRaster::ComputeFlowOrders(const FGensysRiverGraph& Graph, TArray<int32>& OutOrders)
+{
+	const int32 NumNodes = Graph.NumNodes();
+
+	TArray<TArray<int32, TInlineAllocator<4>>> Adjacency;
+	Graph.GetAdjacency(Adjacency);
+
+	// highest order flowing in and how many inflows carry it
+	TArray<int32> MaxInflow;
+	TArray<int32> MaxInflowCount;
+	TArray<int32> Remaining;
+	MaxInflow.Init(0, NumNodes);
+	MaxInflowCount.Init(0, NumNodes);
+	Remaining.SetNumUninitialized(NumNodes);
+	OutOrders.Init(0, NumNodes);
+
+	TArray<int32> Ready;
+	for (int32 Node = 0; Node < NumNodes; ++Node)
+	{
+		Remaining[Node] = Adjacency[Node].Num();
+		if (Remaining[Node] <= 1)
+			Ready.Add(Node);
+	}
+
+	while (Ready.Num() > 0)
+	{
+		const int32 Node = Ready.Pop(false);
+
+		// two equal tributaries raise the order, otherwise the largest one carries on
+		OutOrders[Node] = MaxInflow[Node] == 0 ? 1 : (MaxInflowCount[Node] > 1 ? MaxInflow[Node] + 1 : MaxInflow[Node]);
+
+		for (int32 Neighbour : Adjacency[Node])
+		{
+			if (OutOrders[Neighbour] != 0)
+				continue;
+
+			if (OutOrders[Node] > MaxInflow[Neighbour])
+			{
+				MaxInflow[Neighbour] = OutOrders[Node];
+				MaxInflowCount[Neighbour] = 1;
+			}
+			else if (OutOrders[Node] == MaxInflow[Neighbour])
+				++MaxInflowCount[Neighbour];
+
+			if (--Remaining[Neighbour] == 1)
+				Ready.Add(Neighbour);
+		}
+	}
+
+	// loops never peel down to a loose end
+	for (int32 Node = 0; Node < NumNodes; ++Node)
+	{
+		if (OutOrders[Node] == 0)
+			OutOrders[Node] = FMath::Max(MaxInflow[Node], 1);
+	}
+}
+
+void GensysRiverRaster::Rasterise(const FGensysRiverGraph& Graph, const FGensysRiverRasterSettings& Settings, FGensysMap& Out, FGensysBufferPool* Pool)
+{
+	Out.Init(Graph.Width, Graph.Height, Pool);
+	FMemory::Memzero(Out.Values.GetData(), Out.GetAllocatedSize());
+
+	if (Graph.IsEmpty())
+		return;
+
+	TArray<int32> Orders;
+	ComputeFlowOrders(Graph, Orders);
+
+	const auto GetRadius = [&](int32 Node)
+	{
+		return FMath::Max(0.5f * Settings.Thickness * (1.f + (Orders[Node] - 1) * Settings.OrderWidening), 0.5f);
+	};
+
+	const int32 TileSize = FMath::Max(Settings.TileSize, 8);
+	const int32 NumTilesX = FMath::DivideAndRoundUp(Out.Width, TileSize);
+	const int32 NumTilesY = FMath::DivideAndRoundUp(Out.Height, TileSize);
+
+	// every segment goes to the bin of each tile its bounds touch, the coverage ramp reaches half a pixel past the bank
+	TArray<FRiverSegment> Segments;
+	TArray<TArray<int32>> Bins;
+	Segments.Reserve(Graph.Edges.Num());
+	Bins.SetNum(NumTilesX * NumTilesY);
+
+	for (const FIntPoint& Edge : Graph.Edges)
+	{
+		const FRiverSegment& Segment = Segments.Add_GetRef({ Graph.Positions[Edge.X], Graph.Positions[Edge.Y], GetRadius(Edge.X), GetRadius(Edge.Y) });
+		const float Reach = FMath::Max(Segment.StartRadius, Segment.EndRadius) + 1.f;
+
+		const int32 MinX = FMath::Clamp(FMath::FloorToInt((FMath::Min(Segment.Start.X, Segment.End.X) - Reach) / TileSize), 0, NumTilesX - 1);
+		const int32 MaxX = FMath::Clamp(FMath::FloorToInt((FMath::Max(Segment.Start.X, Segment.End.X) + Reach) / TileSize), 0, NumTilesX - 1);
+		const int32 MinY = FMath::Clamp(FMath::FloorToInt((FMath::Min(Segment.Start.Y, Segment.End.Y) - Reach) / TileSize), 0, NumTilesY - 1);
+		const int32 MaxY = FMath::Clamp(FMath::FloorToInt((FMath::Max(Segment.Start.Y, Segment.End.Y) + Reach) / TileSize), 0, NumTilesY - 1);
+
+		for (int32 TileY = MinY; TileY <= MaxY; ++TileY)
+		{
+			for (int32 TileX = MinX; TileX <= MaxX; ++TileX)
+				Bins[TileY * NumTilesX + TileX].Add(Segments.Num() - 1);
+		}
+	}
+
+	// a row of tiles per task, tiles never share pixels so no synchronisation is needed
+	GensysParallel::ForRowBlocks(NumTilesY, 1, [&](int32 TileRowBegin, int32 TileRowEnd)
+	{
+		for (int32 TileY = TileRowBegin; TileY < TileRowEnd; ++TileY)
+		{
+			for (int32 TileX = 0; TileX < NumTilesX; ++TileX)
+			{
+				const TArray<int32>& Bin = Bins[TileY * NumTilesX + TileX];
+				if (Bin.Num() == 0)
+					continue;
+
+				const int32 EndY = FMath::Min((TileY + 1) * TileSize, Out.Height);
+				const int32 EndX = FMath::Min((TileX + 1) * TileSize, Out.Width);
+
+				for (int32 Y = TileY * TileSize; Y < EndY; ++Y)
+				{
+					for (int32 X = TileX * TileSize; X < EndX; ++X)
+					{
+						const FVector2f Pixel(X + 0.5f, Y + 0.5f);
+						float Value = 0.f;
+
+						for (int32 SegmentIndex : Bin)
+						{
+							const FRiverSegment& Segment = Segments[SegmentIndex];
+							const FVector2f Direction = Segment.End - Segment.Start;
+							const float LengthSquared = Direction.SizeSquared();
+							const float T = LengthSquared > 0.f ? FMath::Clamp(FVector2f::DotProduct(Pixel - Segment.Start, Direction) / LengthSquared, 0.f, 1.f) : 0.f;
+
+							const float Radius = FMath::Lerp(Segment.StartRadius, Segment.EndRadius, T);
+							const float Distance = FVector2f::Distance(Pixel, Segment.Start + Direction * T);
+
+							// box filtered coverage of the bank, then the depth of the cross section
+							const float Coverage = FMath::Clamp(Radius - Distance + 0.5f, 0.f, 1.f);
+							if (Coverage <= 0.f)
+								continue;
+
+							Value = FMath::Max(Value, Coverage * GetProfileDepth(Settings.Profile, FMath::Min(Distance / Radius, 1.f)));
+						}
+
+						if (Value > 0.f)
+							Out.Set(X, Y, Value);
+					}
+				}
+			}
+		}
+	});
+}
+
+// Gensys.Benchmark stage
+namespace
+{
+	FGensysBenchmarkStage RiverRasterStage("RiverRaster", true, [](const FGensysBenchmarkInputs& Inputs) -> FGensysBenchmarkStage::FBody
+	{
+		TSharedRef<FGensysRiverGraph> Graph = MakeShared<FGensysRiverGraph>();
+		FGensysRiverTraceSettings TraceSettings;
+		TraceSettings.bMergeLooseEnds = true;
+		GensysRiverGraph::Trace(Inputs.RiverMap, TraceSettings, *Graph);
+
+		TSharedRef<FGensysMap> Raster = MakeShared<FGensysMap>();
+		return [Graph, Raster]()
+		{
+			FGensysRiverRasterSettings Settings;
+			Settings.Thickness = 3.f;
+			GensysRiverRaster::Rasterise(*Graph, Settings, *Raster);
+		};
+	});
+}
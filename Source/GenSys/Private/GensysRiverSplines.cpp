@@ -0,0 +1,161 @@
+#include "GensysRiverSplines.h"
+#include "GensysRiverRaster.h"
+#include "Misc/FileHelper.h"
+
+//external JSON library by nlohmann
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+namespace
+{
+	float GetSegmentDistanceSquared(const FVector2f& Point, const FVector2f& Start, const FVector2f& End)
+	{
+		const FVector2f Direction = End - Start;
+		const float LengthSquared = Direction.SizeSquared();
+		const float T = LengthSquared > 0.f ? FMath::Clamp(FVector2f::DotProduct(Point - Start, Direction) / LengthSquared, 0.f, 1.f) : 0.f;
+		return FVector2f::DistSquared(Point, Start + Direction * T);
+	}
+}
+
+void GensysRiverSplines::ExtractPolylines(const FGensysRiverGraph& Graph, TArray<FGensysRiverPolyline>& Out)
+{
+	Out.Reset();
+
+	TArray<TArray<int32, TInlineAllocator<4>>> Adjacency;
+	Graph.GetAdjacency(Adjacency);
+
+	TArray<int32> Orders;
+	GensysRiverRaster::ComputeFlowOrders(Graph, Orders);
+
+	TSet<uint64> WalkedEdges;
+	WalkedEdges.Reserve(Graph.Edges.Num());
+
+	// follows the chain from Start through Next until a node that is not a plain link or an edge already walked
+	const auto Walk = [&](int32 Start, int32 Next)
+	{
+		FGensysRiverPolyline& Polyline = Out.AddDefaulted_GetRef();
+		Polyline.Points.Add(Graph.Positions[Start]);
+		Polyline.Order = Orders[Start];
+
+		int32 Previous = Start;
+		int32 Current = Next;
+		WalkedEdges.Add(FGensysRiverGraph::GetEdgeKey(Previous, Current));
+
+		while (true)
+		{
+			Polyline.Points.Add(Graph.Positions[Current]);
+			Polyline.Order = FMath::Max(Polyline.Order, Orders[Current]);
+
+			if (Adjacency[Current].Num() != 2 || Current == Start)
+				break;
+
+			const int32 Following = Adjacency[Current][0] == Previous ? Adjacency[Current][1] : Adjacency[Current][0];
+			bool bAlreadyWalked = false;
+			WalkedEdges.Add(FGensysRiverGraph::GetEdgeKey(Current, Following), &bAlreadyWalked);
+			if (bAlreadyWalked)
+				break;
+
+			Previous = Current;
+			Current = Following;
+		}
+
+		if (Current == Start && Polyline.Points.Num() > 2)
+		{
+			Polyline.bClosed = Adjacency[Start].Num() == 2;
+			if (Polyline.bClosed)
+				Polyline.Points.Pop();
+		}
+	};
+
+	for (int32 Node = 0; Node < Graph.NumNodes(); ++Node)
+	{
+		if (Adjacency[Node].Num() == 2)
+			continue;
+
+		for (int32 Neighbour : Adjacency[Node])
+		{
+			if (!WalkedEdges.Contains(FGensysRiverGraph::GetEdgeKey(Node, Neighbour)))
+				Walk(Node, Neighbour);
+		}
+	}
+
+	// what is left are loops made of plain links only
+	for (const FIntPoint& Edge : Graph.Edges)
+	{
+		if (!WalkedEdges.Contains(FGensysRiverGraph::GetEdgeKey(Edge.X, Edge.Y)))
+			Walk(Edge.X, Edge.Y);
+	}
+}
+
+void GensysRiverSplines::Simplify(TArray<FVector2f>& Points, float Tolerance)
+{
+	if (Points.Num() < 3)
+		return;
+
+	const float ToleranceSquared = Tolerance * Tolerance;
+	TArray<bool> Keep;
+	Keep.Init(false, Points.Num());
+	Keep[0] = true;
+	Keep.Last() = true;
+
+	// ranges still to split, an explicit stack so long rivers cannot run out of call stack
+	TArray<FIntPoint> Ranges;
+	Ranges.Add(FIntPoint(0, Points.Num() - 1));
+
+	while (Ranges.Num() > 0)
+	{
+		const FIntPoint Range = Ranges.Pop(false);
+
+		int32 Farthest = INDEX_NONE;
+		float FarthestDistanceSquared = ToleranceSquared;
+		for (int32 Index = Range.X + 1; Index < Range.Y; ++Index)
+		{
+			const float DistanceSquared = GetSegmentDistanceSquared(Points[Index], Points[Range.X], Points[Range.Y]);
+			if (DistanceSquared > FarthestDistanceSquared)
+			{
+				Farthest = Index;
+				FarthestDistanceSquared = DistanceSquared;
+			}
+		}
+
+		if (Farthest == INDEX_NONE)
+			continue;
+
+		Keep[Farthest] = true;
+		Ranges.Add(FIntPoint(Range.X, Farthest));
+		Ranges.Add(FIntPoint(Farthest, Range.Y));
+	}
+
+	int32 Kept = 0;
+	for (int32 Index = 0; Index < Points.Num(); ++Index)
+	{
+		if (Keep[Index])
+			Points[Kept++] = Points[Index];
+	}
+	Points.SetNum(Kept);
+}
+
+bool GensysRiverSplines::SaveJson(const TArray<FGensysRiverPolyline>& Polylines, int32 Width, int32 Height, const FString& Path)
+{
+	json Rivers = json::array();
+	for (const FGensysRiverPolyline& Polyline : Polylines)
+	{
+		json Points = json::array();
+		for (const FVector2f& Point : Polyline.Points)
+			Points.push_back({ Point.X / FMath::Max(Width, 1), Point.Y / FMath::Max(Height, 1) });
+
+		Rivers.push_back({
+			{ "Order", Polyline.Order },
+			{ "Closed", Polyline.bClosed },
+			{ "Points", Points }
+		});
+	}
+
+	json Splines;
+	Splines["Width"] = Width;
+	Splines["Height"] = Height;
+	Splines["Rivers"] = Rivers;
+
+	return FFileHelper::SaveStringToFile(UTF8_TO_TCHAR(Splines.dump().c_str()), *Path);
+}
@@ -0,0 +1,224 @@
+#include "GensysSparseFoliage.h"
+#include "GensysParallel.h"
+#include "Algo/BinarySearch.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryWriter.h"
+#include "GensysLakes.h"
+#include "GensysBenchmark.h"
+
+namespace
+{
+	constexpr uint32 SparseFoliageMagic = 0x50534647; // "GFSP"
+	constexpr uint32 SparseFoliageVersion = 1;
+}
+
+uint8 FGensysFoliageBlock::GetDensity(int32 PixelInTile) const
+{
+	const int32 Word = PixelInTile >> 6;
+	const uint64 Bit = 1ull << (PixelInTile & 63);
+	if (!(Occupancy[Word] & Bit))
+		return 0;
+
+	int32 Rank = FMath::CountBits(Occupancy[Word] & (Bit - 1));
+	for (int32 Previous = 0; Previous < Word; ++Previous)
+		Rank += FMath::CountBits(Occupancy[Previous]);
+
+	return Densities[Rank];
+}
+
+void FGensysSparseFoliage::Init(int32 InWidth, int32 InHeight)
+{
+	Width = InWidth;
+	Height = InHeight;
+	NumTilesX = FMath::DivideAndRoundUp(Width, TileSize);
+	NumTilesY = FMath::DivideAndRoundUp(Height, TileSize);
+	LayerNames.Reset();
+	Layers.Reset();
+}
+
+int32 FGensysSparseFoliage::AddLayer(const FString& Name, FTileFunction FillTile)
+{
+	// a block list per row of tiles, joined in order afterwards so the blocks stay sorted
+	TArray<TArray<FGensysFoliageBlock>> TileRows;
+	TileRows.SetNum(NumTilesY);
+
+	GensysParallel::ForRowBlocks(NumTilesY, 1, [&](int32 TileRowBegin, int32 TileRowEnd)
+	{
+		uint8 Densities[TileSize * TileSize];
+
+		for (int32 TileY = TileRowBegin; TileY < TileRowEnd; ++TileY)
+		{
+			const int32 RowsInTile = FMath::Min(TileSize, Height - TileY * TileSize);
+
+			for (int32 TileX = 0; TileX < NumTilesX; ++TileX)
+			{
+				const int32 ColumnsInTile = FMath::Min(TileSize, Width - TileX * TileSize);
+
+				FMemory::Memzero(Densities);
+				FillTile(TileX, TileY, Densities);
+
+				FGensysFoliageBlock Block;
+				for (int32 Y = 0; Y < RowsInTile; ++Y)
+				{
+					for (int32 X = 0; X < ColumnsInTile; ++X)
+					{
+						const int32 Pixel = Y * TileSize + X;
+						if (Densities[Pixel] == 0)
+							continue;
+
+						Block.Occupancy[Pixel >> 6] |= 1ull << (Pixel & 63);
+						Block.Densities.Add(Densities[Pixel]);
+					}
+				}
+
+				if (Block.Densities.Num() == 0)
+					continue;
+
+				Block.Tile = TileY * NumTilesX + TileX;
+				Block.Densities.Shrink();
+				TileRows[TileY].Add(MoveTemp(Block));
+			}
+		}
+	});
+
+	TArray<FGensysFoliageBlock>& Blocks = Layers.AddDefaulted_GetRef();
+	for (TArray<FGensysFoliageBlock>& Row : TileRows)
+	{
+		for (FGensysFoliageBlock& Block : Row)
+			Blocks.Add(MoveTemp(Block));
+	}
+	Blocks.Shrink();
+
+	LayerNames.Add(Name);
+	return Layers.Num() - 1;
+}
+
+int32 FGensysSparseFoliage::AddLayer(const FString& Name, const FGensysMaskMap& Densities)
+{
+	return AddLayer(Name, [&](int32 TileX, int32 TileY, uint8* OutDensities)
+	{
+		const int32 RowsInTile = FMath::Min(TileSize, Height - TileY * TileSize);
+		const int32 ColumnsInTile = FMath::Min(TileSize, Width - TileX * TileSize);
+
+		for (int32 Y = 0; Y < RowsInTile; ++Y)
+			FMemory::Memcpy(OutDensities + Y * TileSize, &Densities.Values[(int64)(TileY * TileSize + Y) * Width + TileX * TileSize], ColumnsInTile);
+	});
+}
+
+uint8 FGensysSparseFoliage::GetDensity(int32 Layer, int32 X, int32 Y) const
+{
+	const int32 Tile = (Y / TileSize) * NumTilesX + X / TileSize;
+	const TArray<FGensysFoliageBlock>& Blocks = Layers[Layer];
+
+	const int32 Found = Algo::LowerBoundBy(Blocks, Tile, [](const FGensysFoliageBlock& Block) { return Block.Tile; });
+	if (Found == Blocks.Num() || Blocks[Found].Tile != Tile)
+		return 0;
+
+	return Blocks[Found].GetDensity((Y % TileSize) * TileSize + X % TileSize);
+}
+
+void FGensysSparseFoliage::ExtractLayer(int32 Layer, FGensysMaskMap& Out, FGensysBufferPool* Pool) const
+{
+	// the whole map is the band covering every row
+	ExtractRows(Layer, 0, Height, Out, Pool);
+}
+
+void FGensysSparseFoliage::ExtractRows(int32 Layer, int32 RowBegin, int32 RowEnd, FGensysMaskMap& Out, FGensysBufferPool* Pool) const
+{
+	Out.Init(Width, RowEnd - RowBegin, Pool);
+	FMemory::Memzero(Out.Values.GetData(), Out.GetAllocatedSize());
+
+	// the blocks are sorted by tile, the rows of tiles the band crosses are a contiguous range of them
+	const TArray<FGensysFoliageBlock>& Blocks = Layers[Layer];
+	const int32 FirstBlock = Algo::LowerBoundBy(Blocks, (RowBegin / TileSize) * NumTilesX, [](const FGensysFoliageBlock& Block) { return Block.Tile; });
+	const int32 LastBlock = Algo::LowerBoundBy(Blocks, FMath::DivideAndRoundUp(RowEnd, TileSize) * NumTilesX, [](const FGensysFoliageBlock& Block) { return Block.Tile; });
+
+	// tiles never share pixels, runs of blocks are scattered in parallel in any order
+	GensysParallel::ForRowBlocks(LastBlock - FirstBlock, 16, [&](int32 Begin, int32 End)
+	{
+		for (int32 BlockIndex = FirstBlock + Begin; BlockIndex < FirstBlock + End; ++BlockIndex)
+		{
+			const FGensysFoliageBlock& Block = Blocks[BlockIndex];
+			const int32 OriginX = (Block.Tile % NumTilesX) * TileSize;
+			const int32 OriginY = (Block.Tile / NumTilesX) * TileSize;
+
+			int32 Rank = 0;
+			for (int32 Word = 0; Word < FGensysFoliageBlock::NumWords; ++Word)
+			{
+				for (uint64 Bits = Block.Occupancy[Word]; Bits; Bits &= Bits - 1)
+				{
+					const int32 Pixel = Word * 64 + FMath::CountTrailingZeros64(Bits);
+					const int32 Y = OriginY + Pixel / TileSize;
+					const uint8 Density = Block.Densities[Rank++];
+
+					if (Y >= RowBegin && Y < RowEnd)
+						Out.Values[(int64)(Y - RowBegin) * Width + OriginX + Pixel % TileSize] = Density;
+				}
+			}
+		}
+	});
+}
+
+int64 FGensysSparseFoliage::GetAllocatedSize() const
+{
+	int64 Size = Layers.GetAllocatedSize();
+	for (const TArray<FGensysFoliageBlock>& Blocks : Layers)
+	{
+		Size += Blocks.GetAllocatedSize();
+		for (const FGensysFoliageBlock& Block : Blocks)
+			Size += Block.Densities.GetAllocatedSize();
+	}
+	return Size;
+}
+
+bool FGensysSparseFoliage::Save(const FString& Path) const
+{
+	// past 2 GB for the largest maps with many dense layers
+	TArray64<uint8> Bytes;
+	FMemoryWriter64 Writer(Bytes);
+
+	uint32 Magic = SparseFoliageMagic;
+	uint32 Version = SparseFoliageVersion;
+	int32 SavedWidth = Width;
+	int32 SavedHeight = Height;
+	int32 SavedTileSize = TileSize;
+	int32 NumLayers = Layers.Num();
+	Writer << Magic << Version << SavedWidth << SavedHeight << SavedTileSize << NumLayers;
+
+	for (int32 Layer = 0; Layer < NumLayers; ++Layer)
+	{
+		FString Name = LayerNames[Layer];
+		int32 NumBlocks = Layers[Layer].Num();
+		Writer << Name << NumBlocks;
+
+		for (const FGensysFoliageBlock& Block : Layers[Layer])
+		{
+			int32 Tile = Block.Tile;
+			int32 Count = Block.Densities.Num();
+			Writer << Tile;
+			Writer.Serialize((void*)Block.Occupancy, sizeof(Block.Occupancy));
+			Writer << Count;
+			Writer.Serialize((void*)Block.Densities.GetData(), Count);
+		}
+	}
+
+	return FFileHelper::SaveArrayToFile(Bytes, *Path);
+}
+
+// Gensys.Benchmark stage, the lake mask is mostly empty, the way most foliage layers are
+namespace
+{
+	FGensysBenchmarkStage SparseFoliageStage("SparseFoliage", true, [](const FGensysBenchmarkInputs& Inputs) -> FGensysBenchmarkStage::FBody
+	{
+		TSharedRef<FGensysMaskMap> LakeMask = MakeShared<FGensysMaskMap>();
+		TArray<FGensysLake> Lakes;
+		GensysLakes::Detect(Inputs.Heights, FGensysLakeSettings(), *LakeMask, Lakes);
+
+		TSharedRef<FGensysSparseFoliage> Foliage = MakeShared<FGensysSparseFoliage>();
+		return [LakeMask, Foliage, Resolution = Inputs.Resolution]()
+		{
+			Foliage->Init(Resolution, Resolution);
+			Foliage->AddLayer("Lakes", *LakeMask);
+		};
+	});
+}
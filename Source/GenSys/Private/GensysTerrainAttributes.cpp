@@ -0,0 +1,181 @@
+#include "GensysTerrainAttributes.h"
+#include "GensysParallel.h"
+#include "GensysPngStream.h"
+#include "GensysBenchmark.h"
+
+namespace
+{
+	// columns processed together inside a block of rows, keeps the occlusion search window in cache
+	constexpr int32 ColumnsPerTile = 256;
+
+	// scale applied to the laplacian before it is biased around 0.5
+	constexpr float CurvatureGain = 4.f;
+
+	// the 8 horizon search directions
+	const FIntPoint OcclusionDirections[] = {
+		{ 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 },
+		{ -1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 }
+	};
+}
+
+template<typename HeightStorageType>
+void GensysTerrainAttributes::Compute(const TGensysMap<HeightStorageType>& HeightMap, float HeightScale, FGensysTerrainAttributes& Out, FGensysBufferPool* Pool)
+{
+	const int32 Width = HeightMap.Width;
+	const int32 Height = HeightMap.Height;
+
+	Out.Slope.Init(Width, Height, Pool);
+	Out.Curvature.Init(Width, Height, Pool);
+	Out.Occlusion.Init(Width, Height, Pool);
+	Out.NormalX.Init(Width, Height, Pool);
+	Out.NormalY.Init(Width, Height, Pool);
+
+	GensysParallel::ForRowBlocks(Height, GensysParallel::DefaultRowsPerBlock, [&](int32 RowBegin, int32 RowEnd)
+	{
+		for (int32 TileX = 0; TileX < Width; TileX += ColumnsPerTile)
+		{
+			const int32 TileEnd = FMath::Min(TileX + ColumnsPerTile, Width);
+
+			for (int32 Y = RowBegin; Y < RowEnd; ++Y)
+			{
+				for (int32 X = TileX; X < TileEnd; ++X)
+				{
+					const float Centre = HeightMap.At(X, Y) * HeightScale;
+
+					// 3x3 neighbourhood, read once and shared by every attribute
+					float N[3][3];
+					for (int32 OffsetY = -1; OffsetY <= 1; ++OffsetY)
+						for (int32 OffsetX = -1; OffsetX <= 1; ++OffsetX)
+							N[OffsetY + 1][OffsetX + 1] = HeightMap.AtClamped(X + OffsetX, Y + OffsetY) * HeightScale;
+
+					// sobel gradient
+					const float DX = ((N[0][2] + 2.f * N[1][2] + N[2][2]) - (N[0][0] + 2.f * N[1][0] + N[2][0])) / 8.f;
+					const float DY = ((N[2][0] + 2.f * N[2][1] + N[2][2]) - (N[0][0] + 2.f * N[0][1] + N[0][2])) / 8.f;
+
+					const FVector3f Normal = FVector3f(-DX, -DY, 1.f).GetUnsafeNormal();
+					const int64 Index = (int64)Y * Width + X;
+
+					Out.NormalX.Set(Index, Normal.X * 0.5f + 0.5f);
+					Out.NormalY.Set(Index, Normal.Y * 0.5f + 0.5f);
+					Out.Slope.Set(Index, FMath::Acos(Normal.Z) / HALF_PI);
+
+					const float Laplacian = N[0][1] + N[2][1] + N[1][0] + N[1][2] - 4.f * Centre;
+					Out.Curvature.Set(Index, 0.5f + Laplacian * CurvatureGain / HeightScale);
+
+					// horizon based occlusion, the highest elevation angle found in each direction darkens the pixel
+					float Occluded = 0.f;
+					for (const FIntPoint& Direction : OcclusionDirections)
+					{
+						const float StepLength = FVector2f(Direction.X, Direction.Y).Size();
+						float MaxSine = 0.f;
+
+						for (int32 Step = 2; Step <= OcclusionRadius; Step *= 2)
+						{
+							const float Rise = HeightMap.AtClamped(X + Direction.X * Step, Y + Direction.Y * Step) * HeightScale - Centre;
+							const float Distance = StepLength * Step;
+							MaxSine = FMath::Max(MaxSine, Rise / FMath::Sqrt(Rise * Rise + Distance * Distance));
+						}
+
+						Occluded += MaxSine;
+					}
+
+					Out.Occlusion.Set(Index, 1.f - Occluded / UE_ARRAY_COUNT(OcclusionDirections));
+				}
+			}
+		}
+	});
+}
+
+void GensysTerrainAttributes::ComputeStreamed(FGensysHeightTileStore& HeightStore, float HeightScale, FGensysTerrainAttributeStores& Out, FGensysBufferPool* Pool)
+{
+	const int32 Width = HeightStore.GetWidth();
+	const int32 Height = HeightStore.GetHeight();
+	const int32 TileSize = HeightStore.GetTileSize();
+
+	// enough border for the occlusion search and the 3x3 stencil
+	const int32 Halo = OcclusionRadius + 1;
+
+	FGensysHeightMap Window;
+	FGensysTerrainAttributes WindowAttributes;
+
+	// interior of the window in the tile layout of the stores, the padding of the edge tiles is never read back
+	TArray<uint8> TileData;
+
+	const auto WriteTile = [&](FGensysMaskTileStore& Store, const FGensysMaskMap& Attribute, const FIntRect& Interior, const FIntRect& Padded)
+	{
+		TileData.SetNumZeroed(TileSize * TileSize);
+		for (int32 Y = Interior.Min.Y; Y < Interior.Max.Y; ++Y)
+		{
+			const int32 Source = (Y - Padded.Min.Y) * Attribute.Width + Interior.Min.X - Padded.Min.X;
+			FMemory::Memcpy(&TileData[(Y - Interior.Min.Y) * TileSize], &Attribute.Values[Source], Interior.Width() * sizeof(uint8));
+		}
+
+		Store.WriteTile(Interior.Min.X / TileSize, Interior.Min.Y / TileSize, TileData.GetData());
+	};
+
+	for (int32 TileY = 0; TileY < HeightStore.GetNumTilesY(); ++TileY)
+	{
+		for (int32 TileX = 0; TileX < HeightStore.GetNumTilesX(); ++TileX)
+		{
+			if (FGensysProgress::IsActiveCancelled())
+				return;
+
+			// the next row of tiles is touched by the halo, let the store start paging it in
+			HeightStore.Prefetch(TileX, TileY + 1);
+			HeightStore.Prefetch(TileX + 1, TileY);
+
+			const FIntRect Interior(TileX * TileSize, TileY * TileSize, FMath::Min((TileX + 1) * TileSize, Width), FMath::Min((TileY + 1) * TileSize, Height));
+			const FIntRect Padded(Interior.Min - FIntPoint(Halo), Interior.Max + FIntPoint(Halo));
+
+			HeightStore.ReadWindow(Padded, Window, Pool);
+			Compute(Window, HeightScale, WindowAttributes, Pool);
+
+			// keep only the interior, the halo was there for the stencils
+			WriteTile(Out.Slope, WindowAttributes.Slope, Interior, Padded);
+			WriteTile(Out.Curvature, WindowAttributes.Curvature, Interior, Padded);
+			WriteTile(Out.Occlusion, WindowAttributes.Occlusion, Interior, Padded);
+			WriteTile(Out.NormalX, WindowAttributes.NormalX, Interior, Padded);
+			WriteTile(Out.NormalY, WindowAttributes.NormalY, Interior, Padded);
+		}
+	}
+}
+
+bool GensysTerrainAttributes::WriteNormalRows(const FGensysMaskMap& NormalX, const FGensysMaskMap& NormalY, FGensysPngWriter& Writer)
+{
+	TArray<uint8> Row;
+	Row.SetNumUninitialized(NormalX.Width * 4);
+
+	for (int32 Y = 0; Y < NormalX.Height; ++Y)
+	{
+		for (int32 X = 0; X < NormalX.Width; ++X)
+		{
+			const float UnpackedX = NormalX.At(X, Y) * 2.f - 1.f;
+			const float UnpackedY = NormalY.At(X, Y) * 2.f - 1.f;
+			const float UnpackedZ = FMath::Sqrt(FMath::Max(0.f, 1.f - UnpackedX * UnpackedX - UnpackedY * UnpackedY));
+
+			uint8* Texel = &Row[X * 4];
+			Texel[0] = NormalX.Values[(int64)Y * NormalX.Width + X];
+			Texel[1] = NormalY.Values[(int64)Y * NormalX.Width + X];
+			Texel[2] = TGensysStorage<uint8>::Encode(UnpackedZ * 0.5f + 0.5f);
+			Texel[3] = 255;
+		}
+
+		if (!Writer.WriteRow(Row.GetData()))
+			return false;
+	}
+
+	return true;
+}
+
+template void GensysTerrainAttributes::Compute<float>(const FGensysMap&, float, FGensysTerrainAttributes&, FGensysBufferPool*);
+template void GensysTerrainAttributes::Compute<uint16>(const FGensysHeightMap&, float, FGensysTerrainAttributes&, FGensysBufferPool*);
+
+// Gensys.Benchmark stage
+namespace
+{
+	FGensysBenchmarkStage TerrainAttributesStage("TerrainAttributes", true, [](const FGensysBenchmarkInputs& Inputs) -> FGensysBenchmarkStage::FBody
+	{
+		TSharedRef<FGensysTerrainAttributes> Attributes = MakeShared<FGensysTerrainAttributes>();
+		return [Attributes, &Heights = Inputs.Heights]() { GensysTerrainAttributes::Compute(Heights, 64.f, *Attributes); };
+	});
+}
@@ -0,0 +1,247 @@
+#include "GensysTileStore.h"
+#include "HAL/PlatformFileManager.h"
+#include "Async/MappedFileHandle.h"
+
+template<typename StorageType>
+TGensysTileStore<StorageType>::~TGensysTileStore()
+{
+	Close();
+}
+
+template<typename StorageType>
+bool TGensysTileStore<StorageType>::Create(const FString& InPath, int32 InWidth, int32 InHeight, int32 InTileSize, int32 InMaxResidentTiles)
+{
+	Close();
+
+	Path = InPath;
+	Width = InWidth;
+	Height = InHeight;
+	TileSize = InTileSize;
+	NumTilesX = FMath::DivideAndRoundUp(Width, TileSize);
+	NumTilesY = FMath::DivideAndRoundUp(Height, TileSize);
+	MaxResidentTiles = FMath::Max(InMaxResidentTiles, 1);
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(Path));
+
+	Writer.Reset(PlatformFile.OpenWrite(*Path, false, true));
+	return Writer.IsValid();
+}
+
+template<typename StorageType>
+void TGensysTileStore<StorageType>::WriteTile(int32 TileX, int32 TileY, const StorageType* TileData)
+{
+	if (!ensure(Writer.IsValid()))
+		return;
+
+	Writer->Seek(GetTileOffset(TileX, TileY));
+	Writer->Write(reinterpret_cast<const uint8*>(TileData), GetTileBytes());
+}
+
+template<typename StorageType>
+void TGensysTileStore<StorageType>::WriteMap(const TGensysMap<StorageType>& Map)
+{
+	TArray<StorageType> TileData;
+	TileData.SetNumZeroed(TileSize * TileSize);
+
+	for (int32 TileY = 0; TileY < NumTilesY; ++TileY)
+	{
+		for (int32 TileX = 0; TileX < NumTilesX; ++TileX)
+		{
+			// edge tiles are padded by repeating the last row/column
+			for (int32 Y = 0; Y < TileSize; ++Y)
+			{
+				const int32 SourceY = FMath::Min(TileY * TileSize + Y, Map.Height - 1);
+
+				for (int32 X = 0; X < TileSize; ++X)
+				{
+					const int32 SourceX = FMath::Min(TileX * TileSize + X, Map.Width - 1);
+					TileData[Y * TileSize + X] = Map.Values[(int64)SourceY * Map.Width + SourceX];
+				}
+			}
+
+			WriteTile(TileX, TileY, TileData.GetData());
+		}
+	}
+}
+
+template<typename StorageType>
+void TGensysTileStore<StorageType>::WriteTileRow(int32 TileY, const TGensysMap<StorageType>& Rows)
+{
+	TArray<StorageType> TileData;
+	TileData.SetNumZeroed(TileSize * TileSize);
+
+	for (int32 TileX = 0; TileX < NumTilesX; ++TileX)
+	{
+		// edge tiles are padded by repeating the last row/column, like WriteMap
+		for (int32 Y = 0; Y < TileSize; ++Y)
+		{
+			const int32 SourceY = FMath::Min(Y, Rows.Height - 1);
+
+			for (int32 X = 0; X < TileSize; ++X)
+			{
+				const int32 SourceX = FMath::Min(TileX * TileSize + X, Width - 1);
+				TileData[Y * TileSize + X] = Rows.Values[(int64)SourceY * Rows.Width + SourceX];
+			}
+		}
+
+		WriteTile(TileX, TileY, TileData.GetData());
+	}
+}
+
+template<typename StorageType>
+bool TGensysTileStore<StorageType>::Finalize()
+{
+	if (!Writer.IsValid())
+		return false;
+
+	Writer->Flush();
+	Writer.Reset();
+
+	FOpenMappedResult Result = FPlatformFileManager::Get().GetPlatformFile().OpenMappedEx(*Path);
+	if (Result.HasError())
+		return false;
+
+	Mapping = Result.StealValue();
+	return Mapping.IsValid();
+}
+
+template<typename StorageType>
+const StorageType* TGensysTileStore<StorageType>::MapTile(int32 TileX, int32 TileY, bool bPreload)
+{
+	const FIntPoint Key(TileX, TileY);
+
+	if (FResidentTile* Resident = ResidentTiles.Find(Key))
+	{
+		Resident->LastUse = ++UseCounter;
+		return reinterpret_cast<const StorageType*>(Resident->Region->GetMappedPtr());
+	}
+
+	if (ResidentTiles.Num() >= MaxResidentTiles)
+		EvictLeastRecentlyUsed();
+
+	FResidentTile& Resident = ResidentTiles.Add(Key);
+	Resident.Region = Mapping->MapRegion(GetTileOffset(TileX, TileY), GetTileBytes(), bPreload);
+	Resident.LastUse = ++UseCounter;
+
+	return reinterpret_cast<const StorageType*>(Resident.Region->GetMappedPtr());
+}
+
+template<typename StorageType>
+void TGensysTileStore<StorageType>::EvictLeastRecentlyUsed()
+{
+	// the resident set is small, a linear scan is cheaper than maintaining a list
+	const FIntPoint* Oldest = nullptr;
+	uint64 OldestUse = MAX_uint64;
+
+	for (const auto& Resident : ResidentTiles)
+	{
+		if (Resident.Value.LastUse < OldestUse)
+		{
+			OldestUse = Resident.Value.LastUse;
+			Oldest = &Resident.Key;
+		}
+	}
+
+	if (Oldest == nullptr)
+		return;
+
+	const FIntPoint Key = *Oldest;
+	delete ResidentTiles[Key].Region;
+	ResidentTiles.Remove(Key);
+}
+
+template<typename StorageType>
+void TGensysTileStore<StorageType>::Prefetch(int32 TileX, int32 TileY)
+{
+	if (!Mapping.IsValid() || TileX < 0 || TileY < 0 || TileX >= NumTilesX || TileY >= NumTilesY)
+		return;
+
+	FScopeLock ScopeLock(&Lock);
+	MapTile(TileX, TileY, true);
+}
+
+template<typename StorageType>
+float TGensysTileStore<StorageType>::Sample(int32 X, int32 Y)
+{
+	X = FMath::Clamp(X, 0, Width - 1);
+	Y = FMath::Clamp(Y, 0, Height - 1);
+
+	FScopeLock ScopeLock(&Lock);
+	const StorageType* Tile = MapTile(X / TileSize, Y / TileSize, false);
+	return TGensysStorage<StorageType>::Decode(Tile[(Y % TileSize) * TileSize + X % TileSize]);
+}
+
+template<typename StorageType>
+void TGensysTileStore<StorageType>::ReadWindow(const FIntRect& Rect, TGensysMap<StorageType>& Out, FGensysBufferPool* Pool)
+{
+	Out.Init(Rect.Width(), Rect.Height(), Pool);
+
+	if (Rect.Width() <= 0 || Rect.Height() <= 0)
+		return;
+
+	FScopeLock ScopeLock(&Lock);
+
+	// tile by tile rather than row by row, a band as wide as the map spans more tiles than stay resident
+	// and a row walk would map every one of them again on each row
+	const int32 FirstTileX = FMath::Clamp(Rect.Min.X, 0, Width - 1) / TileSize;
+	const int32 LastTileX = FMath::Clamp(Rect.Max.X - 1, 0, Width - 1) / TileSize;
+	const int32 FirstTileY = FMath::Clamp(Rect.Min.Y, 0, Height - 1) / TileSize;
+	const int32 LastTileY = FMath::Clamp(Rect.Max.Y - 1, 0, Height - 1) / TileSize;
+
+	for (int32 TileY = FirstTileY; TileY <= LastTileY; ++TileY)
+	{
+		// the border tiles also cover the clamped part of the window past the map
+		const int32 YBegin = TileY == 0 ? Rect.Min.Y : FMath::Max(Rect.Min.Y, TileY * TileSize);
+		const int32 YEnd = TileY == NumTilesY - 1 ? Rect.Max.Y : FMath::Min(Rect.Max.Y, (TileY + 1) * TileSize);
+
+		for (int32 TileX = FirstTileX; TileX <= LastTileX; ++TileX)
+		{
+			const int32 XBegin = TileX == 0 ? Rect.Min.X : FMath::Max(Rect.Min.X, TileX * TileSize);
+			const int32 XEnd = TileX == NumTilesX - 1 ? Rect.Max.X : FMath::Min(Rect.Max.X, (TileX + 1) * TileSize);
+			const StorageType* Tile = MapTile(TileX, TileY, false);
+
+			for (int32 Y = YBegin; Y < YEnd; ++Y)
+			{
+				const int32 SourceRow = (FMath::Clamp(Y, 0, Height - 1) - TileY * TileSize) * TileSize - TileX * TileSize;
+				StorageType* Row = &Out.Values[(int64)(Y - Rect.Min.Y) * Out.Width];
+
+				for (int32 X = XBegin; X < XEnd; ++X)
+					Row[X - Rect.Min.X] = Tile[SourceRow + FMath::Clamp(X, 0, Width - 1)];
+			}
+		}
+	}
+}
+
+template<typename StorageType>
+void TGensysTileStore<StorageType>::Close()
+{
+	{
+		FScopeLock ScopeLock(&Lock);
+
+		for (auto& Resident : ResidentTiles)
+			delete Resident.Value.Region;
+
+		ResidentTiles.Empty();
+	}
+
+	Mapping.Reset();
+	Writer.Reset();
+
+	if (!Path.IsEmpty())
+		FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*Path);
+
+	Path.Empty();
+}
+
+template<typename StorageType>
+int32 TGensysTileStore<StorageType>::GetNumResidentTiles() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return ResidentTiles.Num();
+}
+
+template class TGensysTileStore<float>;
+template class TGensysTileStore<FFloat16>;
+template class TGensysTileStore<uint16>;
+template class TGensysTileStore<uint8>;
@@ -19,7 +19,52 @@ struct GensysParameters
 	std::string User_TerrainOutlineMap = "";
 	std::string User_TerrainFeatureMap = "";
 	std::string User_RiverOutline = "";
+	// texture assets used instead of the paths above when set
+	std::string User_TerrainOutlineAsset = "";
+	std::string User_TerrainFeatureAsset = "";
+	std::string User_RiverOutlineAsset = "";
 
 	//non Gensys core params
 	std::string Identifier = "BaseOutput";
-} UserParams;
\ No newline at end of file
+	bool BlendForcedFeatures = false;
+	int FeatureBlendLevels = 6;
+	int DetailNoiseOctaves = 0;
+	float DetailNoiseCellSize = 16;
+	float DetailNoiseAmplitude = 0.02;
+	int DetailNoiseSeed = 0;
+	int DetailNoiseMode = 0;
+	float DetailNoiseWarpStrength = 16;
+	bool ExportNoiseLayers = false;
+	bool ExportRiverGraph = false;
+	float RiverGraphNodeSpacing = 4;
+	bool RasteriseRivers = false;
+	int RiverProfile = 1;
+	float RiverOrderWidening = 0.5;
+	bool ExportRiverSplines = false;
+	float RiverSplineTolerance = 1.5;
+	float RiverSplineUnitsPerPixel = 100;
+	bool ExportDistanceFields = false;
+	float DistanceFalloff = 64;
+	bool ExportLakes = false;
+	float LakeMinDepth = 0.002;
+	int LakeMinArea = 16;
+	bool ExportTerrainAttributes = false;
+	float AttributeHeightScale = 64;
+	bool ClassifyTerrainLayers = false;
+	std::string LayerRulesPath = "";
+	std::string LayerWeightmaps = "";
+	bool BuildSparseFoliage = false;
+	std::string FoliageRulesPath = "";
+	std::string FoliageDensityMaps = "";
+	float OutOfCoreMegapixels = 0;
+	bool GenerateMipChains = false;
+	bool HeightMipsUseMax = false;
+	bool EmitBlockCompressed = false;
+	bool SkipTextureImport = false;
+	bool AlwaysReimport = false;
+	bool SkipAssetSaves = false;
+	std::string BatchManifestPath = "";
+};
+
+// parameters edited in the GenSys tab
+extern GensysParameters UserParams;
\ No newline at end of file
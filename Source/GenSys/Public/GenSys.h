@@ -4,6 +4,12 @@
 
 #include "CoreMinimal.h"
 #include "Modules/ModuleManager.h"
+#include "GensysTerrainAttributes.h"
+#include "GensysMipChain.h"
+#include "GensysGuideCache.h"
+#include "GensysProgress.h"
+#include "GensysJobQueue.h"
+#include "DataTypes.h"
 
 class FToolBarBuilder;
 class FMenuBuilder;
@@ -16,9 +22,30 @@ public:
 	virtual void StartupModule() override;
 	virtual void ShutdownModule() override;
 	
+	static FGenSysModule& Get() { return FModuleManager::LoadModuleChecked<FGenSysModule>("GenSys"); }
+
 	/** This function will be bound to Command (by default it will bring up plugin window) */
 	void PluginButtonClicked();
 	FReply RunGensys();
+
+	// Adds a parameter set to the pipelined queue, imported once generated
+	void QueueGensys(const GensysParameters& Params);
+
+	// Queues every entry of a batch manifest, see GensysBatchManifest.h
+	bool QueueBatch(const FString& ManifestPath);
+
+	// Runs the core for a parameter set, the outputs are left in the core folder of the slot
+	bool GenerateCoreOutputs(const GensysParameters& Params, FGensysProgress& Progress, int32 Slot = 0);
+
+	// Copies the core outputs of the slot into Content/Gensys/<Identifier> and runs the plugin side stages on them
+	// Out lists the maps to import, every output when AlwaysReimport is set
+	bool PrepareGensysOutput(const GensysParameters& Params, FGensysProgress& Progress, FGensysPreparedOutputs& Out, int32 Slot = 0);
+
+	// Absolute folder of the core executable, its input.json and its outputs
+	FString GetCoreFolder(int32 Slot = 0) const;
+
+	// Names of the png files produced by the core
+	static const TArray<FString>& GetCoreOutputNames();
 	
 private:
 
@@ -33,10 +60,70 @@ private:
 	const FString PluginsRelativePath = "GenSys/Resources/GenSysCoreShell/";
 	const FString ExecutableName = "CoreTester.exe";
 
-	void RunGensysShell();
-	void ExportParamsIntoJson(const FString& Path = "");
-	void ImportFile(const FString& In, const FString& RelativeDest, const FString& Filename);
+	bool RunGensysShell(FGensysProgress& Progress, const FString& ExePath);
+	void ExportParamsIntoJson(const GensysParameters& Params, const FString& CoreFolder);
+	bool MirrorCoreFolder(int32 Slot);
+	FString ResolveGuide(const std::string& Path, const std::string& AssetPath);
+	FString ResolveGuideLocked(const std::string& Path, const std::string& AssetPath, FString& OutKey);
+	template<typename StorageType>
+	bool LoadGuideAtSize(const std::string& Path, const std::string& AssetPath, int32 Width, int32 Height, TGensysMap<StorageType>& Out);
+	UObject* ImportFile(const FString& In, const FString& RelativeDest, const FString& Filename);
 	void SetupGensysContentFolder();
 	void MoveContentData();
-	void ImportGensysOutput();
+	void ImportGensysOutput(const FGensysPreparedOutputs& Outputs, FGensysProgress& Progress);
+	void SkipUnchangedOutputs(const GensysParameters& Params, FGensysPreparedOutputs& Out);
+	void RecordImportedHashes(const FGensysPreparedOutputs& Outputs, const TArray<FString>& Imported);
+	void SavePendingPackages();
+	void BlendForcedFeatures(const GensysParameters& Params, const FString& Folder);
+	void ApplyDetailNoise(const GensysParameters& Params, const FString& Folder, TArray<FString>& OutFiles);
+	void TraceRiverGraph(const GensysParameters& Params, const FString& Folder, FGensysRiverGraph& OutGraph);
+	void RasteriseRivers(const GensysParameters& Params, const FString& Folder, const FGensysRiverGraph& Graph);
+	void BuildRiverPolylines(const GensysParameters& Params, const FString& Folder, FGensysPreparedOutputs& Out);
+	void SpawnRiverSplines(const FGensysPreparedOutputs& Outputs);
+	void GenerateDistanceFields(const GensysParameters& Params, const FString& Folder, TArray<FString>& OutFiles);
+	void GenerateLakes(const GensysParameters& Params, const FString& Folder, TArray<FString>& OutFiles);
+	void GenerateTerrainAttributes(const GensysParameters& Params, const FString& Folder, bool bOutOfCore, TArray<FString>& OutFiles);
+	void EnsureTerrainAttributes(const GensysParameters& Params, const FString& Folder, const FGensysHeightMap& HeightMap);
+	bool EnsureTerrainStores(const GensysParameters& Params, const FString& Folder);
+	void CloseTerrainStores();
+	bool ComputeRiverProximity(const GensysParameters& Params, const FString& Folder, FGensysMap& Out);
+	bool ComputeRiverProximityStreamed(const GensysParameters& Params, const FString& Folder);
+	void ClassifyTerrainLayers(const GensysParameters& Params, const FString& Folder, bool bOutOfCore, TArray<FString>& OutFiles);
+	void ClassifyTerrainLayersStreamed(const GensysParameters& Params, const FString& Folder, const TArray<struct FGensysLayerRule>& Rules,
+		const TArray<TPair<int32, FString>>& Weightmaps, TArray<FString>& OutFiles);
+	void BuildSparseFoliage(const GensysParameters& Params, const FString& Folder, bool bOutOfCore, TArray<FString>& OutFiles);
+	void GenerateMipChains(const GensysParameters& Params, const FString& Folder, const TArray<FString>& Files, TMap<FString, FGensysMipChain>& OutChains);
+	void ApplyMipChain(class UTexture2D* Texture, const FGensysMipChain& Chain);
+	void WriteBlockCompressedOutputs(const GensysParameters& Params, const FString& Folder, const TArray<FString>& Files);
+	FReply QueueUserParams();
+	FReply QueueUserManifest();
+
+	// Intermediate buffers of the plugin side stages are borrowed from here, declared first so it outlives them
+	FGensysBufferPool BufferPool;
+
+	// Duration of the last core run, used to estimate its progress since the core does not report any
+	std::atomic<double> LastCoreSeconds { 0 };
+
+	// Decoded guide images, kept for the whole editor session
+	// the queue worker and the game thread both resolve guides
+	FGensysGuideCache GuideCache;
+	FCriticalSection GuideCacheLock;
+
+	// Attributes derived from the last generated TerrainMap, shared by every plugin side stage
+	FGensysTerrainAttributes TerrainAttributes;
+	// output folder the attributes (or their stores) were computed for, empty when they are stale
+	FString TerrainAttributesFolder;
+	FCriticalSection TerrainAttributesLock;
+
+	// Out of core counterparts for a TerrainMap past OutOfCoreMegapixels, the heights, the attributes and the river proximity
+	// they only live for the attributes block of a generation, their backing files are deleted once it is over
+	FGensysHeightTileStore TerrainHeightStore;
+	FGensysTerrainAttributeStores TerrainAttributeStores;
+	FGensysHeightTileStore RiverProximityStore;
+
+	// Packages imported since the last save, saved together at the end of a job or once the queue goes idle
+	TSet<TWeakObjectPtr<UPackage>> PendingSaves;
+
+	// Generates queued landscapes on a worker while the previous ones are imported, created on first use
+	TUniquePtr<FGensysJobQueue> JobQueue;
 };
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DataTypes.h"
+
+// Batch manifest, many landscapes queued at once:
+// {
+//   "MaxConcurrentCores": 2,
+//   "Defaults": { <parameters shared by every entry> },
+//   "Entries": [ { "Identifier": "Valley", <parameters overriding the defaults> }, ... ]
+// }
+// Parameters use the input.json key names, guide paths are relative to the manifest
+namespace GensysBatchManifest
+{
+	// Upper bound of cores running at once, each needs its own GPU context
+	constexpr int32 MaxCoreSlots = 8;
+
+	bool Load(const FString& Path, TArray<GensysParameters>& OutEntries, int32& OutMaxConcurrentCores, FString& OutError);
+}
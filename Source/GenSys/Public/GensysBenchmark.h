@@ -0,0 +1,44 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageCore.h"
+#include "GensysMap.h"
+
+// Inputs shared by every benchmarked stage at one resolution, built once per resolution by Gensys.Benchmark
+struct FGensysBenchmarkInputs
+{
+	int32 Resolution = 0;
+	// deterministic rolling terrain, enough structure for the stencils and the compressors to do real work
+	FGensysHeightMap Heights;
+	// contour lines of the heights, stand in for river channels
+	FGensysMap RiverMap;
+	// three channels derived from the heights, RGBA32F and BGRA8
+	FImage Colour;
+	FImage ColourBGRA8;
+	// files written by a stage go here, deleted after every resolution
+	FString ScratchFolder;
+};
+
+// A stage of the Gensys.Benchmark console command, registered from the module it measures:
+//   static FGensysBenchmarkStage Stage("Name", true, [](const FGensysBenchmarkInputs& Inputs) { ...; return [=]() { ... }; });
+// Setup runs once per resolution, untimed, and returns the body that is timed, the body keeps its outputs in its captures
+// so they are released before the next stage and its memory delta is its own
+class FGensysBenchmarkStage
+{
+public:
+	using FBody = TFunction<void()>;
+	using FSetup = TFunction<FBody(const FGensysBenchmarkInputs& Inputs)>;
+
+	FGensysBenchmarkStage(const char* InName, bool bInThreaded, FSetup InSetup);
+
+	const char* Name;
+	// stages that do not scale with workers only run once, with all of them
+	bool bThreaded;
+	FSetup Setup;
+
+	// Every registered stage, sorted by name
+	static TArray<const FGensysBenchmarkStage*> GetAll();
+
+private:
+	static TArray<const FGensysBenchmarkStage*>& GetRegistry();
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FGensysMipChain;
+
+// GPU block compressed formats the outputs can be emitted in
+enum class EGensysBlockFormat : uint8
+{
+	// single channel (red), heights and erosion
+	BC4,
+	// two channels (red, green), packed masks with up to two layers
+	BC5,
+	// RGBA, packed masks with up to four layers (mode 6 only)
+	BC7
+};
+
+// The .dds files are written next to the pngs for consumers outside the editor (runtime streaming, other tools)
+// The editor import still reads the pngs and compresses them itself, the payloads are not used for the assets
+namespace GensysBlockCompression
+{
+	// Bytes of a single 4x4 block
+	int32 GetBlockBytes(EGensysBlockFormat Format);
+
+	// Compresses one BGRA8 level, the blocks are split over the task graph one row of blocks at a time
+	void CompressLevel(const FColor* Pixels, int32 Width, int32 Height, EGensysBlockFormat Format, TArray64<uint8>& Out);
+
+	// Compresses every level of a BGRA8 mip chain and writes them as a DX10 .dds file
+	bool WriteDDS(const FString& Path, const FGensysMipChain& Chain, EGensysBlockFormat Format);
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Size bucketed pool of large blocks, owned by the generation session and shared by all the stages
+// Blocks are rounded up to a power of two so the same resolution always lands in the same bucket,
+// after the first run of a given resolution no further large allocations are made
+class FGensysBufferPool
+{
+public:
+	FGensysBufferPool() = default;
+	FGensysBufferPool(const FGensysBufferPool&) = delete;
+	FGensysBufferPool& operator=(const FGensysBufferPool&) = delete;
+	~FGensysBufferPool();
+
+	// Returns a block of at least Bytes bytes, reusing a free block of the same bucket when there is one
+	void* Acquire(int64 Bytes);
+
+	// Gives the block back, Bytes must be the size it was acquired with
+	void Release(void* Block, int64 Bytes);
+
+	// Frees every block currently not borrowed
+	void Trim();
+
+	int64 GetPooledBytes() const;
+	int64 GetBorrowedBytes() const;
+
+	static int64 GetBucketSize(int64 Bytes);
+
+private:
+	mutable FCriticalSection Lock;
+	TMap<int64, TArray<void*>> FreeBlocks;
+	int64 PooledBytes = 0;
+	int64 BorrowedBytes = 0;
+};
+
+// Move only typed buffer, storage comes from the pool if one is given, otherwise from the heap
+template<typename ElementType>
+class TGensysBuffer
+{
+public:
+	TGensysBuffer() = default;
+	TGensysBuffer(const TGensysBuffer&) = delete;
+	TGensysBuffer& operator=(const TGensysBuffer&) = delete;
+
+	TGensysBuffer(TGensysBuffer&& Other) { *this = MoveTemp(Other); }
+
+	TGensysBuffer& operator=(TGensysBuffer&& Other)
+	{
+		if (this != &Other)
+		{
+			Reset();
+			Data = Other.Data;
+			Count = Other.Count;
+			Pool = Other.Pool;
+			Other.Data = nullptr;
+			Other.Count = 0;
+			Other.Pool = nullptr;
+		}
+		return *this;
+	}
+
+	~TGensysBuffer() { Reset(); }
+
+	// Storage is left uninitialised, like TArray::SetNumUninitialized
+	void Allocate(int64 InCount, FGensysBufferPool* InPool = nullptr)
+	{
+		if (InCount == Count && InPool == Pool)
+			return;
+
+		Reset();
+		Count = InCount;
+		Pool = InPool;
+
+		if (Count == 0)
+			return;
+
+		Data = static_cast<ElementType*>(Pool ? Pool->Acquire(GetAllocatedBytes()) : FMemory::Malloc(GetAllocatedBytes()));
+	}
+
+	void Reset()
+	{
+		if (Data)
+		{
+			if (Pool)
+				Pool->Release(Data, GetAllocatedBytes());
+			else
+				FMemory::Free(Data);
+		}
+
+		Data = nullptr;
+		Count = 0;
+		Pool = nullptr;
+	}
+
+	int64 Num() const { return Count; }
+	ElementType* GetData() { return Data; }
+	const ElementType* GetData() const { return Data; }
+
+	ElementType& operator[](int64 Index) { checkSlow(Index >= 0 && Index < Count); return Data[Index]; }
+	const ElementType& operator[](int64 Index) const { checkSlow(Index >= 0 && Index < Count); return Data[Index]; }
+
+	ElementType* begin() { return Data; }
+	ElementType* end() { return Data + Count; }
+	const ElementType* begin() const { return Data; }
+	const ElementType* end() const { return Data + Count; }
+
+private:
+	int64 GetAllocatedBytes() const { return Count * (int64)sizeof(ElementType); }
+
+	ElementType* Data = nullptr;
+	int64 Count = 0;
+	FGensysBufferPool* Pool = nullptr;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GensysMap.h"
+
+// Exact Euclidean distance transforms, linear in the pixel count whatever the distances involved
+// The envelope is built in double, the squared distances are stored in float (exact up to 4096 pixels, then rounded)
+// Separable lower envelope of parabolas (Felzenszwalb & Huttenlocher), one pass over the columns then one over the rows,
+// both split over the task graph
+namespace GensysDistanceField
+{
+	// Squared value large enough to mean "no feature", small enough to keep the envelope intersections finite
+	constexpr float FarSquared = 1e20f;
+
+	// In place, Grid holds 0 on feature pixels and FarSquared elsewhere on entry, the squared distance in pixels to the
+	// nearest feature pixel on return
+	void TransformSquared(float* Grid, int32 Width, int32 Height);
+
+	// Distance in pixels of every pixel to the nearest pixel above the threshold, 1e10 when there is none
+	template<typename StorageType>
+	void Compute(const TGensysMap<StorageType>& Features, float Threshold, FGensysMap& Out, FGensysBufferPool* Pool = nullptr)
+	{
+		Out.Init(Features.Width, Features.Height, Pool);
+		float* Grid = Out.Values.GetData();
+
+		for (int64 Index = 0; Index < Features.Num(); ++Index)
+			Grid[Index] = Features.Get(Index) > Threshold ? 0.f : FarSquared;
+
+		TransformSquared(Grid, Features.Width, Features.Height);
+
+		for (int64 Index = 0; Index < Features.Num(); ++Index)
+			Grid[Index] = FMath::Sqrt(Grid[Index]);
+	}
+
+	// Signed distance in pixels to the boundary of the region above the threshold, negative inside
+	template<typename StorageType>
+	void ComputeSigned(const TGensysMap<StorageType>& Region, float Threshold, FGensysMap& Out, FGensysBufferPool* Pool = nullptr)
+	{
+		FGensysMap Inside;
+		Inside.Init(Region.Width, Region.Height, Pool);
+		Out.Init(Region.Width, Region.Height, Pool);
+
+		float* ToInside = Out.Values.GetData();
+		float* ToOutside = Inside.Values.GetData();
+		for (int64 Index = 0; Index < Region.Num(); ++Index)
+		{
+			const bool bInside = Region.Get(Index) > Threshold;
+			ToInside[Index] = bInside ? 0.f : FarSquared;
+			ToOutside[Index] = bInside ? FarSquared : 0.f;
+		}
+
+		TransformSquared(ToInside, Region.Width, Region.Height);
+		TransformSquared(ToOutside, Region.Width, Region.Height);
+
+		for (int64 Index = 0; Index < Region.Num(); ++Index)
+			ToInside[Index] = FMath::Sqrt(ToInside[Index]) - FMath::Sqrt(ToOutside[Index]);
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageCore.h"
+#include "GensysMap.h"
+
+class UTexture2D;
+
+// Decoded user guide images (outline, forced level, river outline) kept across runs
+// A guide is decoded again only when its source changes (file modification time, or the source id of a texture asset),
+// guides of any resolution are resampled to the working resolution of the core and written once into the cache folder
+// at 16 bits per channel, the plugin side stages sample the 16 bit red channel kept here at their own resolution
+class FGensysGuideCache
+{
+public:
+	// The core only accepts guides of exactly this size
+	static constexpr int32 WorkingResolution = 512;
+
+	void SetCacheFolder(const FString& InCacheFolder) { CacheFolder = InCacheFolder; }
+
+	// Returns the path the core should read for the guide, empty if the guide could not be decoded
+	FString Resolve(const FString& SourcePath);
+
+	// Same for a content browser texture, its source mip data is read straight from memory
+	FString Resolve(UTexture2D* Texture);
+
+	// Red channel of a resolved guide resampled to the given size, the key is the file path or texture path name
+	// given to Resolve, or the working copy it returned (queued jobs only get that one for texture guides)
+	// The result is kept for the next request of the same size, null when the guide was never resolved
+	const FGensysHeightMap* Sample(const FString& Key, int32 Width, int32 Height);
+
+	// Drops every decoded guide
+	void Empty() { Entries.Empty(); }
+
+private:
+	struct FEntry
+	{
+		FString Version;
+		FString ResolvedPath;
+		// red channel at the source resolution, 16 bits
+		FGensysHeightMap Source;
+		// last size asked for by Sample
+		FGensysHeightMap Resampled;
+	};
+
+	// Returns the cached path if the entry is still at the given version
+	const FString* FindCurrent(const FString& Key, const FString& Version) const;
+
+	// Entry of a source, or the entry that wrote the given working copy
+	FEntry* FindEntry(const FString& KeyOrResolvedPath);
+
+	// Resamples a freshly decoded guide and writes it for the core, PassThroughPath is used when no resampling is needed
+	FString Store(const FString& Key, const FString& Version, FImage& Decoded, const FString& PassThroughPath);
+
+	FString CacheFolder;
+	TMap<FString, FEntry> Entries;
+};
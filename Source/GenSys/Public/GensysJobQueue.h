@@ -0,0 +1,101 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "Containers/Ticker.h"
+#include "DataTypes.h"
+#include "GensysMipChain.h"
+#include "GensysProgress.h"
+#include "GensysRiverSplines.h"
+#include <atomic>
+
+class SNotificationItem;
+
+// Outputs of a generated landscape, ready to be imported
+struct FGensysPreparedOutputs
+{
+	// absolute content folder holding the pngs
+	FString Folder;
+	FString Identifier;
+	// preview runs leave the imported packages dirty instead of queueing them for the batch save
+	bool bSkipAssetSaves = false;
+	// files to import, empty when the import is skipped, unchanged outputs are left out
+	TArray<FString> Files;
+	// content hash of every file to import, recorded once it is imported
+	TMap<FString, FString> Hashes;
+	TMap<FString, FGensysMipChain> MipChains;
+	// empty unless a stage needed the river network
+	FGensysRiverGraph RiverGraph;
+	// simplified river runs turned into spline components on import
+	TArray<FGensysRiverPolyline> RiverPolylines;
+	float RiverUnitsPerPixel = 100.f;
+};
+
+struct FGensysJob
+{
+	FGensysJob(const GensysParameters& InParams, int32 NumStages) : Params(InParams), Progress(NumStages) {}
+
+	GensysParameters Params;
+	FGensysProgress Progress;
+	FGensysPreparedOutputs Outputs;
+};
+
+// Two stage pipeline for queued landscapes
+// Worker threads run the core and the plugin side stages of the next jobs while the game thread imports and saves the
+// previous ones. At most MaxReadyJobs generated jobs wait for their import so the mip chains they hold do not pile up
+// Every worker owns a core slot (its own core working folder), slot 0 is the plugin folder itself
+class FGensysJobQueue : public FRunnable
+{
+public:
+	static constexpr int32 MaxReadyJobs = 2;
+
+	// Generate runs on a worker and returns false when the job failed or was cancelled, Import runs on the game thread
+	// Idle runs on the game thread once the last job is done, whether it was imported, failed or was cancelled
+	using FGenerateFunction = TFunction<bool(FGensysJob&, int32 Slot)>;
+	using FImportFunction = TFunction<void(FGensysJob&)>;
+	using FIdleFunction = TFunction<void()>;
+
+	FGensysJobQueue(FGenerateFunction InGenerate, FImportFunction InImport, FIdleFunction InIdle);
+	virtual ~FGensysJobQueue();
+
+	void Enqueue(const GensysParameters& Params, int32 NumStages);
+
+	// Starts workers until there are at least NumWorkers, workers are never removed before the queue goes away
+	void EnsureWorkers(int32 NumWorkers);
+
+	// Cancels the running jobs and drops the queued ones
+	void CancelAll();
+
+	// Jobs queued, generating, waiting for import or importing
+	int32 GetNumJobs() const;
+
+	// FRunnable
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	// Takes the next pending job whose content folder is not still being imported
+	TSharedPtr<FGensysJob> PopPending();
+
+	bool TickImport(float DeltaTime);
+	void UpdateNotification();
+
+	FGenerateFunction Generate;
+	FImportFunction Import;
+	FIdleFunction Idle;
+
+	mutable FCriticalSection Lock;
+	TArray<TSharedRef<FGensysJob>> Pending;
+	TArray<TSharedRef<FGensysJob>> Ready;
+	TArray<TSharedRef<FGensysJob>> Generating;
+	TSharedPtr<FGensysJob> Importing;
+
+	FEvent* WakeUp = nullptr;
+	TArray<FRunnableThread*> Threads;
+	std::atomic<bool> bStopping { false };
+	std::atomic<int32> NextSlot { 0 };
+
+	FTSTicker::FDelegateHandle TickerHandle;
+	TWeakPtr<SNotificationItem> Notification;
+	int32 NumFinished = 0;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+//external JSON library by nlohmann
+#include "json.hpp"
+
+#include <string>
+#include <type_traits>
+
+// Type checked reads of the json files written by users (parameter sets, manifests, rules, tolerances)
+// The editor is built without exceptions, a value read as the wrong type would abort it instead of failing the file
+namespace GensysJson
+{
+	// True when the value can be read as T without throwing
+	template<typename T>
+	bool HasType(const nlohmann::json& Value)
+	{
+		if constexpr (std::is_same_v<T, bool>)
+			return Value.is_boolean();
+		else if constexpr (std::is_same_v<T, std::string>)
+			return Value.is_string();
+		else
+		{
+			static_assert(std::is_arithmetic_v<T>, "numbers, booleans and strings only");
+			return Value.is_number();
+		}
+	}
+
+	// Reads an optional field of an object, a missing field keeps the value already there
+	// Returns false with the error set when the field is there with another type
+	template<typename T>
+	bool Read(const nlohmann::json& Object, const char* Key, T& InOut, FString& OutError)
+	{
+		if (!Object.is_object() || !Object.contains(Key))
+			return true;
+
+		const nlohmann::json& Value = Object.at(Key);
+		if (!HasType<T>(Value))
+		{
+			OutError = FString::Printf(TEXT("%s should be a %s"), UTF8_TO_TCHAR(Key),
+				std::is_same_v<T, bool> ? TEXT("boolean") : std::is_same_v<T, std::string> ? TEXT("string") : TEXT("number"));
+			return false;
+		}
+
+		Value.get_to(InOut);
+		return true;
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GensysMap.h"
+
+// Closed basin of the terrain, filled up to the height it would spill over at
+struct FGensysLake
+{
+	int64 Area = 0;
+	// normalised heights, the water level and its deepest point below it
+	float SpillHeight = 0.f;
+	float MaxDepth = 0.f;
+	// outer shore in pixels, clockwise and closed without repeating the first point
+	TArray<FVector2f> Outline;
+};
+
+struct FGensysLakeSettings
+{
+	// shallower basins are left as they are, normalised height
+	float MinDepth = 0.002f;
+	// smaller basins are dropped, pixels
+	int32 MinArea = 16;
+	// Douglas-Peucker tolerance of the outlines, pixels
+	float OutlineTolerance = 1.f;
+};
+
+namespace GensysLakes
+{
+	// Priority flood from the map border, every pixel is raised to the lowest height water could leave the map from
+	// The heights are 16 bit so the priority queue is a bucket per level and the whole flood is linear
+	void FillDepressions(const FGensysHeightMap& Heights, FGensysHeightMap& OutFilled, FGensysBufferPool* Pool = nullptr);
+
+	// 8-connected components of the non zero pixels, INDEX_NONE elsewhere, labels numbered in raster order
+	// Row blocks are labelled in parallel with a union-find each, only the rows between blocks are joined serially
+	int32 LabelComponents(const FGensysMaskMap& Mask, TArray64<int64>& OutLabels);
+
+	// Lake mask (1 under water) and the lakes deep and large enough to keep
+	void Detect(const FGensysHeightMap& Heights, const FGensysLakeSettings& Settings, FGensysMaskMap& OutMask, TArray<FGensysLake>& OutLakes,
+		FGensysBufferPool* Pool = nullptr);
+
+	// Outlines as UV points (0-1) with the water level and depth of every lake
+	bool SaveJson(const TArray<FGensysLake>& Lakes, int32 Width, int32 Height, const FString& Path);
+}
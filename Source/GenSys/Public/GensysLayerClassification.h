@@ -0,0 +1,70 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GensysMap.h"
+
+// One terrain layer and where it grows, every range is fully in between its bounds and ramps out over the blend width
+struct FGensysLayerRule
+{
+	FString Name;
+	// normalised height
+	FVector2f Height = FVector2f(0.f, 1.f);
+	// 0 flat - 1 vertical
+	FVector2f Slope = FVector2f(0.f, 1.f);
+	// 1 on the river channels down to 0 a distance falloff away
+	FVector2f River = FVector2f(0.f, 1.f);
+	float Blend = 0.05f;
+	// strength against the other rules covering the same pixel
+	float Weight = 1.f;
+};
+
+// Strongest layers of every pixel, IDs and weights side by side so the memory does not grow with the layer count
+struct FGensysLayerWeights
+{
+	// layers kept per pixel, one RGBA8 texel of IDs and one of weights
+	static constexpr int32 LayersPerPixel = 4;
+	// IDs are stored in a byte, the last value marks an empty slot
+	static constexpr int32 MaxLayers = 255;
+	// ID of the slots no layer fills (pixels covered by fewer rules than LayersPerPixel), always with a weight of 0
+	// The material decode skips these slots instead of reading the layer at index 255
+	static constexpr uint8 EmptyId = 255;
+
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 NumLayers = 0;
+	// LayersPerPixel per pixel, strongest first, the weights of a pixel sum to 255, unused slots hold EmptyId
+	TGensysBuffer<uint8> Ids;
+	TGensysBuffer<uint8> Weights;
+
+	bool IsEmpty() const { return Width == 0 || Height == 0; }
+
+	// Weightmap of a single layer, only built for the layers that are asked for
+	void ExtractLayer(int32 Layer, FGensysMaskMap& Out, FGensysBufferPool* Pool = nullptr) const;
+
+	// IDs and weights as two RGBA8 images
+	bool Save(const FString& IdsPath, const FString& WeightsPath) const;
+};
+
+namespace GensysLayerClassification
+{
+	// 1 inside the range, linear ramp to 0 over the blend width outside of it
+	FORCEINLINE float GetMembership(float Value, const FVector2f& Range, float InvBlend)
+	{
+		return FMath::Clamp(FMath::Min(Value - Range.X, Range.Y - Value) * InvBlend + 1.f, 0.f, 1.f);
+	}
+
+	// Weighted membership of a pixel in a rule
+	FORCEINLINE float Evaluate(const FGensysLayerRule& Rule, float Height, float Slope, float River)
+	{
+		const float InvBlend = 1.f / FMath::Max(Rule.Blend, 1e-4f);
+		return Rule.Weight * GetMembership(Height, Rule.Height, InvBlend) * GetMembership(Slope, Rule.Slope, InvBlend) * GetMembership(River, Rule.River, InvBlend);
+	}
+
+	// {"Layers": [{"Name": "Sand", "Height": [0, 0.1], "Slope": [0, 0.3], "River": [0, 1], "Blend": 0.05, "Weight": 1}, ...]}
+	bool LoadRules(const FString& Path, TArray<FGensysLayerRule>& OutRules, FString& OutError);
+
+	// Evaluates every rule over whole rows at a time (branch free loops the compiler vectorises), then keeps the strongest
+	// layers of each pixel. Pixels no rule covers fall back to the first layer. RiverProximity may be null
+	void Classify(const TArray<FGensysLayerRule>& Rules, const FGensysHeightMap& Heights, const FGensysMaskMap& Slope, const FGensysMap* RiverProximity,
+		FGensysLayerWeights& Out, FGensysBufferPool* Pool = nullptr);
+}
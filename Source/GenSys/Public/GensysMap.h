@@ -0,0 +1,107 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GensysBufferPool.h"
+
+// Encoding of a single normalised 0-1 value for the supported map storage types
+// Kernels always work on floats, the conversion happens on load/store so it stays in registers
+template<typename StorageType>
+struct TGensysStorage;
+
+template<>
+struct TGensysStorage<float>
+{
+	static float Decode(float Value) { return Value; }
+	static float Encode(float Value) { return Value; }
+};
+
+// half precision, used for the noise and blur intermediates
+template<>
+struct TGensysStorage<FFloat16>
+{
+	static float Decode(FFloat16 Value) { return Value.GetFloat(); }
+	static FFloat16 Encode(float Value) { return FFloat16(Value); }
+};
+
+// 16 bit normalised, used for heights
+template<>
+struct TGensysStorage<uint16>
+{
+	static float Decode(uint16 Value) { return Value * (1.f / 65535.f); }
+	static uint16 Encode(float Value) { return (uint16)FMath::RoundToInt(FMath::Clamp(Value, 0.f, 1.f) * 65535.f); }
+};
+
+// 8 bit normalised, used for masks and layer IDs
+template<>
+struct TGensysStorage<uint8>
+{
+	static float Decode(uint8 Value) { return Value * (1.f / 255.f); }
+	static uint8 Encode(float Value) { return (uint8)FMath::RoundToInt(FMath::Clamp(Value, 0.f, 1.f) * 255.f); }
+};
+
+// Single channel map used for the plugin side processing of the Gensys core outputs
+// Values are stored row major, normalised to 0-1 and encoded by the storage type
+template<typename StorageType>
+struct TGensysMap
+{
+	using FStorage = TGensysStorage<StorageType>;
+
+	int32 Width = 0;
+	int32 Height = 0;
+	TGensysBuffer<StorageType> Values;
+
+	// Storage is borrowed from the pool when given one and returned when the map is reset or destroyed
+	void Init(int32 InWidth, int32 InHeight, FGensysBufferPool* Pool = nullptr)
+	{
+		Width = InWidth;
+		Height = InHeight;
+		Values.Allocate((int64)InWidth * InHeight, Pool);
+	}
+
+	void Reset()
+	{
+		Width = 0;
+		Height = 0;
+		Values.Reset();
+	}
+
+	bool IsEmpty() const { return Width == 0 || Height == 0; }
+	// pixel indices are 64 bit, 32 bit ones overflow past 46k x 46k
+	int64 Num() const { return (int64)Width * Height; }
+	int64 GetAllocatedSize() const { return Values.Num() * (int64)sizeof(StorageType); }
+
+	float Get(int64 Index) const { return FStorage::Decode(Values[Index]); }
+	void Set(int64 Index, float Value) { Values[Index] = FStorage::Encode(Value); }
+
+	float At(int32 X, int32 Y) const { return Get((int64)Y * Width + X); }
+	void Set(int32 X, int32 Y, float Value) { Set((int64)Y * Width + X, Value); }
+
+	// Edge clamped read, used by the neighbourhood stencils at the map borders
+	float AtClamped(int32 X, int32 Y) const
+	{
+		return Get((int64)FMath::Clamp(Y, 0, Height - 1) * Width + FMath::Clamp(X, 0, Width - 1));
+	}
+};
+
+// Storage policy per kind of buffer
+using FGensysMap = TGensysMap<float>;
+using FGensysHalfMap = TGensysMap<FFloat16>;
+using FGensysHeightMap = TGensysMap<uint16>;
+using FGensysMaskMap = TGensysMap<uint8>;
+
+struct FImage;
+
+namespace GensysImage
+{
+	// Loads any image format known to the engine and converts it into a single channel map (red channel)
+	template<typename StorageType>
+	bool LoadMap(const FString& Path, TGensysMap<StorageType>& Out, FGensysBufferPool* Pool = nullptr);
+
+	// Same conversion for an image already decoded, the image is converted in place
+	template<typename StorageType>
+	void ImageToMap(FImage& Image, TGensysMap<StorageType>& Out, FGensysBufferPool* Pool = nullptr);
+
+	// Saves the map as a 16 bit grayscale png
+	template<typename StorageType>
+	bool SaveMap(const FString& Path, const TGensysMap<StorageType>& Map);
+}
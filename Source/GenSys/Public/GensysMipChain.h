@@ -0,0 +1,46 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GensysMap.h"
+
+struct FImage;
+
+// How 2x2 texels are reduced into one texel of the next mip
+enum class EGensysMipFilter : uint8
+{
+	// box average, heights and erosion
+	Average,
+	// keeps peaks visible in the distance, heights
+	Max,
+	// most frequent value, layer IDs must never be blended into IDs that do not exist
+	Mode,
+	// average rescaled so the share of texels above half stays the same as in the base level, foliage density
+	Coverage
+};
+
+// Full mip pyramid in the layout expected by FTextureSource::Init (largest mip first, tightly packed)
+struct FGensysMipChain
+{
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 NumMips = 0;
+	// bytes per texel, 2 for G16 and 4 for BGRA8
+	int32 BytesPerPixel = 0;
+	TArray64<uint8> Data;
+
+	bool IsEmpty() const { return NumMips == 0; }
+};
+
+namespace GensysMipChain
+{
+	// Builds the chain for a single channel 16 bit map, supports Average and Max
+	void Build(const FGensysHeightMap& Base, EGensysMipFilter Filter, FGensysMipChain& Out);
+
+	// Builds the chain for a BGRA8 image, every channel is filtered independently except for Mode which treats the whole texel as an ID
+	void Build(const FImage& BaseBGRA8, EGensysMipFilter Filter, FGensysMipChain& Out);
+
+	// Builds the chains of a layer ID map and its weight map together (both BGRA8 of the same size)
+	// The IDs go through Mode and the weights follow the texels that won, averaged over them
+	// so at every mip each weight still belongs to the layer in the same channel of the ID map
+	void BuildIdWeightPair(const FImage& IdsBGRA8, const FImage& WeightsBGRA8, FGensysMipChain& OutIds, FGensysMipChain& OutWeights);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GensysMap.h"
+
+// Lattice value noise evaluators, picked at runtime from the instruction sets of the host
+enum class EGensysNoiseKernel : uint8
+{
+	// one sample at a time, the reference every other kernel is verified against
+	Scalar,
+	// 4 samples per instruction through the engine vector registers (SSE4 / NEON)
+	Vector4,
+	// 8 samples per instruction
+	AVX2,
+	// 16 samples per instruction
+	AVX512,
+	Count
+};
+
+// Ways the octaves of the lattice are combined
+enum class EGensysNoiseMode : uint8
+{
+	// plain fractal sum
+	Fbm,
+	// ridged multifractal, sharp crests where the lattice crosses its midpoint
+	Ridged,
+	// folded octaves, rounded hills
+	Billow,
+	// fBm sampled at positions pushed around by two other fBm fields
+	Warped,
+	Count
+};
+
+struct FGensysNoiseSettings
+{
+	int32 Octaves = 4;
+	// size in pixels of a lattice cell of the first octave
+	float CellSize = 64.f;
+	// amplitude and frequency factors between two octaves
+	float Persistence = 0.5f;
+	float Lacunarity = 2.f;
+	uint32 Seed = 0;
+	// ridged multifractal shape, the crest height and how strongly a crest feeds the next octave
+	float RidgeOffset = 1.f;
+	float RidgeGain = 2.f;
+	// largest displacement in pixels of the domain warp
+	float WarpStrength = 16.f;
+};
+
+namespace GensysNoise
+{
+	// Fastest kernel the host supports that also matched the scalar reference, detected once
+	EGensysNoiseKernel GetBestKernel();
+
+	bool IsKernelSupported(EGensysNoiseKernel Kernel);
+	const TCHAR* GetKernelName(EGensysNoiseKernel Kernel);
+
+	// Largest difference of the kernel against the scalar reference over a fixed set of coordinates
+	float VerifyKernel(EGensysNoiseKernel Kernel);
+
+	// Value noise (0-1) at lattice space coordinates, smoothstep faded and bilinearly interpolated between the
+	// hashed lattice corners
+	void Evaluate(const float* X, const float* Y, int32 Count, uint32 Seed, float* Out, EGensysNoiseKernel Kernel = GetBestKernel());
+
+	// fBm over the octaves, normalised to 0-1, rows are split over the task graph
+	// the layers are half precision, the octaves are summed in float and only the result is stored
+	void Generate(const FGensysNoiseSettings& Settings, int32 Width, int32 Height, FGensysHalfMap& Out, FGensysBufferPool* Pool = nullptr,
+		EGensysNoiseKernel Kernel = GetBestKernel());
+
+	// Single mode, normalised to 0-1
+	void Generate(const FGensysNoiseSettings& Settings, EGensysNoiseMode Mode, int32 Width, int32 Height, FGensysHalfMap& Out, FGensysBufferPool* Pool = nullptr);
+
+	// Every mode with a non null layer from a single lattice evaluation per octave, only the warp pays for its extra lattices
+	void GenerateLayers(const FGensysNoiseSettings& Settings, int32 Width, int32 Height, FGensysHalfMap* (&OutLayers)[(int32)EGensysNoiseMode::Count],
+		FGensysBufferPool* Pool = nullptr, EGensysNoiseKernel Kernel = GetBestKernel());
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/ParallelFor.h"
+#include "GensysProgress.h"
+#include <atomic>
+
+namespace GensysParallel
+{
+	// Default amount of rows a single task processes, keeps a few rows of a stencil hot in cache
+	constexpr int32 DefaultRowsPerBlock = 32;
+
+	// Upper bound of the tasks a single ForRowBlocks runs at once, 0 leaves it to the task graph
+	inline std::atomic<int32>& MaxWorkers()
+	{
+		static std::atomic<int32> Workers { 0 };
+		return Workers;
+	}
+
+	// Limits the concurrency while in scope (used by the benchmark to measure scaling)
+	struct FScopedMaxWorkers
+	{
+		explicit FScopedMaxWorkers(int32 Workers) : Previous(MaxWorkers().exchange(Workers)) {}
+		~FScopedMaxWorkers() { MaxWorkers() = Previous; }
+
+	private:
+		int32 Previous;
+	};
+
+	// Splits [0, NumRows) into blocks of rows and runs the body for each block on the task graph
+	// Blocks that have not started yet are skipped once the running generation is cancelled
+	inline void ForRowBlocks(int32 NumRows, int32 RowsPerBlock, TFunctionRef<void(int32 RowBegin, int32 RowEnd)> Body)
+	{
+		const int32 NumBlocks = FMath::DivideAndRoundUp(NumRows, RowsPerBlock);
+		const int32 Workers = MaxWorkers();
+
+		// the active generation is per thread, read it here rather than on the task graph threads
+		const FGensysProgress* Progress = FGensysProgress::GetActive();
+
+		const auto RunBlock = [&](int32 Block)
+		{
+			if (Progress && Progress->IsCancelled())
+				return;
+
+			const int32 RowBegin = Block * RowsPerBlock;
+			Body(RowBegin, FMath::Min(RowBegin + RowsPerBlock, NumRows));
+		};
+
+		if (Workers <= 0 || Workers >= NumBlocks)
+		{
+			ParallelFor(NumBlocks, RunBlock);
+			return;
+		}
+
+		// one task per worker, each walks an interleaved subset of the blocks
+		ParallelFor(Workers, [&](int32 Worker)
+		{
+			for (int32 Block = Worker; Block < NumBlocks; Block += Workers)
+				RunBlock(Block);
+		}, Workers == 1);
+	}
+}
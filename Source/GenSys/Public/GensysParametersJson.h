@@ -0,0 +1,83 @@
+#pragma once
+
+#include "DataTypes.h"
+#include "GensysJson.h"
+
+// Reading of parameter sets stored as json (golden corpus cases, batch manifests)
+// Uses the same key names as the input.json read by the core (plus the plugin side options), missing keys keep their defaults
+// Returns false with the error set on the first key of the wrong type, the parameters are then partially read
+
+#define PARSE_FROM_JSON(input, dest, value) \
+	if (!GensysJson::Read(input, #value, dest.value, OutError)) \
+		return false;
+
+inline bool ParseParamsFromJson(const nlohmann::json& In, GensysParameters& Out, FString& OutError)
+{
+	if (!In.is_object())
+	{
+		OutError = TEXT("expected an object of parameters");
+		return false;
+	}
+
+	PARSE_FROM_JSON(In, Out, ValueNoiseOctaves)
+	PARSE_FROM_JSON(In, Out, BlurPixelRadius)
+	PARSE_FROM_JSON(In, Out, Granularity)
+	PARSE_FROM_JSON(In, Out, RiverGenerationIterations)
+	PARSE_FROM_JSON(In, Out, RiverResolution)
+	PARSE_FROM_JSON(In, Out, RiverThickness)
+	PARSE_FROM_JSON(In, Out, RiverAllowNodeMismatch)
+	PARSE_FROM_JSON(In, Out, RiversOnGivenFeatures)
+	PARSE_FROM_JSON(In, Out, RiverStrengthFactor)
+	PARSE_FROM_JSON(In, Out, NumberOfTerrainLayers)
+	PARSE_FROM_JSON(In, Out, NumberOfFoliageLayers)
+	PARSE_FROM_JSON(In, Out, FoliageWholeness)
+	PARSE_FROM_JSON(In, Out, MinUnitFoliageHeight)
+	PARSE_FROM_JSON(In, Out, User_TerrainOutlineMap)
+	PARSE_FROM_JSON(In, Out, User_TerrainFeatureMap)
+	PARSE_FROM_JSON(In, Out, User_RiverOutline)
+	PARSE_FROM_JSON(In, Out, User_TerrainOutlineAsset)
+	PARSE_FROM_JSON(In, Out, User_TerrainFeatureAsset)
+	PARSE_FROM_JSON(In, Out, User_RiverOutlineAsset)
+	PARSE_FROM_JSON(In, Out, Identifier)
+	PARSE_FROM_JSON(In, Out, BlendForcedFeatures)
+	PARSE_FROM_JSON(In, Out, FeatureBlendLevels)
+	PARSE_FROM_JSON(In, Out, DetailNoiseOctaves)
+	PARSE_FROM_JSON(In, Out, DetailNoiseCellSize)
+	PARSE_FROM_JSON(In, Out, DetailNoiseAmplitude)
+	PARSE_FROM_JSON(In, Out, DetailNoiseSeed)
+	PARSE_FROM_JSON(In, Out, DetailNoiseMode)
+	PARSE_FROM_JSON(In, Out, DetailNoiseWarpStrength)
+	PARSE_FROM_JSON(In, Out, ExportNoiseLayers)
+	PARSE_FROM_JSON(In, Out, ExportRiverGraph)
+	PARSE_FROM_JSON(In, Out, RiverGraphNodeSpacing)
+	PARSE_FROM_JSON(In, Out, RasteriseRivers)
+	PARSE_FROM_JSON(In, Out, RiverProfile)
+	PARSE_FROM_JSON(In, Out, RiverOrderWidening)
+	PARSE_FROM_JSON(In, Out, ExportRiverSplines)
+	PARSE_FROM_JSON(In, Out, RiverSplineTolerance)
+	PARSE_FROM_JSON(In, Out, RiverSplineUnitsPerPixel)
+	PARSE_FROM_JSON(In, Out, ExportDistanceFields)
+	PARSE_FROM_JSON(In, Out, DistanceFalloff)
+	PARSE_FROM_JSON(In, Out, ExportLakes)
+	PARSE_FROM_JSON(In, Out, LakeMinDepth)
+	PARSE_FROM_JSON(In, Out, LakeMinArea)
+	PARSE_FROM_JSON(In, Out, ExportTerrainAttributes)
+	PARSE_FROM_JSON(In, Out, AttributeHeightScale)
+	PARSE_FROM_JSON(In, Out, ClassifyTerrainLayers)
+	PARSE_FROM_JSON(In, Out, LayerRulesPath)
+	PARSE_FROM_JSON(In, Out, LayerWeightmaps)
+	PARSE_FROM_JSON(In, Out, BuildSparseFoliage)
+	PARSE_FROM_JSON(In, Out, FoliageRulesPath)
+	PARSE_FROM_JSON(In, Out, FoliageDensityMaps)
+	PARSE_FROM_JSON(In, Out, OutOfCoreMegapixels)
+	PARSE_FROM_JSON(In, Out, GenerateMipChains)
+	PARSE_FROM_JSON(In, Out, HeightMipsUseMax)
+	PARSE_FROM_JSON(In, Out, EmitBlockCompressed)
+	PARSE_FROM_JSON(In, Out, SkipTextureImport)
+	PARSE_FROM_JSON(In, Out, AlwaysReimport)
+	PARSE_FROM_JSON(In, Out, SkipAssetSaves)
+
+	return true;
+}
+
+#undef PARSE_FROM_JSON
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GensysMap.h"
+#include "GensysTileStore.h"
+
+#include <csetjmp>
+
+class IFileHandle;
+struct png_struct_def;
+struct png_info_def;
+
+// Row by row png decoding through libpng, the engine image wrappers only decode whole images
+// and a 64k x 64k 16 bit map is 8 GB once decoded
+// Rows come out as RGBA in the bit depth of the file (8 or 16, native byte order), data not colour so no gamma is applied
+class FGensysPngReader
+{
+public:
+	FGensysPngReader() = default;
+	FGensysPngReader(const FGensysPngReader&) = delete;
+	FGensysPngReader& operator=(const FGensysPngReader&) = delete;
+	~FGensysPngReader();
+
+	// Reads the header only, interlaced files are refused since their rows cannot be decoded one at a time
+	bool Open(const FString& Path);
+
+	// Decodes the next row, GetRowBytes() bytes
+	bool ReadRow(uint8* OutRow);
+
+	// Decodes the next NumRows rows, the red channel goes into a NumRows high map
+	template<typename StorageType>
+	bool ReadRows(int32 NumRows, TGensysMap<StorageType>& Out, FGensysBufferPool* Pool = nullptr);
+
+	void Close();
+
+	int32 GetWidth() const { return Width; }
+	int32 GetHeight() const { return Height; }
+	int32 GetBitDepth() const { return BitDepth; }
+	int64 GetRowBytes() const { return (int64)Width * 4 * (BitDepth / 8); }
+
+private:
+	TUniquePtr<IFileHandle> File;
+	png_struct_def* Png = nullptr;
+	png_info_def* Info = nullptr;
+	// libpng errors long jump back into the call that failed
+	std::jmp_buf ErrorJump;
+
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 BitDepth = 0;
+	int32 NextRow = 0;
+	TArray64<uint8> Row;
+};
+
+// Row by row png encoding through libpng, grey or RGBA, 8 or 16 bit
+class FGensysPngWriter
+{
+public:
+	FGensysPngWriter() = default;
+	FGensysPngWriter(const FGensysPngWriter&) = delete;
+	FGensysPngWriter& operator=(const FGensysPngWriter&) = delete;
+	~FGensysPngWriter();
+
+	// Channels is 1 (grey) or 4 (RGBA), BitDepth 8 or 16
+	bool Open(const FString& Path, int32 InWidth, int32 InHeight, int32 InChannels, int32 InBitDepth);
+
+	// Encodes the next row, 16 bit samples in native byte order
+	bool WriteRow(const void* InRow);
+
+	// Encodes every row of the map as 16 bit grey, the encoding of GensysImage::SaveMap
+	template<typename StorageType>
+	bool WriteRows(const TGensysMap<StorageType>& Rows);
+
+	// Writes the end of the file, false when rows are missing or anything failed on the way
+	bool Close();
+
+	int32 GetWidth() const { return Width; }
+	int32 GetHeight() const { return Height; }
+
+private:
+	FString Path;
+	TUniquePtr<IFileHandle> File;
+	png_struct_def* Png = nullptr;
+	png_info_def* Info = nullptr;
+	std::jmp_buf ErrorJump;
+
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 Channels = 0;
+	int32 BitDepth = 0;
+	int32 NextRow = 0;
+	bool bFailed = false;
+	TArray<uint16> Row;
+};
+
+namespace GensysImage
+{
+	// Size of a png read from its header, nothing is decoded
+	bool ReadPngSize(const FString& Path, int32& OutWidth, int32& OutHeight);
+
+	// Decodes the red channel of a png into a new store a row of tiles at a time, the store is finalized on success
+	template<typename StorageType>
+	bool LoadStore(const FString& Path, const FString& StorePath, TGensysTileStore<StorageType>& Out, FGensysBufferPool* Pool = nullptr);
+
+	// Encodes a finalized store as a 16 bit grey png a row of tiles at a time, same output as SaveMap
+	template<typename StorageType>
+	bool SaveStore(const FString& Path, TGensysTileStore<StorageType>& Store, FGensysBufferPool* Pool = nullptr);
+}
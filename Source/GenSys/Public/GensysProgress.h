@@ -0,0 +1,60 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+// Progress and cancellation channel shared by every stage of a generation
+// Stages advance it from any thread, the UI polls it through OnTick on the game thread
+class FGensysProgress
+{
+public:
+	explicit FGensysProgress(int32 InNumStages) : NumStages(FMath::Max(InNumStages, 1)) {}
+
+	// Moves on to the next stage
+	void BeginStage(const FText& Name);
+
+	// Progress of the current stage, 0-1
+	void SetStageFraction(float Fraction);
+
+	// Free form detail shown under the stage name (e.g. the last line printed by the core)
+	void SetDetail(const FString& InDetail);
+
+	void Cancel() { bCancelled = true; }
+	bool IsCancelled() const { return bCancelled; }
+
+	float GetOverallFraction() const;
+	FText GetStatusText() const;
+
+	// Called by the stages between steps, returns false once the run is cancelled
+	// That is the game thread for a run started from the window and a queue worker thread for a queued job,
+	// OnTick runs on the calling thread so only the game thread runs hook the UI in here, queued jobs leave it
+	// unset and the queue polls their status text instead
+	bool Tick();
+	TFunction<bool(const FGensysProgress&)> OnTick;
+
+	// While in scope on this thread the parallel helpers skip the remaining blocks once the run is cancelled
+	struct FScopedActive
+	{
+		explicit FScopedActive(FGensysProgress& Progress);
+		~FScopedActive();
+
+	private:
+		FGensysProgress* Previous;
+	};
+
+	// Generation running on the calling thread, null outside of one
+	static const FGensysProgress* GetActive();
+
+	// True when the generation running on the calling thread was cancelled
+	static bool IsActiveCancelled();
+
+private:
+	const int32 NumStages;
+	std::atomic<bool> bCancelled { false };
+	std::atomic<int32> StageIndex { -1 };
+	std::atomic<float> StageFraction { 0.f };
+
+	mutable FCriticalSection Lock;
+	FText StageName;
+	FString Detail;
+};
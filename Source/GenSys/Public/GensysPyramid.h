@@ -0,0 +1,26 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GensysMap.h"
+
+// Gaussian / Laplacian pyramids, 5 tap binomial kernel (Burt & Adelson)
+// Every level is a quarter of the one below, so a whole pyramid costs a third more than its base level
+// The levels are half precision maps, the kernels filter in float and only store in half
+namespace GensysPyramid
+{
+	// Filters and halves the map, rows are split over the task graph and every block filters the input rows it needs
+	// horizontally once into a scratch band before the vertical pass
+	template<typename StorageType>
+	void Reduce(const TGensysMap<StorageType>& In, FGensysHalfMap& Out, FGensysBufferPool* Pool = nullptr);
+
+	// Interpolates the map back up to the given size (at most twice its own)
+	void Expand(const FGensysHalfMap& In, int32 Width, int32 Height, FGensysHalfMap& Out, FGensysBufferPool* Pool = nullptr);
+
+	// Multiband blend of B over A, the mask (1 takes B) is blurred per band so the transition widens with the wavelength
+	// and the cost does not depend on how wide the transition ends up
+	// The blend is linear in A and B so only the pyramid of B - A is built, it is 0 wherever B follows A and the half
+	// levels lose nothing there, the result is added back onto A in the storage of the inputs (Out must not be A or B)
+	template<typename StorageType>
+	void Blend(const TGensysMap<StorageType>& A, const TGensysMap<StorageType>& B, const FGensysMaskMap& Mask, int32 MaxLevels,
+		TGensysMap<StorageType>& Out, FGensysBufferPool* Pool = nullptr);
+}
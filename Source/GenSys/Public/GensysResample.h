@@ -0,0 +1,12 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FImage;
+
+namespace GensysResample
+{
+	// Separable triangle filter resize of an RGBA32F image, the support widens when downscaling so every
+	// source texel contributes, rows of both passes are split over the task graph and filtered 4 channels at a time
+	void Resize(const FImage& Source, int32 Width, int32 Height, FImage& Out);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GensysMap.h"
+
+// River network traced back from the river map written by the core (the core keeps its own graph internal)
+// Nodes sit roughly NodeSpacing pixels apart along the channels, edges link nodes whose pixels touch
+struct FGensysRiverGraph
+{
+	// size of the traced map in pixels
+	int32 Width = 0;
+	int32 Height = 0;
+
+	// node centres in pixels
+	TArray<FVector2f> Positions;
+	// mean river map value of the pixels of a node, 0-1
+	TArray<float> Strength;
+	// node pairs, X < Y
+	TArray<FIntPoint> Edges;
+
+	// edges added by joining loose ends to nearby networks
+	int32 NumMerged = 0;
+
+	bool IsEmpty() const { return Positions.Num() == 0; }
+	int32 NumNodes() const { return Positions.Num(); }
+
+	void Reset();
+
+	// Key of the undirected edge between two nodes, the same whichever way round they are given
+	static uint64 GetEdgeKey(int32 A, int32 B)
+	{
+		return ((uint64)(uint32)FMath::Min(A, B) << 32) | (uint32)FMath::Max(A, B);
+	}
+
+	// Neighbours of every node
+	void GetAdjacency(TArray<TArray<int32, TInlineAllocator<4>>>& Out) const;
+
+	// Nodes as UV positions (0-1) with their strength, edges as index pairs
+	bool SaveJson(const FString& Path) const;
+};
+
+struct FGensysRiverTraceSettings
+{
+	// river map values above this are channel pixels
+	float Threshold = 0.5f;
+	// pixels within this distance of a node belong to it
+	float NodeSpacing = 4.f;
+	// joins every loose end to the nearest node of another network within the merge radius
+	bool bMergeLooseEnds = false;
+	float MergeRadius = 12.f;
+};
+
+namespace GensysRiverGraph
+{
+	// Single scan over the map, every channel pixel is matched to a node through a spatial grid radius query
+	// so the cost per pixel stays constant however large the network grows
+	void Trace(const FGensysMap& RiverMap, const FGensysRiverTraceSettings& Settings, FGensysRiverGraph& Out);
+}
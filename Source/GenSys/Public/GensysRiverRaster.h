@@ -0,0 +1,40 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GensysMap.h"
+#include "GensysRiverGraph.h"
+
+// Cross section of a channel, from the centre line (1) to the bank (0)
+enum class EGensysRiverProfile : uint8
+{
+	// constant depth, the bank is only softened by the coverage
+	Flat,
+	// rounded bed
+	Parabolic,
+	// linear banks meeting at the centre line
+	VShaped,
+	Count
+};
+
+struct FGensysRiverRasterSettings
+{
+	// width in pixels of a first order channel
+	float Thickness = 1.f;
+	// extra width per flow order above the first, relative to the thickness
+	float OrderWidening = 0.5f;
+	EGensysRiverProfile Profile = EGensysRiverProfile::Parabolic;
+	// size in pixels of the tiles the segments are binned into
+	int32 TileSize = 64;
+};
+
+namespace GensysRiverRaster
+{
+	// Strahler order of every node, the network is peeled from its loose ends inwards
+	// Nodes on loops that never become loose ends take the highest order of their finished neighbours
+	void ComputeFlowOrders(const FGensysRiverGraph& Graph, TArray<int32>& OutOrders);
+
+	// Draws every edge of the graph as a tapered capsule into a map of the graph size
+	// The segments are binned per tile and the tiles are drawn in parallel, overlapping channels keep the deepest value
+	// and the banks get an analytic one pixel coverage so the result does not alias at any resolution
+	void Rasterise(const FGensysRiverGraph& Graph, const FGensysRiverRasterSettings& Settings, FGensysMap& Out, FGensysBufferPool* Pool = nullptr);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GensysRiverGraph.h"
+
+// Run of river between two junctions or loose ends, in pixels of the traced map
+struct FGensysRiverPolyline
+{
+	TArray<FVector2f> Points;
+	// highest flow order along the run
+	int32 Order = 1;
+	// runs that circle back to their start without a junction, the last point is not repeated
+	bool bClosed = false;
+};
+
+namespace GensysRiverSplines
+{
+	// Splits the graph at every node that is not a plain link of a chain (junctions and loose ends)
+	void ExtractPolylines(const FGensysRiverGraph& Graph, TArray<FGensysRiverPolyline>& Out);
+
+	// Douglas-Peucker, drops the points closer than the tolerance to the simplified line, the ends are always kept
+	void Simplify(TArray<FVector2f>& Points, float Tolerance);
+
+	// Polylines as UV points (0-1), compact enough to rebuild the splines outside the editor
+	bool SaveJson(const TArray<FGensysRiverPolyline>& Polylines, int32 Width, int32 Height, const FString& Path);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GensysMap.h"
+
+// Density of one foliage layer over one tile, only kept for tiles the layer grows on
+struct FGensysFoliageBlock
+{
+	static constexpr int32 TileSize = 64;
+	static constexpr int32 NumWords = TileSize * TileSize / 64;
+
+	// tile index, row major over the tiles of the map
+	int32 Tile = 0;
+	// a bit per pixel of the tile, row major
+	uint64 Occupancy[NumWords] = {};
+	// densities of the occupied pixels only, in bit order
+	TArray<uint8> Densities;
+
+	// Density of a pixel of the tile, the rank of its bit is its position in the densities
+	uint8 GetDensity(int32 PixelInTile) const;
+};
+
+// Block sparse foliage layers, memory follows where vegetation grows instead of the layer count times the map size
+struct FGensysSparseFoliage
+{
+	static constexpr int32 TileSize = FGensysFoliageBlock::TileSize;
+
+	// Fills the densities (TileSize * TileSize, row major) of a tile, pixels past the map border are ignored
+	using FTileFunction = TFunctionRef<void(int32 TileX, int32 TileY, uint8* OutDensities)>;
+
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 NumTilesX = 0;
+	int32 NumTilesY = 0;
+
+	TArray<FString> LayerNames;
+	// blocks of every layer, sorted by tile
+	TArray<TArray<FGensysFoliageBlock>> Layers;
+
+	void Init(int32 InWidth, int32 InHeight);
+
+	// Tiles are evaluated in parallel and kept only when something grows on them, no dense buffer is ever allocated
+	int32 AddLayer(const FString& Name, FTileFunction FillTile);
+	int32 AddLayer(const FString& Name, const FGensysMaskMap& Densities);
+
+	uint8 GetDensity(int32 Layer, int32 X, int32 Y) const;
+
+	// Dense density map of a single layer, for the layers that are still consumed as textures
+	void ExtractLayer(int32 Layer, FGensysMaskMap& Out, FGensysBufferPool* Pool = nullptr) const;
+
+	// Rows RowBegin to RowEnd of the same dense map, lets a map too large to be held whole be encoded a band at a time
+	void ExtractRows(int32 Layer, int32 RowBegin, int32 RowEnd, FGensysMaskMap& Out, FGensysBufferPool* Pool = nullptr) const;
+
+	int64 GetAllocatedSize() const;
+
+	// Binary dump: "GFSP", version, size, layer names then per layer its blocks (tile, occupancy, count, densities)
+	bool Save(const FString& Path) const;
+};
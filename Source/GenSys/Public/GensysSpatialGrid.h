@@ -0,0 +1,118 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Uniform hashed grid over 2D points, items are inserted one at a time and never rebuilt
+// Every cell keeps a singly linked list of its items, a radius query only walks the cells the circle overlaps
+// so insertion and queries stay constant time per item as long as the cell size is close to the query radius
+class FGensysSpatialGrid
+{
+public:
+	explicit FGensysSpatialGrid(float InCellSize = 8.f) : CellSize(FMath::Max(InCellSize, KINDA_SMALL_NUMBER)), InvCellSize(1.f / CellSize) {}
+
+	void Reserve(int32 NumItems)
+	{
+		Positions.Reserve(NumItems);
+		Next.Reserve(NumItems);
+	}
+
+	// Returns the id of the new item, ids are consecutive from 0
+	int32 Add(const FVector2f& Position)
+	{
+		const int32 Id = Positions.Add(Position);
+		int32& Head = Heads.FindOrAdd(GetCellKey(GetCell(Position)), INDEX_NONE);
+		Next.Add(Head);
+		Head = Id;
+		return Id;
+	}
+
+	// Moves an item, e.g. when a node centroid is refined
+	void Move(int32 Id, const FVector2f& Position)
+	{
+		const uint64 OldKey = GetCellKey(GetCell(Positions[Id]));
+		const uint64 NewKey = GetCellKey(GetCell(Position));
+		Positions[Id] = Position;
+
+		if (OldKey == NewKey)
+			return;
+
+		// unlink from the old cell list
+		int32* Link = Heads.Find(OldKey);
+		while (*Link != Id)
+			Link = &Next[*Link];
+		*Link = Next[Id];
+
+		int32& Head = Heads.FindOrAdd(NewKey, INDEX_NONE);
+		Next[Id] = Head;
+		Head = Id;
+	}
+
+	const FVector2f& GetPosition(int32 Id) const { return Positions[Id]; }
+	int32 Num() const { return Positions.Num(); }
+
+	// Calls Visit(Id, DistanceSquared) for every item within the radius
+	template<typename VisitorType>
+	void ForEachInRadius(const FVector2f& Centre, float Radius, VisitorType&& Visit) const
+	{
+		const FIntPoint Min = GetCell(Centre - FVector2f(Radius));
+		const FIntPoint Max = GetCell(Centre + FVector2f(Radius));
+		const float RadiusSquared = Radius * Radius;
+
+		for (int32 CellY = Min.Y; CellY <= Max.Y; ++CellY)
+		{
+			for (int32 CellX = Min.X; CellX <= Max.X; ++CellX)
+			{
+				const int32* Head = Heads.Find(GetCellKey(FIntPoint(CellX, CellY)));
+				for (int32 Id = Head ? *Head : INDEX_NONE; Id != INDEX_NONE; Id = Next[Id])
+				{
+					const float DistanceSquared = FVector2f::DistSquared(Positions[Id], Centre);
+					if (DistanceSquared <= RadiusSquared)
+						Visit(Id, DistanceSquared);
+				}
+			}
+		}
+	}
+
+	// Closest item within the radius accepted by the filter, INDEX_NONE when there is none
+	template<typename FilterType>
+	int32 FindNearest(const FVector2f& Centre, float Radius, FilterType&& Filter) const
+	{
+		int32 Best = INDEX_NONE;
+		float BestDistanceSquared = MAX_flt;
+
+		ForEachInRadius(Centre, Radius, [&](int32 Id, float DistanceSquared)
+		{
+			if (DistanceSquared < BestDistanceSquared && Filter(Id))
+			{
+				Best = Id;
+				BestDistanceSquared = DistanceSquared;
+			}
+		});
+
+		return Best;
+	}
+
+	int32 FindNearest(const FVector2f& Centre, float Radius) const
+	{
+		return FindNearest(Centre, Radius, [](int32) { return true; });
+	}
+
+private:
+	FIntPoint GetCell(const FVector2f& Position) const
+	{
+		return FIntPoint(FMath::FloorToInt(Position.X * InvCellSize), FMath::FloorToInt(Position.Y * InvCellSize));
+	}
+
+	static uint64 GetCellKey(const FIntPoint& Cell)
+	{
+		return ((uint64)(uint32)Cell.X << 32) | (uint32)Cell.Y;
+	}
+
+	float CellSize;
+	float InvCellSize;
+
+	TArray<FVector2f> Positions;
+	// next item of the same cell, INDEX_NONE ends the list
+	TArray<int32> Next;
+	TMap<uint64, int32> Heads;
+};
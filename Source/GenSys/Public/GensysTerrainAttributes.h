@@ -0,0 +1,63 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GensysMap.h"
+#include "GensysTileStore.h"
+
+class FGensysPngWriter;
+
+// Neighbourhood derived terrain attributes, computed once per generation and shared by every stage that needs them
+struct FGensysTerrainAttributes
+{
+	// 0 flat - 1 vertical
+	FGensysMaskMap Slope;
+	// 0.5 flat, below is convex (ridges), above is concave (valleys)
+	FGensysMaskMap Curvature;
+	// 1 fully open sky - 0 fully occluded
+	FGensysMaskMap Occlusion;
+	// unit surface normal, X and Y biased around 0.5, Z up is rebuilt from them since it is never negative
+	FGensysMaskMap NormalX;
+	FGensysMaskMap NormalY;
+
+	bool IsEmpty() const { return Slope.IsEmpty(); }
+
+	void Reset()
+	{
+		Slope.Reset();
+		Curvature.Reset();
+		Occlusion.Reset();
+		NormalX.Reset();
+		NormalY.Reset();
+	}
+};
+
+// Outputs of the streamed pass, each attribute goes to its own tile store as the tiles are computed
+// The stores are created by the caller with the size and tile size of the height store
+struct FGensysTerrainAttributeStores
+{
+	FGensysMaskTileStore Slope;
+	FGensysMaskTileStore Curvature;
+	FGensysMaskTileStore Occlusion;
+	FGensysMaskTileStore NormalX;
+	FGensysMaskTileStore NormalY;
+};
+
+namespace GensysTerrainAttributes
+{
+	// Radius (in pixels) of the horizon search used for the occlusion estimate
+	constexpr int32 OcclusionRadius = 8;
+
+	// Single fused, cache blocked pass over the height map producing all the attributes
+	// HeightScale is the height of a fully white pixel expressed in pixels
+	// Output buffers are borrowed from the pool (if given), instantiated for float and 16 bit heights
+	template<typename HeightStorageType>
+	void Compute(const TGensysMap<HeightStorageType>& HeightMap, float HeightScale, FGensysTerrainAttributes& Out, FGensysBufferPool* Pool = nullptr);
+
+	// Same as Compute but the heights are streamed from an out of core store one tile (plus halo) at a time
+	// and the results are written tile by tile, only a window stays resident
+	void ComputeStreamed(FGensysHeightTileStore& HeightStore, float HeightScale, FGensysTerrainAttributeStores& Out, FGensysBufferPool* Pool = nullptr);
+
+	// Appends rows of normals to an RGBA8 png as a tangent space normal map (0.5 is 0 on every axis)
+	// the in memory path passes whole maps, the streamed one bands read back from the stores
+	bool WriteNormalRows(const FGensysMaskMap& NormalX, const FGensysMaskMap& NormalY, FGensysPngWriter& Writer);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GensysMap.h"
+
+class IFileHandle;
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+// Out of core storage of a map larger than what should stay resident
+// The map is split into fixed size tiles stored contiguously in a backing file, tiles are written once
+// and then read back through memory mapped regions, at most MaxResidentTiles stay mapped (least recently used is dropped)
+template<typename StorageType>
+class TGensysTileStore
+{
+public:
+	TGensysTileStore() = default;
+	TGensysTileStore(const TGensysTileStore&) = delete;
+	TGensysTileStore& operator=(const TGensysTileStore&) = delete;
+	~TGensysTileStore();
+
+	// Creates the backing file, the store is in the writing state afterwards
+	bool Create(const FString& InPath, int32 InWidth, int32 InHeight, int32 InTileSize = 256, int32 InMaxResidentTiles = 64);
+
+	// Writes a full tile (TileSize x TileSize values, padding included for the edge tiles)
+	void WriteTile(int32 TileX, int32 TileY, const StorageType* TileData);
+
+	// Splits an in memory map into tiles and writes all of them
+	void WriteMap(const TGensysMap<StorageType>& Map);
+
+	// Writes the tiles of a row of tiles, Rows holds its pixel rows (fewer than TileSize for the last one)
+	// lets a source that only produces rows in order, a png decoder, fill the store a band at a time
+	void WriteTileRow(int32 TileY, const TGensysMap<StorageType>& Rows);
+
+	// Closes the writer and maps the file for reading
+	bool Finalize();
+
+	// Hint from the stage scheduler that the tile will be read soon, the region is mapped with the preload hint
+	void Prefetch(int32 TileX, int32 TileY);
+
+	// Edge clamped random access read
+	float Sample(int32 X, int32 Y);
+
+	// Copies a rectangle (may extend past the borders, edge clamped) into an in memory map
+	void ReadWindow(const FIntRect& Rect, TGensysMap<StorageType>& Out, FGensysBufferPool* Pool = nullptr);
+
+	// Deletes the backing file and drops every resident tile
+	void Close();
+
+	int32 GetWidth() const { return Width; }
+	int32 GetHeight() const { return Height; }
+	int32 GetTileSize() const { return TileSize; }
+	int32 GetNumTilesX() const { return NumTilesX; }
+	int32 GetNumTilesY() const { return NumTilesY; }
+	int32 GetNumResidentTiles() const;
+
+private:
+	struct FResidentTile
+	{
+		IMappedFileRegion* Region = nullptr;
+		uint64 LastUse = 0;
+	};
+
+	int64 GetTileBytes() const { return (int64)TileSize * TileSize * sizeof(StorageType); }
+	int64 GetTileOffset(int32 TileX, int32 TileY) const { return ((int64)TileY * NumTilesX + TileX) * GetTileBytes(); }
+
+	// Returns the mapped tile, must be called with the lock held
+	const StorageType* MapTile(int32 TileX, int32 TileY, bool bPreload);
+	void EvictLeastRecentlyUsed();
+
+	FString Path;
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 TileSize = 0;
+	int32 NumTilesX = 0;
+	int32 NumTilesY = 0;
+	int32 MaxResidentTiles = 0;
+
+	TUniquePtr<IFileHandle> Writer;
+	TUniquePtr<IMappedFileHandle> Mapping;
+
+	mutable FCriticalSection Lock;
+	TMap<FIntPoint, FResidentTile> ResidentTiles;
+	uint64 UseCounter = 0;
+};
+
+using FGensysHeightTileStore = TGensysTileStore<uint16>;
+using FGensysMaskTileStore = TGensysTileStore<uint8>;
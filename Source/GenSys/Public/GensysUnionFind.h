@@ -0,0 +1,33 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Identity.h"
+
+// Disjoint set forest over an array of parent indices, Parents[Node] == Node marks a root
+// The array belongs to the caller so it can double as the label output, 32 bit for graph nodes and 64 bit for pixels
+namespace GensysUnionFind
+{
+	// Root of the set of a node, the path is halved on the way up
+	template<typename IndexType, typename AllocatorType>
+	IndexType FindRoot(TArray<IndexType, AllocatorType>& Parents, typename TIdentity<IndexType>::Type Node)
+	{
+		while (Parents[Node] != Node)
+		{
+			Parents[Node] = Parents[Parents[Node]];
+			Node = Parents[Node];
+		}
+		return Node;
+	}
+
+	// Joins the sets of A and B, the lower index stays the root so the root of a set is its first element
+	template<typename IndexType, typename AllocatorType>
+	void Union(TArray<IndexType, AllocatorType>& Parents, typename TIdentity<IndexType>::Type A, typename TIdentity<IndexType>::Type B)
+	{
+		const IndexType RootA = FindRoot(Parents, A);
+		const IndexType RootB = FindRoot(Parents, B);
+		if (RootA < RootB)
+			Parents[RootB] = RootA;
+		else if (RootB < RootA)
+			Parents[RootA] = RootB;
+	}
+}
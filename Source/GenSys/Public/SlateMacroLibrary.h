@@ -1,5 +1,7 @@
 #pragma once
 #include "Styling/SlateTypes.h"
+#include "PropertyCustomizationHelpers.h"
+#include "Engine/Texture2D.h"
 
 #define KEY_CHANGE_HANDLER_NUMERIC(out, paramName)\
 [](const FText& NewText, ETextCommit::Type InTextCommit)\
@@ -19,6 +21,12 @@
 	out.paramName = TCHAR_TO_ANSI(*NewText.ToString());\
 }
 
+#define KEY_CHANGE_HANDLER_ASSET(out, paramName)\
+[](const FAssetData& InAssetData)\
+{\
+	out.paramName = TCHAR_TO_ANSI(*InAssetData.GetObjectPathString());\
+}
+
 #define ARGUMENT_FIELD_NUMERIC(paramStruct , title, paramName, hint)\
 + SVerticalBox::Slot()\
 .AutoHeight()\
@@ -80,6 +88,28 @@
 	]\
 ]
 
+#define ARGUMENT_TEXTURE_ASSET(paramStruct, title, paramName)\
++ SVerticalBox::Slot()\
+.AutoHeight()\
+.Padding(FMargin(30,5))\
+[\
+	SNew(SHorizontalBox)\
+	+ SHorizontalBox::Slot()\
+	.VAlign(VAlign_Top)\
+	[\
+		SNew(STextBlock)\
+		.Text(FText::FromString(#title))\
+	]\
+	+ SHorizontalBox::Slot()\
+	.VAlign(VAlign_Top)\
+	[\
+		SNew(SObjectPropertyEntryBox)\
+		.AllowedClass(UTexture2D::StaticClass())\
+		.ObjectPath_Lambda([]() { return FString(paramStruct.paramName.data()); })\
+		.OnObjectChanged_Lambda(KEY_CHANGE_HANDLER_ASSET(paramStruct, paramName))\
+	]\
+]
+
 #define SECTION_TITLE(title)\
 + SVerticalBox::Slot()\
 .AutoHeight()\